@@ -64,6 +64,7 @@ static bool cmd_halt_timeout(target_s *t, int argc, const char **argv);
 static bool cmd_connect_reset(target_s *t, int argc, const char **argv);
 static bool cmd_reset(target_s *t, int argc, const char **argv);
 static bool cmd_tdi_low_reset(target_s *t, int argc, const char **argv);
+static bool cmd_flash_diff(target_s *t, int argc, const char **argv);
 #ifdef PLATFORM_HAS_POWER_SWITCH
 static bool cmd_target_power(target_s *t, int argc, const char **argv);
 #endif
@@ -100,6 +101,7 @@ const command_s cmd_list[] = {
 	{"reset", cmd_reset, "Pulse the nRST line - disconnects target: [PULSE_LEN, default 0ms]"},
 	{"tdi_low_reset", cmd_tdi_low_reset,
 		"Pulse nRST with TDI set low to attempt to wake certain targets up (eg LPC82x)"},
+	{"flash_diff", cmd_flash_diff, "Only erase and write Flash blocks whose contents change: [enable|disable]"},
 #ifdef PLATFORM_HAS_POWER_SWITCH
 	{"tpwr", cmd_target_power, "Supplies power to the target: [enable|disable]"},
 #endif
@@ -456,6 +458,23 @@ static bool cmd_connect_reset(target_s *t, int argc, const char **argv)
 	return true;
 }
 
+static bool cmd_flash_diff(target_s *t, int argc, const char **argv)
+{
+	(void)t;
+	bool print_status = false;
+	if (argc == 1)
+		print_status = true;
+	else if (argc == 2) {
+		if (parse_enable_or_disable(argv[1], &target_flash_differential))
+			print_status = true;
+	} else
+		gdb_out("Unrecognized command format\n");
+
+	if (print_status)
+		gdb_outf("Differential Flash programming: %s\n", target_flash_differential ? "enabled" : "disabled");
+	return true;
+}
+
 static bool cmd_halt_timeout(target_s *t, int argc, const char **argv)
 {
 	(void)t;
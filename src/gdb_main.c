@@ -150,6 +150,26 @@ int32_t gdb_main_loop(target_controller_s *tc, char *pbuf, size_t pbuf_size, siz
 			gdb_putpacketz("EFF");
 		break;
 	}
+	case 'x': { /* 'x addr,len': Read len bytes from addr as binary data */
+		uint32_t addr, len;
+		ERROR_IF_NO_TARGET();
+		if (read_hex32(pbuf + 1, &rest, &addr, ',') && read_hex32(rest, NULL, &len, READ_HEX_NO_FOLLOW)) {
+			/* Capped as for 'm', both to bound the stack used and as escaping can double the reply's length */
+			if (len > pbuf_size / 2U) {
+				gdb_putpacketz("E02");
+				break;
+			}
+			DEBUG_GDB("x packet: addr = %" PRIx32 ", len = %" PRIx32 "\n", addr, len);
+			uint8_t *mem = alloca(len);
+			/* The reply is a 'b' marker followed by the raw data, which gdb_putpacket2() escapes as needed */
+			if (target_mem32_read(cur_target, mem, addr, len))
+				gdb_putpacketz("E01");
+			else
+				gdb_putpacket2("b", 1U, (const char *)mem, len);
+		} else
+			gdb_putpacketz("EFF");
+		break;
+	}
 	case 'G': { /* 'G XX': Write general registers */
 		ERROR_IF_NO_TARGET();
 		const size_t reg_size = target_regs_size(cur_target);
@@ -453,7 +473,7 @@ static void exec_q_supported(const char *packet, const size_t length)
 	gdb_set_noackmode(false);
 
 	gdb_putpacket_f("PacketSize=%X;qXfer:memory-map:read+;qXfer:features:read+;"
-					"vContSupported+" GDB_QSUPPORTED_NOACKMODE,
+					"vContSupported+;binary-upload+" GDB_QSUPPORTED_NOACKMODE,
 		GDB_PACKET_BUFFER_SIZE);
 }
 
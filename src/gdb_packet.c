@@ -41,6 +41,11 @@ typedef enum packet_state {
 
 static bool noackmode = false;
 
+#if PC_HOSTED == 1
+/* Characters which end a run of plain payload data during packet capture */
+static const char gdb_packet_delimiters[] = {GDB_PACKET_START, GDB_PACKET_END, GDB_PACKET_ESCAPE, '\0'};
+#endif
+
 /* https://sourceware.org/gdb/onlinedocs/gdb/Packet-Acknowledgment.html */
 void gdb_set_noackmode(bool enable)
 {
@@ -117,6 +122,27 @@ packet_state_e consume_remote_packet(char *const packet, const size_t size)
 #endif
 }
 
+#if PC_HOSTED == 0
+static void consume_remote_frame(char *const packet, const size_t size)
+{
+	/* Binary frames carry their length up front, so read it and then exactly that much payload */
+	const uint8_t length_low = (uint8_t)gdb_if_getchar();
+	const uint8_t length_high = (uint8_t)gdb_if_getchar();
+	const size_t length = length_low | ((size_t)length_high << 8U);
+	for (size_t offset = 0; offset < length; ++offset) {
+		const char rx_char = gdb_if_getchar();
+		/* Drain anything that won't fit so we stay in sync with the host */
+		if (offset < size)
+			packet[offset] = rx_char;
+	}
+	/* A valid frame is finished with an end of message marker and fits the buffer, otherwise drop it */
+	if (gdb_if_getchar() == REMOTE_EOM && length && length <= size)
+		remote_frame_process((const uint8_t *)packet, length);
+	/* Restart packet capture */
+	packet[0] = '\0';
+}
+#endif
+
 size_t gdb_getpacket(char *const packet, const size_t size)
 {
 	packet_state_e state = PACKET_IDLE; /* State of the packet capture */
@@ -147,7 +173,9 @@ size_t gdb_getpacket(char *const packet, const size_t size)
 				state = consume_remote_packet(packet, size);
 				offset = 0;
 				checksum = 0;
-			}
+			} else if (rx_char == REMOTE_FRAME_SOM)
+				/* Start of BMP remote binary frame, handled in one go */
+				consume_remote_frame(packet, size);
 #endif
 			/* EOT (end of transmission) - connection was closed */
 			if (packet[0U] == '\x04') {
@@ -178,9 +206,17 @@ size_t gdb_getpacket(char *const packet, const size_t size)
 			if (rx_char == GDB_PACKET_ESCAPE)
 				/* GDB Escaped char */
 				state = PACKET_GDB_ESCAPE;
-			else
+			else {
 				/* Add to packet buffer */
 				packet[offset++] = rx_char;
+#if PC_HOSTED == 1
+				/* Pull in the run of plain payload characters that has already been received in one go */
+				const size_t count = gdb_if_getchars_until(packet + offset, size - offset, gdb_packet_delimiters);
+				for (size_t idx = 0; idx < count; ++idx)
+					checksum += (uint8_t)packet[offset + idx];
+				offset += count;
+#endif
+			}
 			break;
 
 		case PACKET_GDB_ESCAPE:
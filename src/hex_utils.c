@@ -25,6 +25,45 @@
 #include "general.h"
 #include "hex_utils.h"
 
+#if PC_HOSTED == 1
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HEX_UTILS_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define HEX_UTILS_NEON
+#endif
+#endif
+
+static const char hex_digits[16] = {
+	'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+
+/* Maps an ASCII hex digit (either case) to its value, anything else maps to 0 */
+static const uint8_t unhex_table[256] = {
+	['0'] = 0x0U,
+	['1'] = 0x1U,
+	['2'] = 0x2U,
+	['3'] = 0x3U,
+	['4'] = 0x4U,
+	['5'] = 0x5U,
+	['6'] = 0x6U,
+	['7'] = 0x7U,
+	['8'] = 0x8U,
+	['9'] = 0x9U,
+	['A'] = 0xaU,
+	['B'] = 0xbU,
+	['C'] = 0xcU,
+	['D'] = 0xdU,
+	['E'] = 0xeU,
+	['F'] = 0xfU,
+	['a'] = 0xaU,
+	['b'] = 0xbU,
+	['c'] = 0xcU,
+	['d'] = 0xdU,
+	['e'] = 0xeU,
+	['f'] = 0xfU,
+};
+
 char hex_digit(const uint8_t value)
 {
 	char digit = (char)value;
@@ -34,14 +73,132 @@ char hex_digit(const uint8_t value)
 	return digit;
 }
 
+#if defined(HEX_UTILS_SSE2)
+/* Converts 16 bytes at a time into 32 hex digits, returning how many bytes were consumed */
+static size_t hexify_vector(char *const hex, const uint8_t *const src, const size_t size)
+{
+	const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i ascii_zero = _mm_set1_epi8('0');
+	const __m128i letter_offset = _mm_set1_epi8('A' - '0' - 10);
+
+	size_t idx = 0;
+	for (; idx + 16U <= size; idx += 16U) {
+		const __m128i value = _mm_loadu_si128((const __m128i *)(src + idx));
+		const __m128i high = _mm_and_si128(_mm_srli_epi16(value, 4), nibble_mask);
+		const __m128i low = _mm_and_si128(value, nibble_mask);
+		/* Interleave so each byte becomes its high nibble followed by its low nibble */
+		__m128i first = _mm_unpacklo_epi8(high, low);
+		__m128i second = _mm_unpackhi_epi8(high, low);
+		/* Nibbles above 9 need shifting up to start at 'A' */
+		const __m128i first_offset = _mm_and_si128(_mm_cmpgt_epi8(first, nine), letter_offset);
+		const __m128i second_offset = _mm_and_si128(_mm_cmpgt_epi8(second, nine), letter_offset);
+		first = _mm_add_epi8(_mm_add_epi8(first, ascii_zero), first_offset);
+		second = _mm_add_epi8(_mm_add_epi8(second, ascii_zero), second_offset);
+		_mm_storeu_si128((__m128i *)(hex + idx * 2U), first);
+		_mm_storeu_si128((__m128i *)(hex + idx * 2U + 16U), second);
+	}
+	return idx;
+}
+
+/* Converts 32 hex digits at a time into 16 bytes, returning how many bytes were produced */
+static size_t unhexify_vector(uint8_t *const dst, const char *const hex, const size_t size)
+{
+	const __m128i lower_case = _mm_set1_epi8(0x20);
+	const __m128i ascii_zero = _mm_set1_epi8('0');
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i letter_offset = _mm_set1_epi8('a' - '0' - 10);
+	const __m128i low_byte_mask = _mm_set1_epi16(0x00ff);
+
+	size_t idx = 0;
+	for (; idx + 16U <= size; idx += 16U) {
+		__m128i first = _mm_loadu_si128((const __m128i *)(hex + idx * 2U));
+		__m128i second = _mm_loadu_si128((const __m128i *)(hex + idx * 2U + 16U));
+		/* Fold to lower case (digits are unaffected), then map '0'-'9' and 'a'-'f' down to 0-15 */
+		first = _mm_sub_epi8(_mm_or_si128(first, lower_case), ascii_zero);
+		second = _mm_sub_epi8(_mm_or_si128(second, lower_case), ascii_zero);
+		first = _mm_sub_epi8(first, _mm_and_si128(_mm_cmpgt_epi8(first, nine), letter_offset));
+		second = _mm_sub_epi8(second, _mm_and_si128(_mm_cmpgt_epi8(second, nine), letter_offset));
+		/* Each 16-bit lane holds a high nibble in its low byte and a low nibble in its high byte */
+		first = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(first, low_byte_mask), 4), _mm_srli_epi16(first, 8));
+		second = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(second, low_byte_mask), 4), _mm_srli_epi16(second, 8));
+		_mm_storeu_si128((__m128i *)(dst + idx), _mm_packus_epi16(first, second));
+	}
+	return idx;
+}
+#elif defined(HEX_UTILS_NEON)
+/* Converts 16 bytes at a time into 32 hex digits, returning how many bytes were consumed */
+static size_t hexify_vector(char *const hex, const uint8_t *const src, const size_t size)
+{
+	const uint8x16_t nine = vdupq_n_u8(9U);
+	const uint8x16_t ascii_zero = vdupq_n_u8('0');
+	const uint8x16_t letter_offset = vdupq_n_u8('A' - '0' - 10U);
+
+	size_t idx = 0;
+	for (; idx + 16U <= size; idx += 16U) {
+		const uint8x16_t value = vld1q_u8(src + idx);
+		uint8x16x2_t digits;
+		digits.val[0] = vshrq_n_u8(value, 4);
+		digits.val[1] = vandq_u8(value, vdupq_n_u8(0x0fU));
+		/* Nibbles above 9 need shifting up to start at 'A' */
+		for (size_t half = 0; half < 2U; ++half)
+			digits.val[half] = vaddq_u8(vaddq_u8(digits.val[half], ascii_zero),
+				vandq_u8(vcgtq_u8(digits.val[half], nine), letter_offset));
+		/* vst2 interleaves the high and low nibble digits for us */
+		vst2q_u8((uint8_t *)hex + idx * 2U, digits);
+	}
+	return idx;
+}
+
+/* Converts 32 hex digits at a time into 16 bytes, returning how many bytes were produced */
+static size_t unhexify_vector(uint8_t *const dst, const char *const hex, const size_t size)
+{
+	const uint8x16_t lower_case = vdupq_n_u8(0x20U);
+	const uint8x16_t ascii_zero = vdupq_n_u8('0');
+	const uint8x16_t nine = vdupq_n_u8(9U);
+	const uint8x16_t letter_offset = vdupq_n_u8('a' - '0' - 10U);
+
+	size_t idx = 0;
+	for (; idx + 16U <= size; idx += 16U) {
+		/* vld2 splits the digits into high nibble and low nibble streams for us */
+		uint8x16x2_t digits = vld2q_u8((const uint8_t *)hex + idx * 2U);
+		/* Fold to lower case (digits are unaffected), then map '0'-'9' and 'a'-'f' down to 0-15 */
+		for (size_t half = 0; half < 2U; ++half) {
+			const uint8x16_t value = vsubq_u8(vorrq_u8(digits.val[half], lower_case), ascii_zero);
+			digits.val[half] = vsubq_u8(value, vandq_u8(vcgtq_u8(value, nine), letter_offset));
+		}
+		vst1q_u8(dst + idx, vorrq_u8(vshlq_n_u8(digits.val[0], 4), digits.val[1]));
+	}
+	return idx;
+}
+#else
+static inline size_t hexify_vector(char *const hex, const uint8_t *const src, const size_t size)
+{
+	(void)hex;
+	(void)src;
+	(void)size;
+	return 0U;
+}
+
+static inline size_t unhexify_vector(uint8_t *const dst, const char *const hex, const size_t size)
+{
+	(void)dst;
+	(void)hex;
+	(void)size;
+	return 0U;
+}
+#endif
+
 char *hexify(char *const hex, const void *const buf, const size_t size)
 {
-	char *dst = hex;
 	const uint8_t *const src = buf;
+	/* Let the vector implementation (if any) chew through the bulk, then mop up the tail by table */
+	size_t idx = hexify_vector(hex, src, size);
+	char *dst = hex + idx * 2U;
 
-	for (size_t idx = 0; idx < size; ++idx) {
-		*dst++ = hex_digit(src[idx] >> 4U);
-		*dst++ = hex_digit(src[idx] & 0xfU);
+	for (; idx < size; ++idx) {
+		*dst++ = hex_digits[src[idx] >> 4U];
+		*dst++ = hex_digits[src[idx] & 0xfU];
 	}
 	*dst = 0;
 
@@ -61,8 +218,9 @@ uint8_t unhex_digit(const char hex)
 char *unhexify(void *const buf, const char *hex, const size_t size)
 {
 	uint8_t *const dst = buf;
-	for (size_t idx = 0; idx < size; ++idx, hex += 2U)
-		dst[idx] = (unhex_digit(hex[0]) << 4U) | unhex_digit(hex[1]);
+	size_t idx = unhexify_vector(dst, hex, size);
+	for (hex += idx * 2U; idx < size; ++idx, hex += 2U)
+		dst[idx] = (unhex_table[(uint8_t)hex[0]] << 4U) | unhex_table[(uint8_t)hex[1]];
 	return buf;
 }
 
@@ -51,6 +51,12 @@ static inline void write_le4(uint8_t *const buffer, const size_t offset, const u
 	buffer[offset + 3U] = (value >> 24U) & 0xffU;
 }
 
+static inline void write_le8(uint8_t *const buffer, const size_t offset, const uint64_t value)
+{
+	write_le4(buffer, offset, (uint32_t)value);
+	write_le4(buffer, offset + 4U, (uint32_t)(value >> 32U));
+}
+
 static inline void write_be4(uint8_t *const buffer, const size_t offset, const uint32_t value)
 {
 	buffer[offset + 0U] = (value >> 24U) & 0xffU;
@@ -70,6 +76,11 @@ static inline uint32_t read_le4(const uint8_t *const buffer, const size_t offset
 		((uint32_t)buffer[offset + 3U] << 24U);
 }
 
+static inline uint64_t read_le8(const uint8_t *const buffer, const size_t offset)
+{
+	return read_le4(buffer, offset) | ((uint64_t)read_le4(buffer, offset + 4U) << 32U);
+}
+
 static inline uint32_t read_be4(const uint8_t *const buffer, const size_t offset)
 {
 	return ((uint32_t)buffer[offset + 0U] << 24U) | ((uint32_t)buffer[offset + 1U] << 16U) |
@@ -25,5 +25,12 @@
 #include <target.h>
 
 bool bmd_crc32(target_s *target, uint32_t *crc, uint32_t base, size_t len);
+/* The same CRC as bmd_crc32(), but over a buffer in probe memory */
+uint32_t bmd_crc32_buffer(const void *buffer, size_t len);
+
+#if PC_HOSTED == 1
+/* bmd_crc32()'s fallback of reading the region back and computing the CRC here, for the benchmarks to time */
+bool generic_crc32(target_s *target, uint32_t *crc, uint32_t base, size_t len);
+#endif
 
 #endif /* INCLUDE_CRC32_H */
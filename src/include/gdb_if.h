@@ -30,6 +30,14 @@ int gdb_if_init(void);
 char gdb_if_getchar(void);
 char gdb_if_getchar_to(uint32_t timeout);
 
+#if PC_HOSTED == 1
+/*
+ * Bulk read of already received data: copies up to size characters into buffer, stopping
+ * before the first character found in delimiters. Never blocks, returns the number copied.
+ */
+size_t gdb_if_getchars_until(char *buffer, size_t size, const char *delimiters);
+#endif
+
 /* sending gdb_if_putchar(0, true) seems to work as keep alive */
 void gdb_if_putchar(char c, int flush);
 
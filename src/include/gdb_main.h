@@ -25,8 +25,13 @@
 
 /* Allow override in other platforms if needed */
 #ifndef GDB_PACKET_BUFFER_SIZE
+#if PC_HOSTED == 1
+/* BMDA isn't memory constrained, so allow GDB to send and request much larger blocks per packet */
+#define GDB_PACKET_BUFFER_SIZE 16384U
+#else
 #define GDB_PACKET_BUFFER_SIZE 1024U
 #endif
+#endif
 
 extern bool gdb_target_running;
 extern target_s *cur_target;
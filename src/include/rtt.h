@@ -60,5 +60,7 @@ typedef struct rtt_channel {
 extern rtt_channel_s rtt_channel[MAX_RTT_CHAN];
 
 void poll_rtt(target_s *cur_target);
+/* Search for the control block now rather than at the next poll, as the benchmarks do */
+void find_rtt(target_s *cur_target);
 
 #endif /* INCLUDE_RTT_H */
@@ -70,6 +70,8 @@ bool target_mem_access_needs_halt(target_s *target);
 bool target_flash_erase(target_s *target, target_addr_t addr, size_t len);
 bool target_flash_write(target_s *target, target_addr_t dest, const void *src, size_t len);
 bool target_flash_complete(target_s *target);
+/* When set, erase blocks whose contents would not change are neither erased nor written */
+extern bool target_flash_differential;
 
 /* Register access functions */
 size_t target_regs_size(target_s *target);
@@ -0,0 +1,477 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements BMDA's benchmark mode, selected with --bench. It times the host-side hot
+ * paths (hex conversion, CRC32 and the GDB packet layer) by wall clock, then runs a set of GDB-like
+ * workloads against the simulated probe and target, reporting both the wall time and the link cost
+ * the simulator modelled for each, so changes to the ADIv5, flash and RTT layers can be compared
+ * run to run. The results are written out as JSON.
+ */
+
+#include "general.h"
+#include <errno.h>
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "target.h"
+#include "target_internal.h"
+#include "hex_utils.h"
+#include "crc32.h"
+#include "gdb_packet.h"
+#include "buffer_utils.h"
+#include "bmp_hosted.h"
+#include "sim.h"
+#include "bench.h"
+#ifdef ENABLE_RTT
+#include "rtt.h"
+#endif
+
+/* Size of the buffer the host-side benchmarks work on, and how long each runs for at least */
+#define BENCH_HOST_BUFFER_SIZE (1024U * 1024U)
+#define BENCH_HOST_MIN_MS      250U
+/* Chunk sizes the target benchmarks use, matching what the CLI and a GDB session would ask for */
+#define BENCH_READ_CHUNK    4096U
+#define BENCH_WRITE_CHUNK   1024U
+#define BENCH_SMALL_READS   256U
+#define BENCH_RTT_CB_OFFSET 256U
+/* Payload size of the GDB packets benchmarked, and how many are sent through before reading the other end */
+#define BENCH_GDB_PAYLOAD 1024U
+#define BENCH_GDB_BATCH   16U
+/* Address the benchmarked X packets write to, which only shows up in their header */
+#define BENCH_GDB_ADDRESS 0x20000000U
+
+typedef struct bench {
+	FILE *out;
+	size_t count;
+	uint32_t start_ms;
+	sim_counters_s start;
+} bench_s;
+
+typedef void (*bench_host_fn)(uint8_t *data, char *hex, size_t size);
+
+/* Results of the host-side benchmarks are folded in here so the compiler can't discard the work */
+static volatile uint32_t bench_sink;
+
+static void bench_fill(uint8_t *const data, const size_t size, uint32_t seed)
+{
+	/* xorshift32, so every run programs and checks the same data */
+	for (size_t i = 0; i < size; ++i) {
+		seed ^= seed << 13U;
+		seed ^= seed >> 17U;
+		seed ^= seed << 5U;
+		data[i] = (uint8_t)seed;
+	}
+}
+
+static void bench_begin(bench_s *const bench)
+{
+	sim_counters(&bench->start);
+	bench->start_ms = platform_time_ms();
+}
+
+static void bench_separator(bench_s *const bench)
+{
+	fprintf(bench->out, "%s\n\t\t", bench->count++ ? "," : "");
+}
+
+static void bench_host_end(bench_s *const bench, const char *const name, const size_t size, const size_t iterations)
+{
+	const uint32_t wall_ms = platform_time_ms() - bench->start_ms;
+	const double total = (double)size * (double)iterations;
+	bench_separator(bench);
+	fprintf(bench->out,
+		"{\"name\": \"%s\", \"bytes\": %zu, \"iterations\": %zu, \"wall_ms\": %" PRIu32 ", \"mb_per_s\": %.3f}", name,
+		size, iterations, wall_ms, wall_ms ? total / (wall_ms * 1000.0) : 0.0);
+}
+
+static bool bench_target_end(bench_s *const bench, const char *const name, const size_t size, const bool ok)
+{
+	const uint32_t wall_ms = platform_time_ms() - bench->start_ms;
+	sim_counters_s end;
+	sim_counters(&end);
+	const uint64_t time_ns = end.time_ns - bench->start.time_ns;
+	const double kib = size / 1024.0;
+	bench_separator(bench);
+	fprintf(bench->out,
+		"{\"name\": \"%s\", \"ok\": %s, \"bytes\": %zu, \"wall_ms\": %" PRIu32 ", \"modelled_ms\": %.3f, "
+		"\"mb_per_s\": %.3f, \"transfers\": %" PRIu64 ", \"round_trips\": %" PRIu64 ", \"link_bytes\": %" PRIu64 ", "
+		"\"transfers_per_kib\": %.2f, \"round_trips_per_kib\": %.2f}",
+		name, ok ? "true" : "false", size, wall_ms, time_ns / 1000000.0, time_ns ? size / (time_ns / 1000.0) : 0.0,
+		end.transfers - bench->start.transfers, end.round_trips - bench->start.round_trips,
+		end.bytes - bench->start.bytes, size ? (end.transfers - bench->start.transfers) / kib : 0.0,
+		size ? (end.round_trips - bench->start.round_trips) / kib : 0.0);
+	if (!ok)
+		DEBUG_ERROR("Benchmark %s failed\n", name);
+	return ok;
+}
+
+static void bench_hexify(uint8_t *const data, char *const hex, const size_t size)
+{
+	hexify(hex, data, size);
+	bench_sink ^= (uint8_t)hex[size];
+}
+
+static void bench_unhexify(uint8_t *const data, char *const hex, const size_t size)
+{
+	unhexify(data, hex, size);
+	bench_sink ^= data[size - 1U];
+}
+
+static void bench_crc32_buffer(uint8_t *const data, char *const hex, const size_t size)
+{
+	(void)hex;
+	bench_sink ^= bmd_crc32_buffer(data, size);
+}
+
+static void bench_host(bench_s *const bench, const char *const name, const bench_host_fn fn, uint8_t *const data,
+	char *const hex)
+{
+	size_t iterations = 0;
+	bench_begin(bench);
+	do {
+		fn(data, hex, BENCH_HOST_BUFFER_SIZE);
+		++iterations;
+	} while (platform_time_ms() - bench->start_ms < BENCH_HOST_MIN_MS);
+	bench_host_end(bench, name, BENCH_HOST_BUFFER_SIZE, iterations);
+}
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+static bool bench_socket_send(const int socket, const char *const data, const size_t size)
+{
+	for (size_t offset = 0; offset < size;) {
+		const ssize_t result = send(socket, data + offset, size - offset, 0);
+		if (result <= 0)
+			return false;
+		offset += (size_t)result;
+	}
+	return true;
+}
+
+/* Read and throw away exactly size bytes */
+static bool bench_socket_drain(const int socket, size_t size)
+{
+	char buffer[4096];
+	while (size) {
+		const ssize_t result = recv(socket, buffer, MIN(size, sizeof(buffer)), 0);
+		if (result <= 0)
+			return false;
+		size -= (size_t)result;
+	}
+	return true;
+}
+
+/* Time gdb_getpacket() taking in the X packets a GDB load sends, checksumming and acknowledging each */
+static bool bench_gdb_getpacket(bench_s *const bench, const int peer, const uint8_t *const data)
+{
+	/* Build the packet once, escaping the binary payload as GDB does (so at worst doubling it) */
+	const size_t request_size = 32U + BENCH_GDB_PAYLOAD * 2U;
+	char *const request = malloc(request_size);
+	char *const packet = malloc(request_size);
+	if (!request || !packet) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		free(request);
+		free(packet);
+		return false;
+	}
+	const size_t header_length = (size_t)snprintf(
+		request, request_size, "%cX%08" PRIx32 ",%x:", GDB_PACKET_START, BENCH_GDB_ADDRESS, BENCH_GDB_PAYLOAD);
+	size_t length = header_length;
+	uint8_t checksum = 0;
+	for (size_t offset = 1U; offset < header_length; ++offset)
+		checksum += (uint8_t)request[offset];
+	for (size_t offset = 0; offset < BENCH_GDB_PAYLOAD; ++offset) {
+		uint8_t value = data[offset];
+		if (value == GDB_PACKET_START || value == GDB_PACKET_END || value == GDB_PACKET_ESCAPE ||
+			value == GDB_PACKET_RUNLENGTH_START) {
+			request[length++] = GDB_PACKET_ESCAPE;
+			checksum += GDB_PACKET_ESCAPE;
+			value ^= GDB_PACKET_ESCAPE_XOR;
+		}
+		request[length++] = (char)value;
+		checksum += value;
+	}
+	length += (size_t)snprintf(request + length, request_size - length, "%c%02X", GDB_PACKET_END, checksum);
+
+	/* What gdb_getpacket() hands back is the packet between the $ and #, unescaped */
+	const size_t packet_length = header_length - 1U + BENCH_GDB_PAYLOAD;
+	size_t packets = 0;
+	bool ok = true;
+	bench_begin(bench);
+	do {
+		for (size_t idx = 0; ok && idx < BENCH_GDB_BATCH; ++idx)
+			ok = bench_socket_send(peer, request, length);
+		for (size_t idx = 0; ok && idx < BENCH_GDB_BATCH; ++idx) {
+			ok = gdb_getpacket(packet, request_size) == packet_length &&
+				memcmp(packet + header_length - 1U, data, BENCH_GDB_PAYLOAD) == 0;
+		}
+		/* Collect the acknowledgement sent back for each packet */
+		ok = ok && bench_socket_drain(peer, BENCH_GDB_BATCH);
+		packets += BENCH_GDB_BATCH;
+	} while (ok && platform_time_ms() - bench->start_ms < BENCH_HOST_MIN_MS);
+	bench_host_end(bench, "gdb_getpacket", length, packets);
+	free(request);
+	free(packet);
+	if (!ok)
+		DEBUG_ERROR("Benchmark gdb_getpacket failed\n");
+	return ok;
+}
+
+/* Time gdb_putpacket() sending the hex encoded replies to m packets, with GDB's acknowledgements sent ahead */
+static bool bench_gdb_putpacket(bench_s *const bench, const int peer, const uint8_t *const data)
+{
+	char *const reply = malloc(BENCH_GDB_PAYLOAD * 2U + 1U);
+	if (!reply) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return false;
+	}
+	hexify(reply, data, BENCH_GDB_PAYLOAD);
+	char acks[BENCH_GDB_BATCH];
+	memset(acks, GDB_PACKET_ACK, sizeof(acks));
+	/* Hex needs no escaping, so each reply goes out as $, the payload, # and the two checksum digits */
+	const size_t length = BENCH_GDB_PAYLOAD * 2U + 4U;
+
+	size_t packets = 0;
+	bool ok = true;
+	bench_begin(bench);
+	do {
+		ok = bench_socket_send(peer, acks, sizeof(acks));
+		for (size_t idx = 0; ok && idx < BENCH_GDB_BATCH; ++idx)
+			gdb_putpacket(reply, BENCH_GDB_PAYLOAD * 2U);
+		ok = ok && bench_socket_drain(peer, length * BENCH_GDB_BATCH);
+		packets += BENCH_GDB_BATCH;
+	} while (ok && platform_time_ms() - bench->start_ms < BENCH_HOST_MIN_MS);
+	bench_host_end(bench, "gdb_putpacket", length, packets);
+	free(reply);
+	if (!ok)
+		DEBUG_ERROR("Benchmark gdb_putpacket failed\n");
+	return ok;
+}
+
+/* Run the GDB packet layer over a socketpair(), the benchmark playing the part of GDB at the other end */
+static bool bench_gdb_suite(bench_s *const bench, const uint8_t *const data)
+{
+	int sockets[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets)) {
+		DEBUG_ERROR("Error creating the socket pair for the GDB benchmarks: %s\n", strerror(errno));
+		return false;
+	}
+	gdb_if_attach(sockets[0]);
+	const bool ok = bench_gdb_getpacket(bench, sockets[1], data) && bench_gdb_putpacket(bench, sockets[1], data);
+	gdb_if_attach(-1);
+	close(sockets[0]);
+	close(sockets[1]);
+	return ok;
+}
+#endif
+
+static bool bench_host_suite(bench_s *const bench)
+{
+	uint8_t *const data = malloc(BENCH_HOST_BUFFER_SIZE);
+	char *const hex = malloc(BENCH_HOST_BUFFER_SIZE * 2U + 1U);
+	if (!data || !hex) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		free(data);
+		free(hex);
+		return false;
+	}
+	bench_fill(data, BENCH_HOST_BUFFER_SIZE, 0x2545f491U);
+	bench_host(bench, "hexify", bench_hexify, data, hex);
+	bench_host(bench, "unhexify", bench_unhexify, data, hex);
+	bench_host(bench, "crc32_buffer", bench_crc32_buffer, data, hex);
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+	const bool ok = bench_gdb_suite(bench, data);
+#else
+	const bool ok = true;
+#endif
+	free(data);
+	free(hex);
+	return ok;
+}
+
+static bool bench_flash_write(bench_s *const bench, target_s *const target, const target_flash_s *const flash,
+	const uint8_t *const data)
+{
+	bench_begin(bench);
+	bool ok = target_flash_erase(target, flash->start, flash->length);
+	/* Feed the data in as GDB's vFlashWrite packets would, leaving the buffering to the flash layer */
+	for (size_t offset = 0; ok && offset < flash->length; offset += BENCH_WRITE_CHUNK) {
+		const size_t amount = MIN(BENCH_WRITE_CHUNK, flash->length - offset);
+		ok = target_flash_write(target, flash->start + offset, data + offset, amount);
+	}
+	ok = target_flash_complete(target) && ok;
+	return bench_target_end(bench, "flash_write", flash->length, ok);
+}
+
+static bool bench_mem_read(bench_s *const bench, target_s *const target, const target_flash_s *const flash,
+	const uint8_t *const data)
+{
+	uint8_t buffer[BENCH_READ_CHUNK];
+	bool ok = true;
+	bench_begin(bench);
+	for (size_t offset = 0; ok && offset < flash->length; offset += BENCH_READ_CHUNK) {
+		const size_t amount = MIN(BENCH_READ_CHUNK, flash->length - offset);
+		ok = !target_mem32_read(target, buffer, flash->start + offset, amount) &&
+			memcmp(buffer, data + offset, amount) == 0;
+	}
+	return bench_target_end(bench, "mem_read", flash->length, ok);
+}
+
+static bool bench_mem_read_small(bench_s *const bench, target_s *const target, const target_flash_s *const flash,
+	const uint8_t *const data)
+{
+	/* The 4 byte reads GDB makes when it walks the stack or inspects variables */
+	bool ok = true;
+	bench_begin(bench);
+	for (size_t offset = 0; ok && offset < BENCH_SMALL_READS * 4U; offset += 4U) {
+		uint8_t value[4];
+		ok = !target_mem32_read(target, value, flash->start + offset, sizeof(value)) &&
+			memcmp(value, data + offset, sizeof(value)) == 0;
+	}
+	return bench_target_end(bench, "mem_read_small", BENCH_SMALL_READS * 4U, ok);
+}
+
+/* Time reading the Flash back and computing its CRC on the host, as done when the target can't do it itself */
+static bool bench_generic_crc32(bench_s *const bench, target_s *const target, const target_flash_s *const flash,
+	const uint8_t *const data)
+{
+	uint32_t crc = 0;
+	bench_begin(bench);
+	const bool ok = generic_crc32(target, &crc, flash->start, flash->length);
+	return bench_target_end(
+		bench, "generic_crc32", flash->length, ok && crc == bmd_crc32_buffer(data, flash->length));
+}
+
+/* And the same through bmd_crc32(), which has the target compute the CRC when it can */
+static bool bench_crc32(bench_s *const bench, target_s *const target, const target_flash_s *const flash,
+	const uint8_t *const data)
+{
+	uint32_t crc = 0;
+	bench_begin(bench);
+	const bool ok = bmd_crc32(target, &crc, flash->start, flash->length);
+	return bench_target_end(bench, "bmd_crc32", flash->length, ok && crc == bmd_crc32_buffer(data, flash->length));
+}
+
+#ifdef ENABLE_RTT
+static bool bench_rtt_find(bench_s *const bench, target_s *const target, const char *const name, const size_t size,
+	const uint32_t cbaddr)
+{
+	bench_begin(bench);
+	find_rtt(target);
+	const bool ok = cbaddr ? rtt_found && rtt_cbaddr == cbaddr : !rtt_found;
+	return bench_target_end(bench, name, size, ok);
+}
+
+static bool bench_rtt_search(bench_s *const bench, target_s *const target)
+{
+	const target_ram_s *const ram = target->ram;
+	if (!ram || ram->length < BENCH_RTT_CB_OFFSET * 2U)
+		return bench_target_end(bench, "rtt_search", 0, false);
+
+	/* Plant a control block with one idle up channel near the end of RAM, so the search covers it all */
+	const uint32_t cbaddr = ram->start + ram->length - BENCH_RTT_CB_OFFSET;
+	uint8_t cblock[48] = "SEGGER RTT";
+	write_le4(cblock, 16U, 1U);
+	write_le4(cblock, 20U, 0U);
+	if (target_mem32_write(target, cbaddr, cblock, sizeof(cblock)))
+		return bench_target_end(bench, "rtt_search", 0, false);
+
+	const bool enabled = rtt_enabled;
+	rtt_enabled = true;
+	/* The first search scans RAM, searching again then only has to check the address it was found at */
+	bool ok = bench_rtt_find(bench, target, "rtt_search", cbaddr + 16U - ram->start, cbaddr) &&
+		bench_rtt_find(bench, target, "rtt_search_hint", 16U, cbaddr);
+
+	/* And with the control block gone, as before the firmware sets it up, every search scans all of RAM */
+	if (ok) {
+		size_t ram_length = 0;
+		for (const target_ram_s *region = target->ram; region; region = region->next)
+			ram_length += region->length;
+		memset(cblock, 0, sizeof(cblock));
+		ok = !target_mem32_write(target, cbaddr, cblock, sizeof(cblock)) &&
+			bench_rtt_find(bench, target, "rtt_search_miss", ram_length, 0U);
+	}
+	rtt_enabled = enabled;
+	rtt_found = false;
+	return ok;
+}
+#endif
+
+static const target_flash_s *bench_lowest_flash(const target_s *const target)
+{
+	const target_flash_s *lowest = NULL;
+	for (const target_flash_s *flash = target->flash; flash; flash = flash->next) {
+		if (!lowest || flash->start < lowest->start)
+			lowest = flash;
+	}
+	return lowest;
+}
+
+static bool bench_target_suite(bench_s *const bench, target_s *const target)
+{
+	const target_flash_s *const flash = bench_lowest_flash(target);
+	if (!flash) {
+		DEBUG_ERROR("Target has no Flash to benchmark against\n");
+		return false;
+	}
+	uint8_t *const data = malloc(flash->length);
+	if (!data) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return false;
+	}
+	bench_fill(data, flash->length, 0x9e3779b9U);
+
+	/* The later benchmarks read back what the first one programmed, so stop at the first failure */
+	bool ok = bench_flash_write(bench, target, flash, data) && bench_mem_read(bench, target, flash, data) &&
+		bench_mem_read_small(bench, target, flash, data) && bench_generic_crc32(bench, target, flash, data) &&
+		bench_crc32(bench, target, flash, data);
+#ifdef ENABLE_RTT
+	ok = ok && bench_rtt_search(bench, target);
+#endif
+	free(data);
+	return ok;
+}
+
+int bench_run(target_s *const target, const char *const output)
+{
+	/* The Flash benchmark is destructive, so never run against real hardware */
+	if (bmda_probe_info.type != PROBE_TYPE_SIM) {
+		DEBUG_ERROR("Benchmarks can only be run against the simulated probe (--sim)\n");
+		return -1;
+	}
+
+	bench_s bench = {.out = stdout};
+	if (output) {
+		bench.out = fopen(output, "w");
+		if (!bench.out) {
+			DEBUG_ERROR("Error opening %s for the results: %s\n", output, strerror(errno));
+			return -1;
+		}
+	}
+
+	DEBUG_INFO("Running benchmarks\n");
+	fprintf(bench.out, "{\n\t\"link\": \"%s\",\n\t\"target\": \"%s\",\n\t\"benchmarks\": [", sim_link_name(),
+		target->driver);
+	const bool ok = bench_host_suite(&bench) && bench_target_suite(&bench, target);
+	fprintf(bench.out, "\n\t]\n}\n");
+
+	if (output)
+		fclose(bench.out);
+	return ok ? 0 : -1;
+}
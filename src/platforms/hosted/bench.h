@@ -0,0 +1,29 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_BENCH_H
+#define PLATFORMS_HOSTED_BENCH_H
+
+#include "target.h"
+
+/*
+ * Run the benchmark suite against the attached (simulated) target and write the results as JSON
+ * to the given file, or to stdout if that is NULL. Returns 0 on success, -1 otherwise.
+ */
+int bench_run(target_s *target, const char *output);
+
+#endif /* PLATFORMS_HOSTED_BENCH_H */
@@ -99,6 +99,15 @@ void bmp_ident(bmda_probe_s *info);
 int find_debuggers(bmda_cli_options_s *cl_opts, bmda_probe_s *info);
 void libusb_exit_function(bmda_probe_s *info);
 
+/* Wait up to timeout ms for input from GDB (or the RTT terminal), returning whether there is some */
+bool gdb_if_wait(uint32_t timeout);
+/* Count of receives from GDB so far, for telling whether GDB has been heard from in between two calls */
+size_t gdb_if_rx_count(void);
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+/* Serve GDB over an already connected socket (or none, given -1), as the benchmarks do over a socketpair() */
+void gdb_if_attach(int socket);
+#endif
+
 #if HOSTED_BMP_ONLY == 1
 bool device_is_bmp_gdb_port(const char *device);
 #else
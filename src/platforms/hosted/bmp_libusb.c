@@ -475,14 +475,21 @@ static bool process_vid_pid_table_probe(
 	return true;
 }
 
-static const probe_info_s *scan_for_devices(bmda_probe_s *info)
+/* Describe where a USB device is attached as BUS:ADDRESS, the form -L takes */
+static void probe_location(libusb_device *const device, char *const location, const size_t length)
+{
+	snprintf(location, length, "%u:%u", libusb_get_bus_number(device), libusb_get_device_address(device));
+}
+
+/* Scan for probes, limited to the one at the given location if that's not NULL */
+static const probe_info_s *scan_for_devices(bmda_probe_s *info, const char *const location)
 {
 	/*
 	 * If we are running on Windows the proprietary FTD2XX library is used
-	 * to collect debugger information.
+	 * to collect debugger information. It can't tell us where the probes are attached
 	 */
 #if defined(_WIN32) || defined(__CYGWIN__)
-	probe_info_s *probe_list = process_ftdi_probe();
+	probe_info_s *probe_list = location ? NULL : process_ftdi_probe();
 	const bool skip_ftdi = probe_list != NULL;
 #else
 	probe_info_s *probe_list = NULL;
@@ -496,6 +503,11 @@ static const probe_info_s *scan_for_devices(bmda_probe_s *info)
 	/* Parse the list of USB devices found */
 	for (size_t device_index = 0; device_list[device_index]; ++device_index) {
 		libusb_device *const device = device_list[device_index];
+		char device_location[16U];
+		probe_location(device, device_location, sizeof(device_location));
+		/* Leave every other device alone when we're after the one probe, so we don't open them all */
+		if (location && strcmp(device_location, location) != 0)
+			continue;
 		libusb_device_descriptor_s device_descriptor;
 		const int result = libusb_get_device_descriptor(device, &device_descriptor);
 		if (result < 0) {
@@ -503,8 +515,12 @@ static const probe_info_s *scan_for_devices(bmda_probe_s *info)
 			return NULL;
 		}
 		if (device_descriptor.idVendor != VENDOR_ID_FTDI || !skip_ftdi) {
+			const probe_info_s *const previous = probe_list;
 			if (!process_vid_pid_table_probe(&device_descriptor, device, &probe_list))
 				process_cmsis_interface_probe(&device_descriptor, device, &probe_list, info);
+			/* If that found a probe, it's now at the head of the list */
+			if (probe_list != previous)
+				probe_list->location = strdup(device_location);
 		}
 	}
 	libusb_free_device_list(device_list, (int)cnt);
@@ -522,8 +538,8 @@ int find_debuggers(bmda_cli_options_s *cl_opts, bmda_probe_s *info)
 		return -1;
 	}
 
-	/* Scan for all possible probes on the system */
-	const probe_info_s *probe_list = scan_for_devices(info);
+	/* Scan for all possible probes on the system, or just the one at the location given */
+	const probe_info_s *probe_list = scan_for_devices(info, cl_opts->opt_location);
 	if (!probe_list) {
 		DEBUG_WARN("No probes found\n");
 		return -1;
@@ -567,6 +583,26 @@ int find_debuggers(bmda_cli_options_s *cl_opts, bmda_probe_s *info)
 	return 0; // true;
 }
 
+const probe_info_s *probe_info_scan(bmda_probe_s *const info)
+{
+	const int result = libusb_init(&info->libusb_ctx);
+	if (result != LIBUSB_SUCCESS) {
+		DEBUG_ERROR("Failed to initialise libusb (%d): %s\n", result, libusb_error_name(result));
+		info->libusb_ctx = NULL;
+		return NULL;
+	}
+	return scan_for_devices(info, NULL);
+}
+
+void probe_info_scan_free(bmda_probe_s *const info, const probe_info_s *const list)
+{
+	/* The list holds references to the devices, so it has to go before the context they belong to */
+	probe_info_list_free(list);
+	if (info->libusb_ctx)
+		libusb_exit(info->libusb_ctx);
+	info->libusb_ctx = NULL;
+}
+
 /*
  * Transfer data back and forth with the debug adaptor.
  *
@@ -31,6 +31,7 @@
 #include "remote/protocol_v2.h"
 #include "remote/protocol_v3.h"
 #include "remote/protocol_v4.h"
+#include "remote/protocol_v5.h"
 
 #ifndef _MSC_VER
 #include <sys/time.h>
@@ -100,6 +101,10 @@ bool remote_init(const bool power_up)
 			if (!remote_v4_init())
 				return false;
 			break;
+		case 5:
+			if (!remote_v5_init())
+				return false;
+			break;
 		default:
 			DEBUG_ERROR("Unknown remote protocol version %" PRIu64 ", aborting\n", version);
 			return false;
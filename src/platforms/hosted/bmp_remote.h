@@ -49,6 +49,8 @@ extern bmp_remote_protocol_s remote_funcs;
 
 bool platform_buffer_write(const void *data, size_t size);
 int platform_buffer_read(void *data, size_t size);
+/* Read a binary response frame's payload, returning its length or a negative error */
+int platform_buffer_read_frame(void *data, size_t size);
 
 bool remote_init(bool power_up);
 bool remote_swd_init(void);
@@ -55,6 +55,18 @@ int find_debuggers(bmda_cli_options_s *cl_opts, bmda_probe_s *info)
 	(void)info;
 	return -1;
 }
+
+const probe_info_s *probe_info_scan(bmda_probe_s *const info)
+{
+	(void)info;
+	return NULL;
+}
+
+void probe_info_scan_free(bmda_probe_s *const info, const probe_info_s *const list)
+{
+	(void)info;
+	probe_info_list_free(list);
+}
 #elif defined(__WIN32__) || defined(__CYGWIN__)
 
 /* This source has been used as an example:
@@ -294,7 +306,8 @@ static probe_info_s *parse_device_node(const char *name, probe_info_s *probe_lis
 	return probe_info_add_by_serial(probe_list, PROBE_TYPE_BMP, type, product, serial, version);
 }
 
-static const probe_info_s *scan_for_devices(void)
+/* Scan for probes, limited to the one with the given /dev/serial/by-id name if that's not NULL */
+static const probe_info_s *scan_for_devices(const char *const location)
 {
 	DIR *dir = opendir(DEVICE_BY_ID);
 	if (!dir) /* /dev/serial/by-id is unavailable */
@@ -304,6 +317,8 @@ static const probe_info_s *scan_for_devices(void)
 		const dirent_s *const entry = readdir(dir);
 		if (entry == NULL)
 			break;
+		if (location && strcmp(entry->d_name, location) != 0)
+			continue;
 		if (device_is_bmp_gdb_port(entry->d_name)) {
 			probe_info_s *probe_info = parse_device_node(entry->d_name, probe_list);
 			/* If the operation would have succeeded but probe_info_add_by_serial fails, we exhausted memory. */
@@ -315,6 +330,8 @@ static const probe_info_s *scan_for_devices(void)
 			/* If the operation returned the probe_list unchanged, it failed to parse the node */
 			if (probe_info == probe_list)
 				DEBUG_ERROR("Error parsing device name \"%s\"\n", entry->d_name);
+			else
+				probe_info->location = strdup(entry->d_name);
 			probe_list = probe_info;
 		}
 	}
@@ -326,8 +343,8 @@ int find_debuggers(bmda_cli_options_s *cl_opts, bmda_probe_s *info)
 {
 	if (cl_opts->opt_device)
 		return 1;
-	/* Scan for all possible probes on the system */
-	const probe_info_s *const probe_list = scan_for_devices();
+	/* Scan for all possible probes on the system, or just the one at the location given */
+	const probe_info_s *const probe_list = scan_for_devices(cl_opts->opt_location);
 	if (!probe_list) {
 		DEBUG_ERROR("No BMP probe found\n");
 		return -1;
@@ -357,4 +374,16 @@ int find_debuggers(bmda_cli_options_s *cl_opts, bmda_probe_s *info)
 	probe_info_list_free(probe_list);
 	return 0; // true;
 }
+
+const probe_info_s *probe_info_scan(bmda_probe_s *const info)
+{
+	(void)info;
+	return scan_for_devices(NULL);
+}
+
+void probe_info_scan_free(bmda_probe_s *const info, const probe_info_s *const list)
+{
+	(void)info;
+	probe_info_list_free(list);
+}
 #endif
@@ -34,6 +34,9 @@
 #include <io.h>
 #include <windows.h>
 #define BMDA_NORMAL_MODE _S_IWRITE | _S_IREAD
+#ifndef STDOUT_FILENO
+#define STDOUT_FILENO 1
+#endif
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
@@ -43,15 +46,48 @@
 #define BMDA_NORMAL_MODE S_IRUSR | S_IWUSR
 #endif
 
+/* MSVC has no pthreads, so there the Flash read writes its buffers out in line instead */
+#ifndef _MSC_VER
+#include <pthread.h>
+#define BMDA_THREADED_READ
+#endif
+
 #include "version.h"
 #include "target_internal.h"
 #include "cortexm.h"
 #include "command.h"
 #include "cli.h"
 #include "bmp_hosted.h"
+#include "bench.h"
+#include "image.h"
 
 typedef struct option getopt_option_s;
 
+/* The read side of --read fills a ring of buffers while a writer thread drains them to the file */
+#define READ_RING_SLOTS 4U
+/* How many of the adaptor's largest reads go into each buffer, and the bounds on the result */
+#define READ_CHUNK_TRANSFERS 64U
+#define READ_CHUNK_MIN       0x1000U
+#define READ_CHUNK_MAX       0x100000U
+/* Verification of sparse images reads back and compares in chunks of this size */
+#define IMAGE_VERIFY_CHUNK 0x1000U
+
+typedef struct read_pipeline {
+#ifdef BMDA_THREADED_READ
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+#endif
+	int file;
+	const char *file_name;
+	uint8_t *buffers[READ_RING_SLOTS];
+	size_t lengths[READ_RING_SLOTS];
+	/* Counts of the buffers handed to the writer and that it has finished with */
+	size_t filled;
+	size_t written;
+	bool done;
+	bool failed;
+} read_pipeline_s;
+
 static void cl_target_printf(target_controller_s *tc, const char *fmt, va_list ap)
 {
 	(void)tc;
@@ -129,6 +165,12 @@ static void bmp_munmap(mmap_data_s *map)
 #endif
 }
 
+#define BMDA_SIM_DEFAULT_LINK "usb-hs"
+
+/* Halt poll interval bounds while the target runs, in ms */
+#define BMDA_POLL_MIN_DEFAULT 1U
+#define BMDA_POLL_MAX_DEFAULT 16U
+
 #ifdef ENABLE_GPIOD
 #define GPIOD_PROBE_SELECTION " | -g GPIO_MAPPING"
 #define GPIOD_PROBE_SELECTION_HELP                                          \
@@ -144,8 +186,8 @@ static void cl_help(char **argv)
 	bmp_ident(NULL);
 	/* clang-format off */
 	DEBUG_INFO("\n"
-			   "Usage: %s [-h | -l | [-v BITMASK] [-O] [-d PATH | -P NUMBER | -s SERIAL | -c TYPE]\n"
-			   "\t[-n NUMBER] [-j | -A] [-C] [-t | -T] [-e] [-p] [-R[h]] [-H] [-M STRING ...]\n"
+			   "Usage: %s [-h | -l | [-v BITMASK] [-O] [-d PATH | -P NUMBER | -s SERIAL | -c TYPE | -x[LINK]]\n"
+			   "\t[-n NUMBER] [-j | -A] [-C] [-t | -T | -b] [-e] [-p] [-R[h]] [-H] [-k FILE] [-M STRING ...]\n"
 			   "\t[-f | -m] [-E | -w | -V | -r] [-a ADDR] [-S number] [file]]\n"
 			   "\n"
 			   "The default is to start a debug server at localhost:2000\n\n"
@@ -157,17 +199,27 @@ static void cl_help(char **argv)
 			   "\t-O, --no-stdout  Don't use stdout for debugging output, making it available\n"
 			   "\t                   for use by RTT, Semihosting, or other target output\n"
 			   "\n"
-			   "Probe selection arguments [-d PATH | -P NUMBER | -s SERIAL | -c TYPE" GPIOD_PROBE_SELECTION "]:\n"
+			   "Probe selection arguments [-d PATH | -P NUMBER | -s SERIAL | -L LOCATION | -G LIST | -c TYPE | -x[LINK]"
+			   GPIOD_PROBE_SELECTION "]:\n"
 			   "\t-d, --device     Use a serial device at the given path\n"
 			   "\t-P, --probe      Use the <number>th debug probe found while scanning the\n"
 			   "\t                   system, see the output from list for the order\n"
 			   "\t-s, --serial     Select the debug probe with the given serial number\n"
+			   "\t-L, --location   Select the debug probe at the given location without opening\n"
+			   "\t                   any others: BUS:ADDRESS on USB, or the /dev/serial/by-id\n"
+			   "\t                   name in BMP only builds\n"
+			   "\t-G, --gang       Run the Flash operation on every probe in the given comma\n"
+			   "\t                   separated list of serial numbers, or in the file named by\n"
+			   "\t                   @FILE (one per line), concurrently and report the results\n"
 			   "\t-c, --ftdi-type  Select the FTDI-based debug probe with of the given\n"
 			   "\t                   type (cable)\n"
+			   "\t-x, --sim        Use the built-in simulated probe and STM32F103 target over\n"
+			   "\t                   the given link model: usb-fs, usb-hs (default), tcp or\n"
+			   "\t                   none. Append :US to override the round trip time\n"
 			   GPIOD_PROBE_SELECTION_HELP
 			   "\n"
-			   "General configuration options: [-n NUMBER] [-j] [-C] [-t | -T] [-e] [-p] [-R[h]]\n"
-			   "\t\t[-H] [-M STRING ...]\n"
+			   "General configuration options: [-n NUMBER] [-j] [-C] [-t | -T | -b] [-e] [-p] [-R[h]]\n"
+			   "\t\t[-F | -i MIN[:MAX]] [-H] [-k FILE] [-M STRING ...]\n"
 			   "\t-n, --number     Select the target device at the given position in the\n"
 			   "\t                   scan chain (use the -t option to get a scan chain listing)\n"
 			   "\t-j, --jtag       Use JTAG instead of SWD\n"
@@ -175,16 +227,25 @@ static void cl_help(char **argv)
 			   "\t-C, --hw-reset   Connect to target under hardware reset\n"
 			   "\t-F, --fast-poll  Poll the target for execution status at maximum speed at\n"
 			   "\t                  the expense of increased CPU and USB resource utilisation.\n"
+			   "\t-i, --poll-interval Poll the target for execution status MIN ms after it was\n"
+			   "\t                   resumed, backing off to every MAX ms while it keeps running\n"
+			   "\t                   (default 1:16). Input from GDB is always handled at once\n"
 			   "\t-t, --list-chain Perform a chain scan and display information about the\n"
 			   "\t                   connected devices\n"
 			   "\t-T, --timing     Perform continues read- or write-back of a value to allow\n"
 			   "\t                   measurement of protocol timing. Aborted by ^C\n"
+			   "\t-b, --bench      Run the benchmark suite against the simulated probe (implies\n"
+			   "\t                   -x), writing the results as JSON to the given file or\n"
+			   "\t                   stdout. The simulated Flash is overwritten\n"
 			   "\t-e, --ext-res    Assume external resistors for FTDI devices, that is having the\n"
 			   "\t                   FTDI chip connected through resistors to TMS, TDI and TDO\n"
 			   "\t-p, --power      Power the target from the probe (if possible)\n"
 			   "\t-R, --reset      Reset the device. If followed by 'h', this will be done using\n"
 			   "\t                   the hardware reset line instead of over the debug link\n"
 			   "\t-H, --high-level Do not use the high level command API (bmp-remote)\n"
+			   "\t-k, --id-cache   Keep what target scans identify in the given file, so later\n"
+			   "\t                   scans of the same parts skip the ROM table walk and go\n"
+			   "\t                   straight to the matching driver\n"
 			   "\t-M, --monitor    Run target-specific monitor commands. This option\n"
 			   "\t                   can be repeated for as many commands you wish to run.\n"
 			   "\t                   If the command contains spaces, use quotes around the\n"
@@ -202,12 +263,17 @@ static void cl_help(char **argv)
 			   "\t                   binary file\n"
 			   "\t-r, --read       Read the target device Flash\n"
 			   "\n"
-			   "Flash operation modifiers options: [-a ADDR] [-S number] [FILE]\n"
+			   "Flash operation modifiers options: [-a ADDR] [-S number] [-B] [FILE]\n"
 			   "\t-a, --addr       Start address for the given Flash operation (defaults to\n"
 			   "\t                   the start of Flash)\n"
 			   "\t-S, --byte-count Number of bytes to work on in the Flash operation (default\n"
 			   "\t                   is till the operation fails or is complete)\n"
-			   "\t<file>           Binary file to use in Flash operations\n",
+			   "\t-B, --binary     Treat the file as a flat binary whatever it looks like\n"
+			   "\t<file>           File to use in Flash operations, or - to read the Flash out\n"
+			   "\t                   to stdout (use with -O). Writes and verifies take ELF,\n"
+			   "\t                   Intel HEX and S-record images, only touching the ranges\n"
+			   "\t                   they populate (-a and -S can't be used with them), or\n"
+			   "\t                   otherwise a flat binary\n",
 		argv[0]);
 	/* clang-format on */
 	exit(0);
@@ -221,8 +287,10 @@ static const getopt_option_s long_options[] = {
 	{"device", required_argument, NULL, 'd'},
 	{"probe", required_argument, NULL, 'P'},
 	{"serial", required_argument, NULL, 's'},
+	{"location", required_argument, NULL, 'L'},
 	{"ftdi-type", required_argument, NULL, 'c'},
 	{"fast-poll", no_argument, NULL, 'F'},
+	{"poll-interval", required_argument, NULL, 'i'},
 	{"number", required_argument, NULL, 'n'},
 	{"jtag", no_argument, NULL, 'j'},
 	{"auto-scan", no_argument, NULL, 'A'},
@@ -242,6 +310,11 @@ static const getopt_option_s long_options[] = {
 	{"read", no_argument, NULL, 'r'},
 	{"addr", required_argument, NULL, 'a'},
 	{"byte-count", required_argument, NULL, 'S'},
+	{"binary", no_argument, NULL, 'B'},
+	{"sim", optional_argument, NULL, 'x'},
+	{"bench", no_argument, NULL, 'b'},
+	{"gang", required_argument, NULL, 'G'},
+	{"id-cache", required_argument, NULL, 'k'},
 #ifdef ENABLE_GPIOD
 	{"gpiod", required_argument, NULL, 'g'},
 #endif
@@ -254,6 +327,19 @@ static const getopt_option_s long_options[] = {
 #define GPIOD_ARG_STR
 #endif
 
+/* Parse one of -i's intervals, a plain decimal number of ms that must be at least 1 */
+static bool cl_parse_poll_interval(const char *const text, char **const end, uint32_t *const interval)
+{
+	if (!isdigit((unsigned char)text[0]))
+		return false;
+	errno = 0;
+	const unsigned long value = strtoul(text, end, 10);
+	if (errno || value < 1U || value > UINT32_MAX)
+		return false;
+	*interval = (uint32_t)value;
+	return true;
+}
+
 void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 {
 	opt->opt_target_dev = 1;
@@ -262,9 +348,11 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 	opt->opt_max_frequency = 0;
 	opt->opt_scanmode = BMP_SCAN_SWD;
 	opt->opt_mode = BMP_MODE_DEBUG;
+	opt->opt_poll_min = BMDA_POLL_MIN_DEFAULT;
+	opt->opt_poll_max = BMDA_POLL_MAX_DEFAULT;
 	while (true) {
-		const int option =
-			getopt_long(argc, argv, "eEFhHv:Od:f:s:I:c:Cln:m:M:wVtTa:S:jApP:rR::" GPIOD_ARG_STR, long_options, NULL);
+		const int option = getopt_long(
+			argc, argv, "eEFi:hHv:Od:f:s:L:I:c:Cln:m:M:wVtTa:S:BjApP:rR::x::bG:k:" GPIOD_ARG_STR, long_options, NULL);
 		if (option == -1)
 			break;
 
@@ -321,6 +409,24 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 		case 'F':
 			opt->fast_poll = true;
 			break;
+		case 'i':
+			if (optarg) {
+				char *end = NULL;
+				bool valid = cl_parse_poll_interval(optarg, &end, &opt->opt_poll_min);
+				if (valid && *end == ':')
+					valid = cl_parse_poll_interval(end + 1U, &end, &opt->opt_poll_max);
+				else
+					opt->opt_poll_max = opt->opt_poll_min;
+				if (!valid || *end) {
+					DEBUG_ERROR("Value after poll interval flag was not MIN[:MAX] in ms of at least 1, got '%s'\n",
+						optarg);
+					exit(1);
+				}
+				/* Never let the backoff go below where it starts */
+				if (opt->opt_poll_max < opt->opt_poll_min)
+					opt->opt_poll_max = opt->opt_poll_min;
+			}
+			break;
 		case 'f':
 			if (optarg) {
 				char *p;
@@ -340,6 +446,10 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 			if (optarg)
 				opt->opt_serial = optarg;
 			break;
+		case 'L':
+			if (optarg)
+				opt->opt_location = optarg;
+			break;
 		case 'I':
 			if (optarg)
 				opt->opt_ident_string = optarg;
@@ -394,6 +504,10 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 			if (optarg)
 				opt->opt_monitor = optarg;
 			break;
+		case 'k':
+			if (optarg)
+				opt->opt_id_cache = optarg;
+			break;
 		case 'P':
 			if (optarg)
 				opt->opt_position = strtol(optarg, NULL, 0);
@@ -416,6 +530,19 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 				}
 			}
 			break;
+		case 'B':
+			opt->opt_flash_binary = true;
+			break;
+		case 'x':
+			opt->opt_sim = optarg ? optarg : BMDA_SIM_DEFAULT_LINK;
+			break;
+		case 'b':
+			opt->opt_mode = BMP_MODE_BENCH;
+			break;
+		case 'G':
+			if (optarg)
+				opt->opt_gang = optarg;
+			break;
 #ifdef ENABLE_GPIOD
 		case 'g':
 			if (optarg)
@@ -429,6 +556,14 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 		opt->opt_flash_file = argv[optind];
 	} else if (opt->opt_mode == BMP_MODE_DEBUG && opt->opt_monitor)
 		opt->opt_mode = BMP_MODE_MONITOR; // To avoid DEBUG mode
+	if (opt->opt_mode == BMP_MODE_BENCH) {
+		/* The benchmarks only ever run against the simulator */
+		if (!opt->opt_sim)
+			opt->opt_sim = BMDA_SIM_DEFAULT_LINK;
+		/* And when their results go to stdout, keep everything else off it so they stay valid JSON */
+		if (!opt->opt_flash_file)
+			bmda_debug_flags |= BMD_DEBUG_USE_STDERR;
+	}
 
 	/* Checks */
 	if (opt->opt_flash_file &&
@@ -466,6 +601,279 @@ bool scan_for_targets(const bmda_cli_options_s *const opt)
 	return false;
 }
 
+static bool read_pipeline_write(read_pipeline_s *const pipeline, const uint8_t *data, size_t length)
+{
+	while (length) {
+		const ssize_t written = write(pipeline->file, data, length);
+		if (written < 0) {
+			const int error = errno;
+			if (error == EINTR)
+				continue;
+			DEBUG_ERROR("Write to %s failed (%d): %s\n", pipeline->file_name, error, strerror(error));
+			return false;
+		}
+		data += written;
+		length -= (size_t)written;
+	}
+	return true;
+}
+
+#ifdef BMDA_THREADED_READ
+static void *read_pipeline_writer(void *const context)
+{
+	read_pipeline_s *const pipeline = (read_pipeline_s *)context;
+	pthread_mutex_lock(&pipeline->lock);
+	while (true) {
+		while (pipeline->written == pipeline->filled && !pipeline->done)
+			pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+		/* Only stop once everything read has been written out */
+		if (pipeline->written == pipeline->filled)
+			break;
+		const size_t slot = pipeline->written % READ_RING_SLOTS;
+		pthread_mutex_unlock(&pipeline->lock);
+		const bool ok = read_pipeline_write(pipeline, pipeline->buffers[slot], pipeline->lengths[slot]);
+		pthread_mutex_lock(&pipeline->lock);
+		if (!ok)
+			pipeline->failed = true;
+		else
+			++pipeline->written;
+		pthread_cond_signal(&pipeline->changed);
+		if (!ok)
+			break;
+	}
+	pthread_mutex_unlock(&pipeline->lock);
+	return NULL;
+}
+#endif
+
+/* Wait for a free buffer in the ring, returning its slot, or false if the writer has failed */
+static bool read_pipeline_claim(read_pipeline_s *const pipeline, size_t *const slot)
+{
+#ifdef BMDA_THREADED_READ
+	pthread_mutex_lock(&pipeline->lock);
+	while (pipeline->filled - pipeline->written == READ_RING_SLOTS && !pipeline->failed)
+		pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+	const bool ok = !pipeline->failed;
+	pthread_mutex_unlock(&pipeline->lock);
+#else
+	const bool ok = !pipeline->failed;
+#endif
+	*slot = pipeline->filled % READ_RING_SLOTS;
+	return ok;
+}
+
+static void read_pipeline_submit(read_pipeline_s *const pipeline, const size_t slot, const size_t length)
+{
+#ifdef BMDA_THREADED_READ
+	pthread_mutex_lock(&pipeline->lock);
+	pipeline->lengths[slot] = length;
+	++pipeline->filled;
+	pthread_cond_signal(&pipeline->changed);
+	pthread_mutex_unlock(&pipeline->lock);
+#else
+	++pipeline->filled;
+	if (read_pipeline_write(pipeline, pipeline->buffers[slot], length))
+		++pipeline->written;
+	else
+		pipeline->failed = true;
+#endif
+}
+
+/* How many bytes of the given range the target's Flash regions cover between them */
+static uint64_t cl_flash_coverage(const target_s *const target, const uint32_t address, const size_t length)
+{
+	const uint64_t end = (uint64_t)address + length;
+	uint64_t covered = 0;
+	for (const target_flash_s *flash = target->flash; flash; flash = flash->next) {
+		const uint64_t start = MAX((uint64_t)flash->start, (uint64_t)address);
+		const uint64_t stop = MIN((uint64_t)flash->start + flash->length, end);
+		if (stop > start)
+			covered += stop - start;
+	}
+	return covered;
+}
+
+static bool cl_image_segment_in_flash(const target_s *const target, const image_segment_s *const segment)
+{
+	return cl_flash_coverage(target, segment->address, segment->length) == segment->length;
+}
+
+/* Segments wholly outside Flash are skipped, but one that's only partly in it can't be programmed */
+static bool cl_image_check_flash(const target_s *const target, const image_s *const image)
+{
+	for (size_t i = 0; i < image->segment_count; ++i) {
+		const image_segment_s *const segment = &image->segments[i];
+		const uint64_t covered = cl_flash_coverage(target, segment->address, segment->length);
+		if (covered && covered != segment->length) {
+			DEBUG_ERROR("Image data at 0x%08" PRIx32 " for %zu bytes is only partly in Flash\n", segment->address,
+				segment->length);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Program just the populated ranges of a sparse image, erasing only the Flash blocks they touch */
+static bool cl_flash_write_image(target_s *const target, const image_s *const image)
+{
+	const uint32_t start_time = platform_time_ms();
+	/*
+	 * Erase everything up front as neighbouring segments can share a block, tracking the end of
+	 * the last block erased so no block is erased twice.
+	 */
+	uint64_t erased_end = 0;
+	for (size_t i = 0; i < image->segment_count; ++i) {
+		const image_segment_s *const segment = &image->segments[i];
+		if (!cl_image_segment_in_flash(target, segment)) {
+			DEBUG_WARN("Skipping %zu bytes at 0x%08" PRIx32 " as they are not in Flash\n", segment->length,
+				segment->address);
+			continue;
+		}
+		const uint64_t end = (uint64_t)segment->address + segment->length;
+		const uint64_t start = MAX(segment->address, erased_end);
+		if (start >= end)
+			continue;
+		DEBUG_INFO("Erasing %" PRIu64 " bytes at 0x%08" PRIx64 "\n", end - start, start);
+		if (!target_flash_erase(target, (target_addr_t)start, (size_t)(end - start))) {
+			DEBUG_ERROR("Flash erase failed!\n");
+			return false;
+		}
+		const target_flash_s *const flash = target_flash_for_addr(target, (uint32_t)(end - 1U));
+		erased_end = flash ? ((end - 1U) & ~(uint64_t)(flash->blocksize - 1U)) + flash->blocksize : end;
+	}
+
+	size_t written = 0;
+	for (size_t i = 0; i < image->segment_count; ++i) {
+		const image_segment_s *const segment = &image->segments[i];
+		if (!cl_image_segment_in_flash(target, segment))
+			continue;
+		DEBUG_INFO("Flashing %zu bytes at 0x%08" PRIx32 "\n", segment->length, segment->address);
+		if (!target_flash_write(target, segment->address, segment->data, segment->length)) {
+			DEBUG_ERROR("Flashing failed!\n");
+			target_flash_complete(target);
+			return false;
+		}
+		written += segment->length;
+	}
+	if (!target_flash_complete(target)) {
+		DEBUG_ERROR("Flashing failed!\n");
+		return false;
+	}
+	const uint32_t end_time = platform_time_ms();
+	DEBUG_WARN("Flash Write succeeded for %zu bytes, %8.3fkiB/s\n", written, (double)written / (end_time - start_time));
+	return true;
+}
+
+static bool cl_flash_verify_image(target_s *const target, const image_s *const image)
+{
+	uint8_t data[IMAGE_VERIFY_CHUNK];
+	size_t bytes_read = 0;
+	const uint32_t start_time = platform_time_ms();
+	for (size_t i = 0; i < image->segment_count; ++i) {
+		const image_segment_s *const segment = &image->segments[i];
+		if (!cl_image_segment_in_flash(target, segment))
+			continue;
+		for (size_t offset = 0; offset < segment->length; offset += IMAGE_VERIFY_CHUNK) {
+			const size_t amount = MIN(segment->length - offset, IMAGE_VERIFY_CHUNK);
+			const uint32_t address = segment->address + offset;
+			if (target_mem32_read(target, data, address, amount)) {
+				DEBUG_ERROR("Read failed at flash address 0x%08" PRIx32 "\n", address);
+				return false;
+			}
+			if (memcmp(data, segment->data + offset, amount) != 0) {
+				DEBUG_ERROR("Verify failed at flash region 0x%08" PRIx32 "\n", address);
+				return false;
+			}
+			bytes_read += amount;
+		}
+	}
+	const uint32_t end_time = platform_time_ms();
+	DEBUG_WARN("Read/Verify succeeded for %zu bytes, %8.3fkiB/s\n", bytes_read,
+		(double)bytes_read / (end_time - start_time));
+	return true;
+}
+
+/* Read the requested Flash range out to the file, overlapping the probe reads with the file writes */
+static int cl_flash_read(const bmda_cli_options_s *const opt, target_s *const target, const int file)
+{
+	/* Make each buffer a whole number of TAR blocks covering many of the adaptor's largest reads */
+	const size_t chunk =
+		MIN(MAX((bmda_max_mem_read() * READ_CHUNK_TRANSFERS) & ~(size_t)0x3ffU, READ_CHUNK_MIN), READ_CHUNK_MAX);
+	uint8_t *const buffer = malloc(chunk * READ_RING_SLOTS);
+	if (!buffer) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return -1;
+	}
+	read_pipeline_s pipeline = {
+		.file = file,
+		.file_name = opt->opt_flash_file,
+	};
+	for (size_t slot = 0; slot < READ_RING_SLOTS; ++slot)
+		pipeline.buffers[slot] = buffer + slot * chunk;
+#ifdef BMDA_THREADED_READ
+	pthread_mutex_init(&pipeline.lock, NULL);
+	pthread_cond_init(&pipeline.changed, NULL);
+	pthread_t writer;
+	if (pthread_create(&writer, NULL, read_pipeline_writer, &pipeline) != 0) {
+		DEBUG_ERROR("Could not start the file writer thread\n");
+		pthread_cond_destroy(&pipeline.changed);
+		pthread_mutex_destroy(&pipeline.lock);
+		free(buffer);
+		return -1;
+	}
+#endif
+
+	DEBUG_INFO("Reading flash from 0x%08" PRIx32 " for %zu bytes to %s in %zu byte chunks\n", opt->opt_flash_start,
+		opt->opt_flash_size, opt->opt_flash_file, chunk);
+	const uint32_t flash_src = opt->opt_flash_start;
+	const size_t size = opt->opt_flash_size;
+	size_t bytes_read = 0;
+	const uint32_t start_time = platform_time_ms();
+	for (size_t offset = 0; offset < size; offset += chunk) {
+		size_t slot;
+		if (!read_pipeline_claim(&pipeline, &slot))
+			break;
+		const size_t amount = MIN(size - offset, chunk);
+		if (target_mem32_read(target, pipeline.buffers[slot], flash_src + offset, amount)) {
+			/* Salvage what can be read of the chunk in smaller pieces, so the dump runs up to the failure */
+			size_t valid = 0;
+			while (valid < amount) {
+				const size_t piece = MIN(amount - valid, READ_CHUNK_MIN);
+				if (target_mem32_read(target, pipeline.buffers[slot] + valid, flash_src + offset + valid, piece))
+					break;
+				valid += piece;
+			}
+			if (valid) {
+				read_pipeline_submit(&pipeline, slot, valid);
+				bytes_read += valid;
+			}
+			if (opt->opt_flash_size == 0) /* we reached end of flash */
+				DEBUG_INFO("Reached end of flash at size %zu\n", bytes_read);
+			else
+				DEBUG_ERROR("Read failed at flash address 0x%08" PRIx32 "\n", (uint32_t)(flash_src + bytes_read));
+			break;
+		}
+		read_pipeline_submit(&pipeline, slot, amount);
+		bytes_read += amount;
+	}
+
+#ifdef BMDA_THREADED_READ
+	pthread_mutex_lock(&pipeline.lock);
+	pipeline.done = true;
+	pthread_cond_signal(&pipeline.changed);
+	pthread_mutex_unlock(&pipeline.lock);
+	pthread_join(writer, NULL);
+	pthread_cond_destroy(&pipeline.changed);
+	pthread_mutex_destroy(&pipeline.lock);
+#endif
+	const uint32_t end_time = platform_time_ms();
+	free(buffer);
+	if (pipeline.failed)
+		return -1;
+	DEBUG_WARN("Read succeeded for %zu bytes, %8.3fkiB/s\n", bytes_read, (double)bytes_read / (end_time - start_time));
+	return 0;
+}
+
 int cl_execute(bmda_cli_options_s *opt)
 {
 	if (opt->opt_mode == BMP_MODE_RESET_HW) {
@@ -542,6 +950,8 @@ int cl_execute(bmda_cli_options_s *opt)
 		}
 	}
 
+	/* Note if an address or size was given before filling in the defaults, as images can't take them */
+	const bool flash_range_given = opt->opt_flash_start != 0xffffffffU || opt->opt_flash_size != 0xffffffffU;
 	if (opt->opt_flash_start == 0xffffffffU)
 		opt->opt_flash_start = lowest_flash_start;
 	if (opt->opt_flash_size == 0xffffffffU && opt->opt_mode != BMP_MODE_FLASH_WRITE &&
@@ -563,10 +973,15 @@ int cl_execute(bmda_cli_options_s *opt)
 		} else
 			DEBUG_ERROR("No test for this core type yet\n");
 	}
+	if (opt->opt_mode == BMP_MODE_BENCH) {
+		res = bench_run(target, opt->opt_flash_file);
+		goto target_detach;
+	}
 	if (opt->opt_mode == BMP_MODE_TEST || opt->opt_mode == BMP_MODE_SWJ_TEST)
 		goto target_detach;
 
 	mmap_data_s map = {0};
+	image_s image = {0};
 	if (opt->opt_mode == BMP_MODE_FLASH_WRITE || opt->opt_mode == BMP_MODE_FLASH_VERIFY ||
 		opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
 		if (!bmp_mmap(opt->opt_flash_file, &map)) {
@@ -574,9 +989,38 @@ int cl_execute(bmda_cli_options_s *opt)
 			res = -1;
 			goto target_detach;
 		}
+		/* ELF, Intel HEX and S-record images carry their own addresses, anything else is a flat binary */
+		if (!opt->opt_flash_binary && !image_parse(&image, map.data, map.size)) {
+			DEBUG_ERROR("Can not load image %s. Aborting!\n", opt->opt_flash_file);
+			res = -1;
+			goto free_map;
+		}
+		if (image.format != IMAGE_FORMAT_BINARY) {
+			DEBUG_INFO("Loaded %s image with %zu bytes in %zu segments\n", image_format_name(image.format),
+				image_data_length(&image), image.segment_count);
+			if (flash_range_given) {
+				DEBUG_ERROR("-a and -S can't be used with %s images as they carry their own addresses, "
+							"use -B to write the file as a flat binary\n",
+					image_format_name(image.format));
+				res = -1;
+				goto free_map;
+			}
+			if (!cl_image_check_flash(target, &image)) {
+				res = -1;
+				goto free_map;
+			}
+		}
 	} else if (opt->opt_mode == BMP_MODE_FLASH_READ) {
-		/* Open as binary */
-		read_file = open(opt->opt_flash_file, O_TRUNC | O_CREAT | O_RDWR | O_BINARY, BMDA_NORMAL_MODE);
+		if (strcmp(opt->opt_flash_file, "-") == 0) {
+			/* Stream to stdout, using our own descriptor for it so it can be closed like a file */
+			read_file = dup(STDOUT_FILENO);
+#if defined(_WIN32) || defined(__CYGWIN__)
+			if (read_file != -1)
+				_setmode(read_file, O_BINARY);
+#endif
+		} else
+			/* Open as binary */
+			read_file = open(opt->opt_flash_file, O_TRUNC | O_CREAT | O_RDWR | O_BINARY, BMDA_NORMAL_MODE);
 		if (read_file == -1) {
 			DEBUG_ERROR("Error opening flashfile %s for read: %s\n", opt->opt_flash_file, strerror(errno));
 			res = -1;
@@ -601,6 +1045,16 @@ int cl_execute(bmda_cli_options_s *opt)
 			goto free_map;
 		}
 		target_reset(target);
+	} else if (image.format != IMAGE_FORMAT_BINARY &&
+		(opt->opt_mode == BMP_MODE_FLASH_WRITE || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY)) {
+		if (!cl_flash_write_image(target, &image)) {
+			res = -1;
+			goto free_map;
+		}
+		if (opt->opt_mode != BMP_MODE_FLASH_WRITE_VERIFY) {
+			target_reset(target);
+			goto free_map;
+		}
 	} else if (opt->opt_mode == BMP_MODE_FLASH_WRITE || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
 		DEBUG_INFO("Erasing %zu bytes at 0x%08" PRIx32 "\n", map.size, opt->opt_flash_start);
 		const uint32_t start_time = platform_time_ms();
@@ -625,15 +1079,23 @@ int cl_execute(bmda_cli_options_s *opt)
 			goto free_map;
 		}
 	}
-	if (opt->opt_mode == BMP_MODE_FLASH_READ || opt->opt_mode == BMP_MODE_FLASH_VERIFY ||
-		opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
+	if (opt->opt_mode == BMP_MODE_FLASH_READ) {
+		res = cl_flash_read(opt, target, read_file);
+		goto free_map;
+	}
+	if (image.format != IMAGE_FORMAT_BINARY &&
+		(opt->opt_mode == BMP_MODE_FLASH_VERIFY || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY)) {
+		if (!cl_flash_verify_image(target, &image))
+			res = -1;
+		else if (opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY)
+			target_reset(target);
+		goto free_map;
+	}
+	if (opt->opt_mode == BMP_MODE_FLASH_VERIFY || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
 #define WORKSIZE 0x1000U
 		uint8_t data[WORKSIZE];
-		if (opt->opt_mode == BMP_MODE_FLASH_READ)
-			DEBUG_INFO("Reading flash from 0x%08" PRIx32 " for %zu bytes to %s\n", opt->opt_flash_start,
-				opt->opt_flash_size, opt->opt_flash_file);
 		const uint32_t flash_src = opt->opt_flash_start;
-		const size_t size = opt->opt_mode == BMP_MODE_FLASH_READ ? opt->opt_flash_size : map.size;
+		const size_t size = map.size;
 		size_t bytes_read = 0;
 		uint8_t *flash = (uint8_t *)map.data;
 		const uint32_t start_time = platform_time_ms();
@@ -648,36 +1110,20 @@ int cl_execute(bmda_cli_options_s *opt)
 				break;
 			}
 			bytes_read += worksize;
-			if (opt->opt_mode == BMP_MODE_FLASH_VERIFY || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
-				if (memcmp(data, flash + offset, worksize) != 0) {
-					DEBUG_ERROR("Verify failed at flash region 0x%08" PRIx32 "\n", flash_src);
-					res = -1;
-					goto free_map;
-				}
-			} else if (read_file != -1) {
-				const ssize_t written = write(read_file, data, worksize);
-				if (written < 0) {
-					const int error = errno;
-					DEBUG_ERROR("Write to %s failed (%d): %s\n", opt->opt_flash_file, error, strerror(error));
-					res = -1;
-					goto free_map;
-				}
-				if ((size_t)written < worksize) {
-					DEBUG_ERROR("Read failed at flash region 0x%08" PRIx32 "\n", flash_src);
-					res = -1;
-					goto free_map;
-				}
+			if (memcmp(data, flash + offset, worksize) != 0) {
+				DEBUG_ERROR("Verify failed at flash region 0x%08" PRIx32 "\n", flash_src);
+				res = -1;
+				goto free_map;
 			}
 		}
 		const uint32_t end_time = platform_time_ms();
-		if (read_file != -1)
-			close(read_file);
 		DEBUG_WARN("Read/Verify succeeded for %zu bytes, %8.3fkiB/s\n", bytes_read,
 			(double)bytes_read / (end_time - start_time));
 		if (opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY)
 			target_reset(target);
 	}
 free_map:
+	image_free(&image);
 	if (map.size)
 		bmp_munmap(&map);
 target_detach:
@@ -38,6 +38,7 @@ typedef enum bmda_cli_mode {
 	BMP_MODE_FLASH_VERIFY,
 	BMP_MODE_SWJ_TEST,
 	BMP_MODE_MONITOR,
+	BMP_MODE_BENCH,
 } bmda_cli_mode_e;
 
 typedef enum bmp_scan_mode {
@@ -54,10 +55,13 @@ typedef struct bmda_cli_options {
 	bool opt_connect_under_reset;
 	bool external_resistor_swd;
 	bool fast_poll;
+	uint32_t opt_poll_min;
+	uint32_t opt_poll_max;
 	bool opt_no_hl;
 	char *opt_flash_file;
 	char *opt_device;
 	char *opt_serial;
+	char *opt_location;
 	uint32_t opt_targetid;
 	char *opt_ident_string;
 	size_t opt_position;
@@ -67,7 +71,11 @@ typedef struct bmda_cli_options {
 	uint32_t opt_flash_start;
 	uint32_t opt_max_frequency;
 	size_t opt_flash_size;
+	bool opt_flash_binary;
 	char *opt_gpio_map;
+	char *opt_sim;
+	char *opt_gang;
+	char *opt_id_cache;
 } bmda_cli_options_s;
 
 void cl_init(bmda_cli_options_s *opt, int argc, char **argv);
@@ -73,6 +73,8 @@
 #include "target.h"
 
 #define TRANSFER_TIMEOUT_MS (100)
+/* Upper bound on how many request packets we will keep in flight with a bulk adaptor at once */
+#define MAX_PACKETS_IN_FLIGHT 8U
 
 typedef enum cmsis_type {
 	CMSIS_TYPE_NONE = 0,
@@ -106,6 +108,8 @@ static uint8_t buffer[1025U];
  * https://www.keil.com/pack/doc/CMSIS/DAP/html/group__DAP__Config__Debug__gr.html#gaa28bb1da2661291634c4a8fb3e227404
  */
 static size_t packet_size = 64U;
+/* How many packets the adaptor can buffer, and so how many requests we may have in flight at once */
+static size_t packet_count = 1U;
 bool dap_has_swd_sequence = false;
 
 dap_version_s dap_adaptor_version(dap_info_e version_kind);
@@ -166,6 +170,12 @@ static inline size_t dap_max_transfer_data(size_t command_header_len)
 	return result;
 }
 
+/* The most data a single DAP_TransferBlock read can return */
+size_t dap_max_mem_read(void)
+{
+	return dap_max_transfer_data(DAP_CMD_BLOCK_READ_HDR_LEN) & ~3U;
+}
+
 #ifdef __linux__
 static void dap_hid_print_permissions_for(const hid_device_info_s *const dev)
 {
@@ -298,6 +308,15 @@ bool dap_init(void)
 	else
 		packet_size = dap_packet_size + (type == CMSIS_TYPE_HID ? 1U : 0U);
 
+	/* Find out how many packets the adaptor can buffer - only bulk adaptors are driven pipelined */
+	packet_count = 1U;
+	uint8_t dap_packet_count = 0U;
+	if (type == CMSIS_TYPE_BULK &&
+		dap_info(DAP_INFO_PACKET_COUNT, &dap_packet_count, sizeof(dap_packet_count)) == sizeof(dap_packet_count) &&
+		dap_packet_count)
+		packet_count = MIN(dap_packet_count, MAX_PACKETS_IN_FLIGHT);
+	DEBUG_INFO("Adaptor can have %zu packets in flight\n", packet_count);
+
 	/* Try to get the device's capabilities */
 	const size_t size = dap_info(DAP_INFO_CAPABILITIES, &dap_caps, sizeof(dap_caps));
 	if (size != sizeof(dap_caps)) {
@@ -545,6 +564,148 @@ bool dap_run_cmd(const void *const request_data, const size_t request_length, vo
 	return (size_t)result >= response_length;
 }
 
+#define DAP_BULK_SLOT_DATA_LEN 1024U
+
+typedef struct dap_bulk_slot {
+	struct libusb_transfer *request;
+	struct libusb_transfer *response;
+	int request_complete;
+	int response_complete;
+	uint8_t data[DAP_BULK_SLOT_DATA_LEN];
+} dap_bulk_slot_s;
+
+static void LIBUSB_CALL dap_bulk_transfer_complete(struct libusb_transfer *const transfer)
+{
+	*(int *)transfer->user_data = 1;
+}
+
+static void dap_bulk_slot_wait(dap_bulk_slot_s *const slot)
+{
+	while (!slot->request_complete)
+		libusb_handle_events_completed(bmda_probe_info.libusb_ctx, &slot->request_complete);
+	while (!slot->response_complete)
+		libusb_handle_events_completed(bmda_probe_info.libusb_ctx, &slot->response_complete);
+}
+
+static bool dap_bulk_slot_submit(dap_bulk_slot_s *const slot, const dap_queued_cmd_s *const command)
+{
+	/* The responses to later requests have to wait on the earlier ones, so scale the timeout accordingly */
+	const unsigned int timeout = TRANSFER_TIMEOUT_MS * packet_count;
+	libusb_fill_bulk_transfer(slot->request, usb_handle, out_ep, (uint8_t *)command->request,
+		(int)command->request_length, dap_bulk_transfer_complete, &slot->request_complete, timeout);
+	libusb_fill_bulk_transfer(slot->response, usb_handle, in_ep, slot->data, (int)packet_size,
+		dap_bulk_transfer_complete, &slot->response_complete, timeout);
+	slot->request_complete = 0;
+	slot->response_complete = 0;
+
+	int result = libusb_submit_transfer(slot->request);
+	if (result < 0) {
+		DEBUG_ERROR("CMSIS-DAP write error: %s (%d)\n", libusb_strerror(result), result);
+		slot->request_complete = 1;
+		slot->response_complete = 1;
+		return false;
+	}
+	result = libusb_submit_transfer(slot->response);
+	if (result < 0) {
+		DEBUG_ERROR("CMSIS-DAP read error: %s (%d)\n", libusb_strerror(result), result);
+		slot->response_complete = 1;
+		/* Let the request finish before the slot gets reused */
+		dap_bulk_slot_wait(slot);
+		return false;
+	}
+	return true;
+}
+
+static bool dap_bulk_slot_complete(dap_bulk_slot_s *const slot, const dap_queued_cmd_s *const command)
+{
+	dap_bulk_slot_wait(slot);
+	if (slot->request->status != LIBUSB_TRANSFER_COMPLETED || slot->response->status != LIBUSB_TRANSFER_COMPLETED) {
+		DEBUG_ERROR(
+			"CMSIS-DAP pipelined transfer failed (%d, %d)\n", slot->request->status, slot->response->status);
+		return false;
+	}
+	const uint8_t *const request = (const uint8_t *)command->request;
+	const size_t result = (size_t)slot->response->actual_length;
+	/* Responses come back strictly in order, so anything else means we're out of step with the adaptor */
+	if (result == 0U || slot->data[0] != request[0]) {
+		DEBUG_ERROR("CMSIS-DAP pipelined response out of step with request\n");
+		return false;
+	}
+
+	DEBUG_WIRE("response: ");
+	for (size_t i = 0; i < result; i++)
+		DEBUG_WIRE("%02x ", slot->data[i]);
+	DEBUG_WIRE("\n");
+
+	/* As with dap_run_cmd(), strip the command byte and check we got at least as much as was asked for */
+	memcpy(command->response, slot->data + 1U, MIN(command->response_length, result - 1U));
+	return result - 1U >= command->response_length;
+}
+
+/*
+ * Run a queue of commands, keeping as many of them in flight with the adaptor as it can buffer.
+ * Responses are still collected strictly in order. Adaptors that can only handle a single packet
+ * at a time (including all HID adaptors) get the commands run one by one.
+ */
+bool dap_run_cmd_queue(const dap_queued_cmd_s *const commands, const size_t count)
+{
+	if (type != CMSIS_TYPE_BULK || packet_count < 2U || count < 2U || packet_size > DAP_BULK_SLOT_DATA_LEN) {
+		for (size_t idx = 0; idx < count; ++idx) {
+			const dap_queued_cmd_s *const command = &commands[idx];
+			if (!dap_run_cmd(command->request, command->request_length, command->response, command->response_length))
+				return false;
+		}
+		return true;
+	}
+
+	dap_bulk_slot_s slots[MAX_PACKETS_IN_FLIGHT] = {{0}};
+	const size_t depth = packet_count;
+	bool result = true;
+	for (size_t idx = 0; idx < depth; ++idx) {
+		slots[idx].request = libusb_alloc_transfer(0);
+		slots[idx].response = libusb_alloc_transfer(0);
+		if (!slots[idx].request || !slots[idx].response)
+			result = false;
+	}
+
+	size_t submitted = 0U;
+	size_t completed = 0U;
+	while (result && completed < count) {
+		/* Top the pipeline up as far as the adaptor will let us */
+		for (; submitted < count && submitted - completed < depth; ++submitted) {
+			DEBUG_WIRE(" command: ");
+			for (size_t i = 0; i < commands[submitted].request_length; ++i)
+				DEBUG_WIRE("%02x ", ((const uint8_t *)commands[submitted].request)[i]);
+			DEBUG_WIRE("\n");
+			if (!dap_bulk_slot_submit(&slots[submitted % depth], &commands[submitted])) {
+				result = false;
+				break;
+			}
+		}
+		if (!result)
+			break;
+		/* Then collect the oldest outstanding response */
+		result = dap_bulk_slot_complete(&slots[completed % depth], &commands[completed]);
+		++completed;
+	}
+
+	/* If something went wrong, cancel and drain anything still in flight before the slots go away */
+	for (; completed < submitted; ++completed) {
+		dap_bulk_slot_s *const slot = &slots[completed % depth];
+		libusb_cancel_transfer(slot->request);
+		libusb_cancel_transfer(slot->response);
+		dap_bulk_slot_wait(slot);
+	}
+
+	for (size_t idx = 0; idx < depth; ++idx) {
+		libusb_free_transfer(slots[idx].request);
+		libusb_free_transfer(slots[idx].response);
+	}
+	if (!result)
+		DEBUG_ERROR("CMSIS-DAP command queue failed\n");
+	return result;
+}
+
 static void dap_adiv5_mem_read(adiv5_access_port_s *ap, void *dest, target_addr64_t src, size_t len)
 {
 	if (len == 0U)
@@ -569,16 +730,12 @@ static void dap_adiv5_mem_read(adiv5_access_port_s *ap, void *dest, target_addr6
 		 * has requested we fill.
 		 */
 		const size_t chunk_remaining = MIN(1024 - ((src + offset) & 0x3ffU), len - offset);
-		const size_t blocks = chunk_remaining >> align;
-		for (size_t i = 0; i < blocks; i += blocks_per_transfer) {
-			/* blocks - i gives how many blocks are left to transfer in this 1024 byte chunk */
-			const size_t transfer_length = MIN(blocks - i, blocks_per_transfer) << align;
-			if (!dap_mem_read_block(ap, data + offset, src + offset, transfer_length, align)) {
-				DEBUG_WIRE("%s failed: %u\n", __func__, ap->dp->fault);
-				return;
-			}
-			offset += transfer_length;
+		/* Read the whole chunk as one queue of block transfers so they can be pipelined by the adaptor */
+		if (!dap_mem_read_block(ap, data + offset, src + offset, chunk_remaining, align, blocks_per_transfer)) {
+			DEBUG_WIRE("%s failed: %u\n", __func__, ap->dp->fault);
+			return;
 		}
+		offset += chunk_remaining;
 	}
 	DEBUG_WIRE("%s transferred %zu blocks\n", __func__, len >> align);
 }
@@ -650,16 +807,12 @@ static void dap_adiv6_mem_read(
 		 * has requested we fill.
 		 */
 		const size_t chunk_remaining = MIN(1024 - ((src + offset) & 0x3ffU), len - offset);
-		const size_t blocks = chunk_remaining >> align;
-		for (size_t i = 0; i < blocks; i += blocks_per_transfer) {
-			/* blocks - i gives how many blocks are left to transfer in this 1024 byte chunk */
-			const size_t transfer_length = MIN(blocks - i, blocks_per_transfer) << align;
-			if (!dap_mem_read_block(&ap->base, data + offset, src + offset, transfer_length, align)) {
-				DEBUG_WIRE("%s failed: %u\n", __func__, ap->base.dp->fault);
-				return;
-			}
-			offset += transfer_length;
+		/* Read the whole chunk as one queue of block transfers so they can be pipelined by the adaptor */
+		if (!dap_mem_read_block(&ap->base, data + offset, src + offset, chunk_remaining, align, blocks_per_transfer)) {
+			DEBUG_WIRE("%s failed: %u\n", __func__, ap->base.dp->fault);
+			return;
 		}
+		offset += chunk_remaining;
 	}
 	DEBUG_WIRE("%s transferred %zu blocks\n", __func__, len >> align);
 }
@@ -711,6 +864,7 @@ void dap_adiv5_dp_init(adiv5_debug_port_s *target_dp)
 	/* Setup the access functions for this adaptor */
 	target_dp->ap_read = dap_adiv5_ap_read;
 	target_dp->ap_write = dap_adiv5_ap_write;
+	target_dp->batch = dap_dp_batch;
 	target_dp->mem_read = dap_adiv5_mem_read;
 	target_dp->mem_write = dap_adiv5_mem_write;
 }
@@ -720,6 +874,7 @@ void dap_adiv6_dp_init(adiv5_debug_port_s *target_dp)
 	/* Setup the access functions for this adaptor */
 	target_dp->ap_read = dap_adiv6_ap_read;
 	target_dp->ap_write = dap_adiv6_ap_write;
+	target_dp->batch = dap_dp_batch;
 	target_dp->mem_read = dap_adiv6_mem_read;
 	target_dp->mem_write = dap_adiv6_mem_write;
 }
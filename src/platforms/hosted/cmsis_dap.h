@@ -32,6 +32,7 @@ bool dap_jtag_init(void);
 bool dap_swd_init(adiv5_debug_port_s *dp);
 void dap_jtag_dp_init(adiv5_debug_port_s *dp);
 uint32_t dap_max_frequency(uint32_t clock);
+size_t dap_max_mem_read(void);
 void dap_swd_configure(uint8_t cfg);
 void dap_nrst_set_val(bool assert);
 
@@ -40,8 +40,10 @@
 #include "jtag_scan.h"
 #include "buffer_utils.h"
 
-#define DAP_TRANSFER_APnDP (1U << 0U)
-#define DAP_TRANSFER_RnW   (1U << 1U)
+#define DAP_TRANSFER_APnDP       (1U << 0U)
+#define DAP_TRANSFER_RnW         (1U << 1U)
+#define DAP_TRANSFER_MATCH_VALUE (1U << 4U)
+#define DAP_TRANSFER_MATCH_MASK  (1U << 5U)
 
 #define DAP_TRANSFER_WAIT (1U << 1U)
 
@@ -262,12 +264,14 @@ void dap_write_reg(adiv5_debug_port_s *target_dp, const uint8_t reg, const uint3
 	} while (target_dp->fault == DAP_TRANSFER_WAIT);
 }
 
-bool dap_mem_read_block(
-	adiv5_access_port_s *const target_ap, void *dest, target_addr64_t src, const size_t len, const align_e align)
+bool dap_mem_read_block(adiv5_access_port_s *const target_ap, void *dest, target_addr64_t src, const size_t len,
+	const align_e align, const size_t blocks_per_transfer)
 {
 	const size_t blocks = len >> MIN(align, 2U);
-	uint32_t data[256];
-	if (!perform_dap_transfer_block_read(target_ap->dp, SWD_AP_DRW, blocks, data)) {
+	/* Enough space for a full 1KiB TAR auto-increment chunk read a byte at a time */
+	uint32_t data[1024];
+	if (blocks > ARRAY_LENGTH(data) ||
+		!perform_dap_transfer_block_read_queued(target_ap->dp, SWD_AP_DRW, blocks, blocks_per_transfer, data)) {
 		DEBUG_ERROR("dap_read_block failed\n");
 		return false;
 	}
@@ -493,6 +497,66 @@ void dap_adiv6_ap_write(adiv5_access_port_s *const base_ap, const uint16_t addr,
 		DEBUG_ERROR("%s failed (fault = %u)\n", __func__, target_dp->fault);
 }
 
+/*
+ * Turn a batch of raw accesses into DAP_Transfer requests, wait steps becoming value match reads
+ * the adaptor retries itself, and run them as a single queue of commands.
+ */
+bool dap_dp_batch(adiv5_debug_port_s *const target_dp, const adiv5_batch_access_s *const accesses, const size_t count)
+{
+	/* Each access takes at most two requests: a match mask write and the access itself */
+	dap_transfer_request_s *const requests = calloc(count * 2U, sizeof(*requests));
+	uint32_t *const results = calloc(count, sizeof(*results));
+	if (!requests || !results) {
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(requests);
+		free(results);
+		return false;
+	}
+
+	size_t request_count = 0U;
+	size_t read_count = 0U;
+	bool mask_valid = false;
+	uint32_t mask = 0U;
+	for (size_t i = 0; i < count; ++i) {
+		const adiv5_batch_access_s *const access = &accesses[i];
+		const uint8_t reg = (access->addr & 0x0cU) | (access->addr & ADIV5_APnDP ? DAP_TRANSFER_APnDP : 0U);
+		switch (access->op) {
+		case ADIV5_BATCH_WRITE:
+			requests[request_count++] = (dap_transfer_request_s){.request = reg, .data = access->value};
+			break;
+		case ADIV5_BATCH_READ:
+			requests[request_count++] = (dap_transfer_request_s){.request = reg | DAP_TRANSFER_RnW};
+			++read_count;
+			break;
+		case ADIV5_BATCH_WAIT:
+			if (!mask_valid || mask != access->value) {
+				requests[request_count++] =
+					(dap_transfer_request_s){.request = DAP_TRANSFER_MATCH_MASK, .data = access->value};
+				mask = access->value;
+				mask_valid = true;
+			}
+			requests[request_count++] = (dap_transfer_request_s){
+				.request = reg | DAP_TRANSFER_RnW | DAP_TRANSFER_MATCH_VALUE,
+				.data = access->value,
+			};
+			break;
+		}
+	}
+
+	const bool result = perform_dap_transfer_queued(target_dp, requests, request_count, results);
+	if (result) {
+		/* Hand the read results back out in order */
+		for (size_t i = 0, read = 0; i < count && read < read_count; ++i) {
+			if (accesses[i].op == ADIV5_BATCH_READ)
+				*accesses[i].result = results[read++];
+		}
+	} else
+		DEBUG_ERROR("%s failed (fault = %u)\n", __func__, target_dp->fault);
+	free(requests);
+	free(results);
+	return result;
+}
+
 void dap_adiv5_mem_read_single(
 	adiv5_access_port_s *const target_ap, void *const dest, const target_addr64_t src, const align_e align)
 {
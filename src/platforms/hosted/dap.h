@@ -69,6 +69,13 @@ typedef enum dap_led_type {
 #define DAP_QUIRK_BAD_SWD_NO_RESP_DATA_PHASE (1U << 1U)
 #define DAP_QUIRK_BROKEN_SWD_SEQUENCE        (1U << 2U)
 
+typedef struct dap_queued_cmd {
+	const void *request;
+	size_t request_length;
+	void *response;
+	size_t response_length;
+} dap_queued_cmd_s;
+
 extern uint8_t dap_caps;
 extern dap_cap_e dap_mode;
 extern uint8_t dap_quirks;
@@ -81,6 +88,7 @@ size_t dap_info(dap_info_e requested_info, void *buffer, size_t buffer_length);
 bool dap_set_reset_state(bool nrst_state);
 uint32_t dap_read_reg(adiv5_debug_port_s *target_dp, uint8_t reg);
 void dap_write_reg(adiv5_debug_port_s *target_dp, uint8_t reg, uint32_t value);
+bool dap_dp_batch(adiv5_debug_port_s *target_dp, const adiv5_batch_access_s *accesses, size_t count);
 uint32_t dap_adiv5_ap_read(adiv5_access_port_s *target_ap, uint16_t addr);
 void dap_adiv5_ap_write(adiv5_access_port_s *target_ap, uint16_t addr, uint32_t value);
 uint32_t dap_adiv6_ap_read(adiv5_access_port_s *base_ap, uint16_t addr);
@@ -91,10 +99,12 @@ void dap_adiv5_mem_access_setup(adiv5_access_port_s *target_ap, target_addr64_t
 void dap_adiv6_mem_read_single(adiv6_access_port_s *target_ap, void *dest, target_addr64_t src, align_e align);
 void dap_adiv6_mem_write_single(adiv6_access_port_s *target_ap, target_addr64_t dest, const void *src, align_e align);
 void dap_adiv6_mem_access_setup(adiv6_access_port_s *target_ap, target_addr64_t addr, align_e align);
-bool dap_mem_read_block(adiv5_access_port_s *target_ap, void *dest, target_addr64_t src, size_t len, align_e align);
+bool dap_mem_read_block(adiv5_access_port_s *target_ap, void *dest, target_addr64_t src, size_t len, align_e align,
+	size_t blocks_per_transfer);
 bool dap_mem_write_block(
 	adiv5_access_port_s *target_ap, target_addr64_t dest, const void *src, size_t len, align_e align);
 bool dap_run_cmd(const void *request_data, size_t request_length, void *response_data, size_t response_length);
+bool dap_run_cmd_queue(const dap_queued_cmd_s *commands, size_t count);
 bool dap_jtag_configure(void);
 
 void dap_dp_abort(adiv5_debug_port_s *target_dp, uint32_t abort);
@@ -144,41 +144,139 @@ bool perform_dap_transfer_recoverable(adiv5_debug_port_s *const target_dp,
 	return perform_dap_transfer(target_dp, transfer_requests, requests, response_data, responses);
 }
 
-/* https://arm-software.github.io/CMSIS-DAP/latest/group__DAP__TransferBlock.html */
-bool perform_dap_transfer_block_read(
-	adiv5_debug_port_s *const target_dp, const uint8_t reg, const uint16_t block_count, uint32_t *const blocks)
+/*
+ * Run a sequence of transfers too long for a single DAP_Transfer, splitting it into commands of up to 12
+ * requests each that are handed to the adaptor as a single queue. The adaptor keeps any match mask set by
+ * a request across commands, so value match reads in later commands still see it.
+ */
+bool perform_dap_transfer_queued(adiv5_debug_port_s *const target_dp,
+	const dap_transfer_request_s *const transfer_requests, const size_t requests, uint32_t *const response_data)
 {
-	if (block_count > 256U)
+	if (!requests)
+		return true;
+	const size_t command_count = (requests + 11U) / 12U;
+
+	DEBUG_PROBE("-> dap_transfer (%zu requests in %zu commands)\n", requests, command_count);
+	uint8_t(*const commands)[63] = calloc(command_count, sizeof(*commands));
+	dap_transfer_response_s *const responses = calloc(command_count, sizeof(*responses));
+	dap_queued_cmd_s *const queue = calloc(command_count, sizeof(*queue));
+	if (!commands || !responses || !queue) {
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(commands);
+		free(responses);
+		free(queue);
 		return false;
+	}
 
-	DEBUG_PROBE("-> dap_transfer_block (%u transfer blocks)\n", block_count);
-	dap_transfer_block_request_read_s request = {
-		DAP_TRANSFER_BLOCK,
-		target_dp->dev_index,
-		{0},
-		reg | DAP_TRANSFER_RnW,
-	};
-	write_le2(request.block_count, 0, block_count);
+	/* Encode each command's run of transfers, counting how many produce data as we go */
+	for (size_t idx = 0; idx < command_count; ++idx) {
+		const size_t first = idx * 12U;
+		const size_t command_requests = MIN(requests - first, 12U);
+		commands[idx][0] = DAP_TRANSFER;
+		commands[idx][1] = target_dp->dev_index;
+		commands[idx][2] = command_requests;
+		size_t offset = 3U;
+		size_t reads = 0U;
+		for (size_t i = first; i < first + command_requests; ++i) {
+			offset += dap_encode_transfer(&transfer_requests[i], commands[idx], offset);
+			if ((transfer_requests[i].request & (DAP_TRANSFER_RnW | DAP_TRANSFER_MATCH_VALUE)) == DAP_TRANSFER_RnW)
+				++reads;
+		}
+		queue[idx] = (dap_queued_cmd_s){
+			.request = commands[idx],
+			.request_length = offset,
+			.response = &responses[idx],
+			.response_length = 2U + (reads * 4U),
+		};
+	}
 
-	dap_transfer_block_response_read_s response;
-	/* Run the request having set up the request buffer */
-	if (!dap_run_cmd(&request, sizeof(request), &response, 3U + (block_count * 4U)))
+	bool result = dap_run_cmd_queue(queue, command_count);
+	/* Check the responses over, unpacking the read data from each as we go */
+	size_t response_offset = 0U;
+	for (size_t idx = 0; result && idx < command_count; ++idx) {
+		const dap_transfer_response_s *const response = &responses[idx];
+		if (response->processed != commands[idx][2] ||
+			(response->status & DAP_TRANSFER_STATUS_MASK) != DAP_TRANSFER_OK) {
+			DEBUG_PROBE("-> transfer failed with %u after processing %u requests\n", response->status,
+				response->processed);
+			dap_dispatch_status(target_dp, response->status);
+			result = false;
+			break;
+		}
+		const size_t reads = (queue[idx].response_length - 2U) / 4U;
+		for (size_t i = 0; i < reads; ++i)
+			response_data[response_offset + i] = read_le4(response->data[i], 0);
+		response_offset += reads;
+	}
+
+	free(commands);
+	free(responses);
+	free(queue);
+	return result;
+}
+
+/*
+ * Read block_count blocks from a single register, splitting the work into DAP_TransferBlock requests of at
+ * most blocks_per_request blocks each. The requests are handed to the adaptor as a single queue so ones able
+ * to buffer multiple packets are kept busy rather than waiting on a USB round-trip per request.
+ */
+bool perform_dap_transfer_block_read_queued(adiv5_debug_port_s *const target_dp, const uint8_t reg,
+	const size_t block_count, const size_t blocks_per_request, uint32_t *const blocks)
+{
+	if (!blocks_per_request || blocks_per_request > 256U || block_count > UINT16_MAX)
+		return false;
+	const size_t request_count = (block_count + blocks_per_request - 1U) / blocks_per_request;
+
+	DEBUG_PROBE("-> dap_transfer_block (%zu transfer blocks in %zu requests)\n", block_count, request_count);
+	dap_transfer_block_request_read_s *const requests = calloc(request_count, sizeof(*requests));
+	dap_transfer_block_response_read_s *const responses = calloc(request_count, sizeof(*responses));
+	dap_queued_cmd_s *const queue = calloc(request_count, sizeof(*queue));
+	if (!requests || !responses || !queue) {
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(requests);
+		free(responses);
+		free(queue);
 		return false;
+	}
 
-	/* Check the response over */
-	const uint16_t blocks_read = read_le2(response.count, 0);
-	if (blocks_read == block_count && (response.status & DAP_TRANSFER_STATUS_MASK) == DAP_TRANSFER_OK) {
-		for (size_t i = 0; i < block_count; ++i)
-			blocks[i] = read_le4(response.data[i], 0);
-		return true;
+	/* Build up the requests, each covering the next run of blocks */
+	for (size_t idx = 0; idx < request_count; ++idx) {
+		const size_t request_blocks = MIN(block_count - (idx * blocks_per_request), blocks_per_request);
+		requests[idx].command = DAP_TRANSFER_BLOCK;
+		requests[idx].index = target_dp->dev_index;
+		write_le2(requests[idx].block_count, 0, (uint16_t)request_blocks);
+		requests[idx].request = reg | DAP_TRANSFER_RnW;
+		queue[idx] = (dap_queued_cmd_s){
+			.request = &requests[idx],
+			.request_length = sizeof(*requests),
+			.response = &responses[idx],
+			.response_length = DAP_CMD_BLOCK_READ_HDR_LEN + (request_blocks * 4U),
+		};
 	}
-	if ((response.status & DAP_TRANSFER_STATUS_MASK) != DAP_TRANSFER_OK)
-		target_dp->fault = response.status & DAP_TRANSFER_STATUS_MASK;
-	else
-		target_dp->fault = 0;
 
-	DEBUG_PROBE("-> transfer failed with %u after processing %u blocks\n", response.status, blocks_read);
-	return false;
+	bool result = dap_run_cmd_queue(queue, request_count);
+	/* Check the responses over, unpacking the data from each as we go */
+	for (size_t idx = 0; result && idx < request_count; ++idx) {
+		const dap_transfer_block_response_read_s *const response = &responses[idx];
+		const size_t request_blocks = read_le2(requests[idx].block_count, 0);
+		const uint16_t blocks_read = read_le2(response->count, 0);
+		if (blocks_read == request_blocks && (response->status & DAP_TRANSFER_STATUS_MASK) == DAP_TRANSFER_OK) {
+			for (size_t block = 0; block < request_blocks; ++block)
+				blocks[(idx * blocks_per_request) + block] = read_le4(response->data[block], 0);
+			continue;
+		}
+		if ((response->status & DAP_TRANSFER_STATUS_MASK) != DAP_TRANSFER_OK)
+			target_dp->fault = response->status & DAP_TRANSFER_STATUS_MASK;
+		else
+			target_dp->fault = 0;
+		DEBUG_PROBE("-> transfer failed with %u after processing %u blocks\n", response->status, blocks_read);
+		result = false;
+	}
+
+	free(requests);
+	free(responses);
+	free(queue);
+	return result;
 }
 
 bool perform_dap_transfer_block_write(
@@ -149,8 +149,10 @@ bool perform_dap_transfer(adiv5_debug_port_s *target_dp, const dap_transfer_requ
 	size_t requests, uint32_t *response_data, size_t responses);
 bool perform_dap_transfer_recoverable(adiv5_debug_port_s *target_dp, const dap_transfer_request_s *transfer_requests,
 	size_t requests, uint32_t *response_data, size_t responses);
-bool perform_dap_transfer_block_read(
-	adiv5_debug_port_s *target_dp, uint8_t reg, uint16_t block_count, uint32_t *blocks);
+bool perform_dap_transfer_queued(adiv5_debug_port_s *target_dp, const dap_transfer_request_s *transfer_requests,
+	size_t requests, uint32_t *response_data);
+bool perform_dap_transfer_block_read_queued(
+	adiv5_debug_port_s *target_dp, uint8_t reg, size_t block_count, size_t blocks_per_request, uint32_t *blocks);
 bool perform_dap_transfer_block_write(
 	adiv5_debug_port_s *target_dp, uint8_t reg, uint16_t block_count, const uint32_t *blocks);
 
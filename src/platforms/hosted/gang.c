@@ -0,0 +1,370 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements BMDA's gang mode, which runs one Flash operation on many probes at once
+ * for production programming. The adaptor drivers keep their state (the probe handle, the remote
+ * protocol functions, the target list) in process-wide globals, so each probe is driven by its
+ * own child BMDA process. The parent scans for the probes once and hands each child its probe's
+ * location with -L, so the children open only their own probe rather than each scanning the bus.
+ * It staggers their start-up, prefixes their output with the probe serial as it arrives, and
+ * reports the outcome for every probe at the end.
+ */
+
+#include "general.h"
+#include <ctype.h>
+#include <errno.h>
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "gang.h"
+#include "probe_info.h"
+
+/* The most probes one gang can drive, and the longest line of child output passed through whole */
+#define GANG_MAX_PROBES 64U
+#define GANG_LINE_MAX   256U
+/* How long to leave between starting each child, so their probes' start-up doesn't collide */
+#define GANG_STAGGER_MS 50U
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+typedef struct gang_worker {
+	char *serial;
+	/* Where the scan found the probe, handed to the child with -L */
+	char *location;
+	pid_t pid;
+	/* The read end of the pipe carrying the child's stdout and stderr */
+	int output;
+	char line[GANG_LINE_MAX];
+	size_t line_length;
+	uint32_t start_ms;
+	uint32_t end_ms;
+	int exit_code;
+	const char *failure;
+} gang_worker_s;
+
+static void gang_add(gang_worker_s *const workers, size_t *const count, const char *serial, size_t length)
+{
+	while (length && isspace((unsigned char)*serial)) {
+		++serial;
+		--length;
+	}
+	while (length && isspace((unsigned char)serial[length - 1U]))
+		--length;
+	if (!length || serial[0] == '#')
+		return;
+	if (*count == GANG_MAX_PROBES) {
+		DEBUG_WARN("Ignoring probe %.*s, a gang is limited to %u probes\n", (int)length, serial, GANG_MAX_PROBES);
+		return;
+	}
+	gang_worker_s *const worker = &workers[*count];
+	worker->serial = malloc(length + 1U);
+	if (!worker->serial) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return;
+	}
+	memcpy(worker->serial, serial, length);
+	worker->serial[length] = '\0';
+	++*count;
+}
+
+/* The gang is either a comma separated list of serial numbers, or @FILE naming a file of one per line */
+static size_t gang_parse(const char *const list, gang_worker_s *const workers)
+{
+	size_t count = 0;
+	if (list[0] != '@') {
+		for (const char *serial = list; *serial;) {
+			const size_t length = strcspn(serial, ",");
+			gang_add(workers, &count, serial, length);
+			serial += length;
+			if (*serial == ',')
+				++serial;
+		}
+		return count;
+	}
+
+	FILE *const file = fopen(list + 1U, "r");
+	if (!file) {
+		DEBUG_ERROR("Error opening gang list %s: %s\n", list + 1U, strerror(errno));
+		return 0;
+	}
+	char line[GANG_LINE_MAX];
+	while (fgets(line, sizeof(line), file))
+		gang_add(workers, &count, line, strlen(line));
+	fclose(file);
+	return count;
+}
+
+/* Scan for the probes once and note where each one in the gang is, so the children needn't scan again */
+static bool gang_locate(gang_worker_s *const workers, const size_t count)
+{
+	bmda_probe_s info = {0};
+	const probe_info_s *const probe_list = probe_info_scan(&info);
+	if (!probe_list) {
+		probe_info_scan_free(&info, NULL);
+		DEBUG_ERROR("No probes found\n");
+		return false;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		gang_worker_s *const worker = &workers[i];
+		const probe_info_s *const probe = probe_info_filter(probe_list, worker->serial, 0);
+		if (!probe)
+			worker->failure = "probe not found";
+		/* A probe the scan couldn't place is still selected by its serial number alone */
+		else if (probe->location) {
+			worker->location = strdup(probe->location);
+			if (!worker->location)
+				worker->failure = "out of memory";
+		}
+	}
+	probe_info_scan_free(&info, probe_list);
+	return true;
+}
+
+/* Rebuild our command line for a child: drop the gang option and select the child's probe by serial and location */
+static char **gang_child_argv(const int argc, char **const argv, const gang_worker_s *const worker)
+{
+	char **const child_argv = calloc((size_t)argc + 5U, sizeof(*child_argv));
+	if (!child_argv) {
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return NULL;
+	}
+	size_t count = 0;
+	for (int i = 0; i < argc; ++i) {
+		const char *const arg = argv[i];
+		if (i && (strcmp(arg, "-G") == 0 || strcmp(arg, "--gang") == 0)) {
+			++i;
+			continue;
+		}
+		if (i && (strncmp(arg, "-G", 2U) == 0 || strncmp(arg, "--gang=", 7U) == 0))
+			continue;
+		child_argv[count++] = argv[i];
+	}
+	child_argv[count++] = "-s";
+	child_argv[count++] = worker->serial;
+	if (worker->location) {
+		child_argv[count++] = "-L";
+		child_argv[count++] = worker->location;
+	}
+	return child_argv;
+}
+
+static bool gang_start(gang_worker_s *const worker, char **const child_argv)
+{
+	int output[2];
+	if (pipe(output) != 0) {
+		worker->failure = strerror(errno);
+		return false;
+	}
+	fflush(stdout);
+	fflush(stderr);
+	const pid_t pid = fork();
+	if (pid < 0) {
+		worker->failure = strerror(errno);
+		close(output[0]);
+		close(output[1]);
+		return false;
+	}
+	if (pid == 0) {
+		dup2(output[1], STDOUT_FILENO);
+		dup2(output[1], STDERR_FILENO);
+		close(output[0]);
+		close(output[1]);
+		execvp(child_argv[0], child_argv);
+		fprintf(stderr, "Could not run %s: %s\n", child_argv[0], strerror(errno));
+		_exit(127);
+	}
+	close(output[1]);
+	fcntl(output[0], F_SETFD, FD_CLOEXEC);
+	worker->pid = pid;
+	worker->output = output[0];
+	worker->start_ms = platform_time_ms();
+	return true;
+}
+
+static void gang_flush_line(gang_worker_s *const worker)
+{
+	if (!worker->line_length)
+		return;
+	DEBUG_WARN("[%s] %.*s\n", worker->serial, (int)worker->line_length, worker->line);
+	worker->line_length = 0;
+}
+
+/* Pass through what the child wrote, a line at a time, returning false once it has closed its output */
+static bool gang_drain(gang_worker_s *const worker)
+{
+	char buffer[GANG_LINE_MAX];
+	const ssize_t length = read(worker->output, buffer, sizeof(buffer));
+	if (length < 0 && errno == EINTR)
+		return true;
+	if (length <= 0) {
+		gang_flush_line(worker);
+		return false;
+	}
+	for (ssize_t i = 0; i < length; ++i) {
+		if (buffer[i] == '\r')
+			continue;
+		if (buffer[i] == '\n') {
+			gang_flush_line(worker);
+			continue;
+		}
+		if (worker->line_length == sizeof(worker->line))
+			gang_flush_line(worker);
+		worker->line[worker->line_length++] = buffer[i];
+	}
+	return true;
+}
+
+static void gang_reap(gang_worker_s *const worker)
+{
+	close(worker->output);
+	worker->output = -1;
+	int status = 0;
+	while (waitpid(worker->pid, &status, 0) < 0 && errno == EINTR)
+		continue;
+	worker->end_ms = platform_time_ms();
+	if (WIFEXITED(status))
+		worker->exit_code = WEXITSTATUS(status);
+	else {
+		worker->exit_code = -1;
+		worker->failure = "terminated by a signal";
+	}
+}
+
+static void gang_wait(gang_worker_s *const workers, const size_t count)
+{
+	struct pollfd fds[GANG_MAX_PROBES];
+	size_t index[GANG_MAX_PROBES];
+	while (true) {
+		size_t active = 0;
+		for (size_t i = 0; i < count; ++i) {
+			if (workers[i].output == -1)
+				continue;
+			fds[active].fd = workers[i].output;
+			fds[active].events = POLLIN;
+			fds[active].revents = 0;
+			index[active++] = i;
+		}
+		if (!active)
+			return;
+		if (poll(fds, active, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			DEBUG_ERROR("poll: %s\n", strerror(errno));
+			/* We can no longer follow the children, so stop them all rather than leave them running unreported */
+			for (size_t i = 0; i < active; ++i) {
+				gang_worker_s *const worker = &workers[index[i]];
+				kill(worker->pid, SIGTERM);
+				gang_reap(worker);
+				worker->failure = "stopped as its output could not be followed";
+			}
+			return;
+		}
+		for (size_t i = 0; i < active; ++i) {
+			if (fds[i].revents && !gang_drain(&workers[index[i]]))
+				gang_reap(&workers[index[i]]);
+		}
+	}
+}
+
+static int gang_report(const gang_worker_s *const workers, const size_t count, const uint32_t elapsed_ms)
+{
+	size_t succeeded = 0;
+	DEBUG_WARN("\nGang results:\n");
+	DEBUG_WARN("%-24s %-8s %10s\n", "probe", "result", "time (s)");
+	for (size_t i = 0; i < count; ++i) {
+		const gang_worker_s *const worker = &workers[i];
+		const uint32_t time_ms = worker->end_ms - worker->start_ms;
+		if (worker->failure)
+			DEBUG_WARN("%-24s %-8s %6" PRIu32 ".%03" PRIu32 " (%s)\n", worker->serial, "FAILED", time_ms / 1000U,
+				time_ms % 1000U, worker->failure);
+		else if (worker->exit_code)
+			DEBUG_WARN("%-24s %-8s %6" PRIu32 ".%03" PRIu32 " (exit code %d)\n", worker->serial, "FAILED",
+				time_ms / 1000U, time_ms % 1000U, worker->exit_code);
+		else {
+			DEBUG_WARN("%-24s %-8s %6" PRIu32 ".%03" PRIu32 "\n", worker->serial, "ok", time_ms / 1000U,
+				time_ms % 1000U);
+			++succeeded;
+		}
+	}
+	DEBUG_WARN("%zu of %zu probes succeeded in %" PRIu32 ".%03" PRIu32 "s\n", succeeded, count, elapsed_ms / 1000U,
+		elapsed_ms % 1000U);
+	return succeeded == count ? 0 : 1;
+}
+#endif
+
+int gang_run(const bmda_cli_options_s *const opt, const int argc, char **const argv)
+{
+	if (opt->opt_mode == BMP_MODE_DEBUG || opt->opt_mode == BMP_MODE_FLASH_READ || opt->opt_mode == BMP_MODE_BENCH ||
+		opt->opt_mode == BMP_MODE_SWJ_TEST) {
+		DEBUG_ERROR("Gang mode needs a Flash erase, write or verify, reset or monitor command to run\n");
+		return 1;
+	}
+#if defined(_WIN32) || defined(__CYGWIN__)
+	(void)argc;
+	(void)argv;
+	DEBUG_ERROR("Gang mode is not supported on Windows\n");
+	return 1;
+#else
+	gang_worker_s workers[GANG_MAX_PROBES] = {0};
+	const size_t count = gang_parse(opt->opt_gang, workers);
+	if (!count) {
+		DEBUG_ERROR("No probes given for the gang\n");
+		return 1;
+	}
+
+	const uint32_t start_ms = platform_time_ms();
+	if (!gang_locate(workers, count)) {
+		for (size_t i = 0; i < count; ++i)
+			free(workers[i].serial);
+		return 1;
+	}
+
+	DEBUG_INFO("Running on %zu probes\n", count);
+	for (size_t i = 0; i < count; ++i) {
+		gang_worker_s *const worker = &workers[i];
+		worker->output = -1;
+		/* A probe the scan didn't find has already failed, there's no child to start for it */
+		if (worker->failure) {
+			worker->start_ms = worker->end_ms = platform_time_ms();
+			continue;
+		}
+		char **const child_argv = gang_child_argv(argc, argv, worker);
+		if (!child_argv || !gang_start(worker, child_argv)) {
+			if (!worker->failure)
+				worker->failure = "out of memory";
+			worker->start_ms = worker->end_ms = platform_time_ms();
+		}
+		free(child_argv);
+		if (i + 1U < count)
+			platform_delay(GANG_STAGGER_MS);
+	}
+	gang_wait(workers, count);
+
+	const int result = gang_report(workers, count, platform_time_ms() - start_ms);
+	for (size_t i = 0; i < count; ++i) {
+		free(workers[i].serial);
+		free(workers[i].location);
+	}
+	return result;
+#endif
+}
@@ -45,6 +45,9 @@ typedef signed long long ssize_t;
 #include <netinet/tcp.h>
 #include <sys/select.h>
 #include <fcntl.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 
 typedef int32_t socket_t;
 #define PRI_SOCKET     "d"
@@ -65,6 +68,9 @@ typedef int32_t socket_t;
 #include "gdb_if.h"
 #include "bmp_hosted.h"
 #include "command.h"
+#ifdef ENABLE_RTT
+#include "rtt.h"
+#endif
 
 #define DEFAULT_PORT 2000U
 static const uint16_t default_port = DEFAULT_PORT;
@@ -91,6 +97,29 @@ bool shutdown_bmda = false;
 static size_t gdb_buffer_used = 0U;
 static char gdb_buffer[GDB_BUFFER_LEN];
 
+/*
+ * Receive buffer - data is pulled off the socket in as large a chunk as is available
+ * so that a packet costs a handful of recv() calls rather than one per byte.
+ * gdb_rx_begin indexes the next unconsumed byte and gdb_rx_end one past the last valid one.
+ */
+#define GDB_RX_BUFFER_LEN 16384U
+static size_t gdb_rx_begin = 0U;
+static size_t gdb_rx_end = 0U;
+static char gdb_rx_buffer[GDB_RX_BUFFER_LEN];
+/* Count of receives from GDB, so the halt poll pacing can tell when GDB has resumed the target */
+static size_t gdb_rx_count = 0U;
+
+#ifdef __linux__
+/*
+ * epoll set used to sleep between halt polls while the target runs, waking as soon as GDB
+ * (or, with RTT enabled, the terminal) has something for us
+ */
+static int gdb_if_epoll = -1;
+#ifdef ENABLE_RTT
+static bool gdb_if_epoll_stdin = false;
+#endif
+#endif
+
 typedef struct sockaddr sockaddr_s;
 typedef struct sockaddr_in sockaddr_in_s;
 typedef struct sockaddr_in6 sockaddr_in6_s;
@@ -276,6 +305,32 @@ int gdb_if_init(void)
 	return -1;
 }
 
+static bool gdb_if_fill_buffer(void)
+{
+	gdb_rx_begin = 0U;
+	gdb_rx_end = 0U;
+	int error = op_needs_retry;
+	while (error == op_needs_retry) {
+		/* Grab as much as the socket has ready for us, blocking only if nothing is available yet */
+		const ssize_t result = recv(gdb_if_conn, gdb_rx_buffer, GDB_RX_BUFFER_LEN, 0);
+		if (result < 0) {
+			error = socket_error();
+			if (error == op_needs_retry)
+				continue;
+		} else
+			error = 0;
+
+		if (result <= 0) {
+			handle_error(gdb_if_conn, "on socket");
+			gdb_if_conn = INVALID_SOCKET;
+			return false;
+		}
+		gdb_rx_end = (size_t)result;
+	}
+	++gdb_rx_count;
+	return true;
+}
+
 char gdb_if_getchar(void)
 {
 	if (gdb_if_conn == INVALID_SOCKET) {
@@ -299,35 +354,49 @@ char gdb_if_getchar(void)
 			}
 		}
 		DEBUG_INFO("Got connection\n");
+		/* Make sure nothing left over from a previous connection gets mistaken for new data */
+		gdb_rx_begin = 0U;
+		gdb_rx_end = 0U;
 		socket_set_flags(gdb_if_serv, flags);
 		socket_set_flags(gdb_if_conn, socket_get_flags(gdb_if_conn) & ~O_NONBLOCK);
+#ifdef __linux__
+		/* Closing the previous connection took it out of the set, so add this one in its place */
+		if (gdb_if_epoll != -1) {
+			struct epoll_event event = {.events = EPOLLIN, .data.fd = gdb_if_conn};
+			if (epoll_ctl(gdb_if_epoll, EPOLL_CTL_ADD, gdb_if_conn, &event) == -1)
+				display_socket_error(errno, gdb_if_conn, "adding to the epoll set");
+		}
+#endif
 	}
 
-	char value = '\0';
-	int error = op_needs_retry;
-	while (error == op_needs_retry) {
-		const ssize_t result = recv(gdb_if_conn, &value, 1, 0);
-		if (result < 0) {
-			error = socket_error();
-			if (error == op_needs_retry)
-				continue;
-		} else
-			error = 0;
+	if (gdb_rx_begin == gdb_rx_end && !gdb_if_fill_buffer())
+		/* Return '+' in case we were waiting for an ACK */
+		return '+';
+	return gdb_rx_buffer[gdb_rx_begin++];
+}
 
-		if (result <= 0) {
-			handle_error(gdb_if_conn, "on socket");
-			gdb_if_conn = INVALID_SOCKET;
-			/* Return '+' in case we were waiting for an ACK */
-			return '+';
-		}
+size_t gdb_if_getchars_until(char *const buffer, const size_t size, const char *const delimiters)
+{
+	/* Only hand out what has already been received, stopping short of any of the delimiters */
+	size_t count = 0U;
+	while (count < size && gdb_rx_begin + count < gdb_rx_end) {
+		const char value = gdb_rx_buffer[gdb_rx_begin + count];
+		if (strchr(delimiters, value))
+			break;
+		++count;
 	}
-	return value;
+	memcpy(buffer, gdb_rx_buffer + gdb_rx_begin, count);
+	gdb_rx_begin += count;
+	return count;
 }
 
 char gdb_if_getchar_to(uint32_t timeout)
 {
 	if (gdb_if_conn == INVALID_SOCKET)
 		return -1;
+	/* If there is still received data waiting to be consumed, don't go to the socket */
+	if (gdb_rx_begin != gdb_rx_end)
+		return gdb_rx_buffer[gdb_rx_begin++];
 
 #ifndef __CYGWIN__
 	timeval_s select_timeout;
@@ -346,6 +415,96 @@ char gdb_if_getchar_to(uint32_t timeout)
 	return -1;
 }
 
+size_t gdb_if_rx_count(void)
+{
+	return gdb_rx_count;
+}
+
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+void gdb_if_attach(const int socket)
+{
+	/* Drop anything buffered for the connection being replaced */
+	gdb_rx_begin = 0U;
+	gdb_rx_end = 0U;
+	gdb_buffer_used = 0U;
+	gdb_if_conn = socket;
+}
+#endif
+
+#ifdef __linux__
+static bool gdb_if_epoll_init(void)
+{
+	gdb_if_epoll = epoll_create1(EPOLL_CLOEXEC);
+	if (gdb_if_epoll == -1) {
+		DEBUG_ERROR("Failed to create epoll set (%d): %s\n", errno, strerror(errno));
+		return false;
+	}
+	struct epoll_event event = {.events = EPOLLIN, .data.fd = gdb_if_conn};
+	if (epoll_ctl(gdb_if_epoll, EPOLL_CTL_ADD, gdb_if_conn, &event) == -1) {
+		display_socket_error(errno, gdb_if_conn, "adding to the epoll set");
+		close(gdb_if_epoll);
+		gdb_if_epoll = -1;
+		return false;
+	}
+	return true;
+}
+
+#ifdef ENABLE_RTT
+/*
+ * Keep the terminal in the set only while RTT is on. It is left unread otherwise and would
+ * then wake us every time. Only a terminal is worth watching, a file or /dev/null is always ready.
+ */
+static void gdb_if_epoll_update_stdin(void)
+{
+	const bool want_stdin = rtt_enabled && isatty(STDIN_FILENO);
+	if (want_stdin == gdb_if_epoll_stdin)
+		return;
+	struct epoll_event event = {.events = EPOLLIN, .data.fd = STDIN_FILENO};
+	if (epoll_ctl(gdb_if_epoll, want_stdin ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, STDIN_FILENO, &event) == 0)
+		gdb_if_epoll_stdin = want_stdin;
+}
+#endif
+#endif
+
+bool gdb_if_wait(const uint32_t timeout)
+{
+	/* If there is still received data waiting to be consumed, there's nothing to wait for */
+	if (gdb_rx_begin != gdb_rx_end)
+		return true;
+	if (gdb_if_conn == INVALID_SOCKET) {
+		platform_delay(timeout);
+		return false;
+	}
+
+#ifdef __linux__
+	if (gdb_if_epoll != -1 || gdb_if_epoll_init()) {
+#ifdef ENABLE_RTT
+		gdb_if_epoll_update_stdin();
+#endif
+		struct epoll_event events[2];
+		int result = -1;
+		do
+			result = epoll_wait(gdb_if_epoll, events, ARRAY_LENGTH(events), (int)timeout);
+		while (result == -1 && errno == EINTR);
+		return result > 0;
+	}
+#endif
+
+	/* Everywhere else (or if epoll is unavailable) fall back to select() on just the GDB connection */
+#ifndef __CYGWIN__
+	timeval_s select_timeout;
+#else
+	TIMEVAL select_timeout;
+#endif
+	select_timeout.tv_sec = timeout / 1000U;
+	select_timeout.tv_usec = (timeout % 1000U) * 1000U;
+
+	fd_set fds;
+	FD_ZERO(&fds);
+	FD_SET(gdb_if_conn, &fds);
+	return select(FD_SETSIZE, &fds, NULL, NULL, &select_timeout) > 0;
+}
+
 void gdb_if_putchar(char c, int flush)
 {
 	if (gdb_if_conn == INVALID_SOCKET)
@@ -0,0 +1,223 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements BMDA's target identification cache. The scan code decides what to key
+ * on and what to record, this only keeps the "key value" pairs and persists them. The file is
+ * rewritten whole through a temporary next to it and a rename, so a reader never sees it half
+ * written, and is only touched when an entry actually changes so warm scans don't write at all.
+ * Several BMDA processes (such as the children of a gang) may share one file, so each writes
+ * through its own temporary and first picks up whatever entries the others have added meanwhile.
+ */
+
+#include "general.h"
+#include <errno.h>
+#ifdef _MSC_VER
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "id_cache.h"
+
+typedef struct id_cache_entry id_cache_entry_s;
+
+struct id_cache_entry {
+	id_cache_entry_s *next;
+	char key[ID_CACHE_KEY_MAX];
+	char value[ID_CACHE_VALUE_MAX];
+};
+
+static id_cache_entry_s *id_cache_entries = NULL;
+static const char *id_cache_path = NULL;
+
+static const char *id_cache_probe_name = NULL;
+static const char *id_cache_probe_last = NULL;
+/* State for a checking walk of the probe chain, see id_cache_probe_check() */
+static const char *const *id_cache_probe_safe = NULL;
+static bool id_cache_probe_reached = false;
+static bool id_cache_probe_unsafe = false;
+
+static id_cache_entry_s *id_cache_find(const char *const key)
+{
+	for (id_cache_entry_s *entry = id_cache_entries; entry; entry = entry->next) {
+		if (strcmp(entry->key, key) == 0)
+			return entry;
+	}
+	return NULL;
+}
+
+static void id_cache_set(const char *const key, const char *const value)
+{
+	id_cache_entry_s *entry = id_cache_find(key);
+	if (!entry) {
+		entry = calloc(1, sizeof(*entry));
+		if (!entry) { /* calloc failed: heap exhaustion */
+			DEBUG_ERROR("calloc: failed in %s\n", __func__);
+			return;
+		}
+		strncpy(entry->key, key, sizeof(entry->key) - 1U);
+		entry->next = id_cache_entries;
+		id_cache_entries = entry;
+	}
+	strncpy(entry->value, value, sizeof(entry->value) - 1U);
+}
+
+/* Read the entries in the cache file, keeping those already in memory unless told to replace them */
+static void id_cache_load(const bool replace)
+{
+	FILE *const file = fopen(id_cache_path, "r");
+	/* A cache that doesn't exist yet is just a cold one */
+	if (!file)
+		return;
+	char line[ID_CACHE_KEY_MAX + ID_CACHE_VALUE_MAX + 2U];
+	while (fgets(line, sizeof(line), file)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		char *const value = strchr(line, ' ');
+		if (line[0] == '#' || !value)
+			continue;
+		*value = '\0';
+		if (strlen(line) < ID_CACHE_KEY_MAX && strlen(value + 1U) < ID_CACHE_VALUE_MAX &&
+			(replace || !id_cache_find(line)))
+			id_cache_set(line, value + 1U);
+	}
+	fclose(file);
+}
+
+static void id_cache_save(void)
+{
+	if (!id_cache_path)
+		return;
+	/* Don't drop what other processes sharing the file have recorded since it was loaded */
+	id_cache_load(false);
+
+	/* Room for the path, a '.', the PID and ".tmp" */
+	const size_t length = strlen(id_cache_path) + 26U;
+	char *const temp_path = malloc(length);
+	if (!temp_path) { /* malloc failed: heap exhaustion */
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return;
+	}
+	snprintf(temp_path, length, "%s.%ld.tmp", id_cache_path, (long)getpid());
+
+	FILE *const file = fopen(temp_path, "w");
+	if (!file) {
+		DEBUG_WARN("Error writing identification cache %s: %s\n", temp_path, strerror(errno));
+		free(temp_path);
+		return;
+	}
+	fprintf(file, "# Black Magic Debug target identification cache, safe to delete\n");
+	for (const id_cache_entry_s *entry = id_cache_entries; entry; entry = entry->next)
+		fprintf(file, "%s %s\n", entry->key, entry->value);
+	const bool written = fclose(file) == 0;
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+	/* rename() won't replace an existing file here */
+	remove(id_cache_path);
+#endif
+	if (!written || rename(temp_path, id_cache_path) != 0) {
+		DEBUG_WARN("Error writing identification cache %s: %s\n", id_cache_path, strerror(errno));
+		remove(temp_path);
+	}
+	free(temp_path);
+}
+
+void id_cache_init(const char *const path)
+{
+	id_cache_path = path;
+	if (path)
+		id_cache_load(true);
+}
+
+const char *id_cache_lookup(const char *const key)
+{
+	if (!id_cache_path)
+		return NULL;
+	const id_cache_entry_s *const entry = id_cache_find(key);
+	return entry ? entry->value : NULL;
+}
+
+void id_cache_store(const char *const key, const char *const value)
+{
+	if (!id_cache_path || strlen(key) >= ID_CACHE_KEY_MAX || strlen(value) >= ID_CACHE_VALUE_MAX || strchr(key, ' '))
+		return;
+	const char *const current = id_cache_lookup(key);
+	if (current && strcmp(current, value) == 0)
+		return;
+	id_cache_set(key, value);
+	id_cache_save();
+}
+
+void id_cache_probe_only(const char *const name)
+{
+	id_cache_probe_name = name;
+	id_cache_probe_last = NULL;
+	id_cache_probe_safe = NULL;
+}
+
+void id_cache_probe_check(const char *const name, const char *const *const side_effect_free)
+{
+	id_cache_probe_only(name);
+	id_cache_probe_safe = side_effect_free;
+	id_cache_probe_reached = false;
+	id_cache_probe_unsafe = false;
+}
+
+bool id_cache_probe_trusted(void)
+{
+	const bool trusted = id_cache_probe_reached && !id_cache_probe_unsafe;
+	id_cache_probe_only(NULL);
+	return trusted;
+}
+
+static bool id_cache_probe_side_effect_free(const char *const name)
+{
+	for (const char *const *safe = id_cache_probe_safe; *safe; ++safe) {
+		if (strcmp(*safe, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+id_cache_probe_action_e id_cache_probe_action(const char *const name)
+{
+	if (!id_cache_probe_name)
+		return ID_CACHE_PROBE_CALL;
+	const bool claimant = strcmp(id_cache_probe_name, name) == 0;
+	if (!id_cache_probe_safe)
+		return claimant ? ID_CACHE_PROBE_CALL : ID_CACHE_PROBE_SKIP;
+
+	/* Checking walk: note whether anything ahead of the claimant could change the outcome if skipped */
+	if (claimant) {
+		id_cache_probe_reached = true;
+		return ID_CACHE_PROBE_STOP;
+	}
+	if (!id_cache_probe_side_effect_free(name))
+		id_cache_probe_unsafe = true;
+	return ID_CACHE_PROBE_SKIP;
+}
+
+void id_cache_probe_claimed(const char *const name)
+{
+	id_cache_probe_last = name;
+}
+
+const char *id_cache_probe_claimant(void)
+{
+	return id_cache_probe_last;
+}
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_ID_CACHE_H
+#define PLATFORMS_HOSTED_ID_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Target identification cache: the scan code records what it found behind a given set of ID
+ * register values (the components a ROM table walk turned up, the probe routine that claimed
+ * a part) so the next scan of the same hardware can go straight there. Entries are plain
+ * "key value" strings kept in the file given with -k, without which the cache is disabled.
+ */
+#define ID_CACHE_KEY_MAX   128U
+#define ID_CACHE_VALUE_MAX 256U
+
+/* Load the entries from the given file and write any changes back to it, NULL disables the cache */
+void id_cache_init(const char *path);
+/* Return the value recorded against key, or NULL if there is none */
+const char *id_cache_lookup(const char *key);
+/* Record the value against key, replacing any previous one */
+void id_cache_store(const char *key, const char *value);
+
+/*
+ * Probe routine selection for PROBE(), see target_probe.h. While a name is set, every other
+ * probe routine is skipped, and the name of the last one to claim a part is kept for recording.
+ *
+ * A cached claimant only gets called on its own if skipping the routines ahead of it in the chain
+ * can't change the outcome. id_cache_probe_check() makes the next walk of the chain call nothing
+ * and stop at the claimant, after which id_cache_probe_trusted() says whether it was reached and
+ * every routine ahead of it is in the given NULL terminated list of side-effect free routines.
+ */
+typedef enum id_cache_probe_action {
+	ID_CACHE_PROBE_CALL,
+	ID_CACHE_PROBE_SKIP,
+	ID_CACHE_PROBE_STOP,
+} id_cache_probe_action_e;
+
+void id_cache_probe_only(const char *name);
+void id_cache_probe_check(const char *name, const char *const *side_effect_free);
+bool id_cache_probe_trusted(void);
+id_cache_probe_action_e id_cache_probe_action(const char *name);
+void id_cache_probe_claimed(const char *name);
+const char *id_cache_probe_claimant(void);
+
+#endif /* PLATFORMS_HOSTED_ID_CACHE_H */
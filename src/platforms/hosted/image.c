@@ -0,0 +1,376 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements the decoding of ELF, Intel HEX and Motorola S-record firmware images for
+ * the BMDA CLI Flash operations, so only the populated address ranges of sparse images (say a
+ * bootloader and an application with a gap between) need to be erased and programmed.
+ */
+
+#include "general.h"
+#include <ctype.h>
+
+#include "hex_utils.h"
+#include "buffer_utils.h"
+#include "image.h"
+
+/* ELF32 header and program header field offsets, we don't rely on the host having <elf.h> */
+#define ELF_IDENT_CLASS    4U
+#define ELF_IDENT_DATA     5U
+#define ELF_CLASS_32       1U
+#define ELF_DATA_LSB       1U
+#define ELF_HEADER_SIZE    52U
+#define ELF_PHOFF          28U
+#define ELF_PHENTSIZE      42U
+#define ELF_PHNUM          44U
+#define ELF_PHDR_SIZE      32U
+#define ELF_PHDR_TYPE      0U
+#define ELF_PHDR_OFFSET    4U
+#define ELF_PHDR_PADDR     12U
+#define ELF_PHDR_FILESZ    16U
+#define ELF_PROGRAM_LOAD   1U
+
+#define IHEX_RECORD_DATA                 0x00U
+#define IHEX_RECORD_EOF                  0x01U
+#define IHEX_RECORD_EXTENDED_SEGMENT     0x02U
+#define IHEX_RECORD_EXTENDED_LINEAR      0x04U
+
+/* A record carries at most 255 bytes after its length byte, in both text formats */
+#define IMAGE_RECORD_MAX 255U
+
+static const char *const image_format_names[] = {
+	"binary",
+	"ELF",
+	"Intel HEX",
+	"S-record",
+};
+
+const char *image_format_name(const image_format_e format)
+{
+	return image_format_names[format];
+}
+
+void image_free(image_s *const image)
+{
+	for (size_t i = 0; i < image->segment_count; ++i)
+		free(image->segments[i].data);
+	free(image->segments);
+	image->segments = NULL;
+	image->segment_count = 0;
+}
+
+size_t image_data_length(const image_s *const image)
+{
+	size_t length = 0;
+	for (size_t i = 0; i < image->segment_count; ++i)
+		length += image->segments[i].length;
+	return length;
+}
+
+static bool image_segment_extend(image_segment_s *const segment, const uint8_t *const data, const size_t length)
+{
+	if (segment->length + length > segment->capacity) {
+		const size_t capacity = MAX(segment->capacity * 2U, segment->length + length);
+		uint8_t *const buffer = realloc(segment->data, capacity);
+		if (!buffer) {
+			DEBUG_ERROR("realloc: failed in %s\n", __func__);
+			return false;
+		}
+		segment->data = buffer;
+		segment->capacity = capacity;
+	}
+	memcpy(segment->data + segment->length, data, length);
+	segment->length += length;
+	return true;
+}
+
+/* Add data to the image, extending the last segment if it follows on directly */
+static bool image_append(image_s *const image, const uint32_t address, const uint8_t *const data, const size_t length)
+{
+	if (!length)
+		return true;
+	if ((uint64_t)address + length > UINT64_C(0x100000000)) {
+		DEBUG_ERROR("Image data at 0x%08" PRIx32 " runs past the end of the address space\n", address);
+		return false;
+	}
+
+	image_segment_s *segment = image->segment_count ? &image->segments[image->segment_count - 1U] : NULL;
+	if (!segment || segment->address + segment->length != address) {
+		image_segment_s *const segments =
+			realloc(image->segments, sizeof(*image->segments) * (image->segment_count + 1U));
+		if (!segments) {
+			DEBUG_ERROR("realloc: failed in %s\n", __func__);
+			return false;
+		}
+		image->segments = segments;
+		segment = &segments[image->segment_count++];
+		memset(segment, 0, sizeof(*segment));
+		segment->address = address;
+	}
+
+	return image_segment_extend(segment, data, length);
+}
+
+static int image_segment_compare(const void *const lhs, const void *const rhs)
+{
+	const uint32_t lhs_address = ((const image_segment_s *)lhs)->address;
+	const uint32_t rhs_address = ((const image_segment_s *)rhs)->address;
+	return lhs_address < rhs_address ? -1 : lhs_address > rhs_address ? 1 : 0;
+}
+
+/* Sort the segments by address, joining those that touch and rejecting any that overlap */
+static bool image_finalise(image_s *const image)
+{
+	if (image->segment_count > 1U)
+		qsort(image->segments, image->segment_count, sizeof(*image->segments), image_segment_compare);
+
+	/*
+	 * Compact the array in place. Entries that have been folded into an earlier segment or moved down
+	 * are left with no data, so that image_free() stays correct if we bail out part way through.
+	 */
+	size_t count = 0;
+	for (size_t i = 0; i < image->segment_count; ++i) {
+		image_segment_s *const segment = &image->segments[i];
+		image_segment_s *const previous = count ? &image->segments[count - 1U] : NULL;
+		if (previous && (uint64_t)previous->address + previous->length > segment->address) {
+			DEBUG_ERROR("Image data overlaps at 0x%08" PRIx32 "\n", segment->address);
+			return false;
+		}
+		if (previous && previous->address + previous->length == segment->address) {
+			if (!image_segment_extend(previous, segment->data, segment->length))
+				return false;
+			free(segment->data);
+		} else if (count != i)
+			image->segments[count++] = *segment;
+		else {
+			++count;
+			continue;
+		}
+		segment->data = NULL;
+		segment->length = 0;
+	}
+	image->segment_count = count;
+	return true;
+}
+
+static bool image_parse_elf(image_s *const image, const uint8_t *const contents, const size_t size)
+{
+	if (size < ELF_HEADER_SIZE || contents[ELF_IDENT_CLASS] != ELF_CLASS_32 ||
+		contents[ELF_IDENT_DATA] != ELF_DATA_LSB) {
+		DEBUG_ERROR("Only little endian 32-bit ELF files are supported\n");
+		return false;
+	}
+	const uint32_t phoff = read_le4(contents, ELF_PHOFF);
+	const uint16_t phentsize = read_le2(contents, ELF_PHENTSIZE);
+	const uint16_t phnum = read_le2(contents, ELF_PHNUM);
+	if (phentsize < ELF_PHDR_SIZE || phoff > size || (size_t)phnum * phentsize > size - phoff) {
+		DEBUG_ERROR("ELF program headers are truncated\n");
+		return false;
+	}
+
+	for (size_t i = 0; i < phnum; ++i) {
+		const uint8_t *const phdr = contents + phoff + i * phentsize;
+		if (read_le4(phdr, ELF_PHDR_TYPE) != ELF_PROGRAM_LOAD)
+			continue;
+		/* Program the segment at its load (physical) address, so initialised data lands in Flash */
+		const uint32_t offset = read_le4(phdr, ELF_PHDR_OFFSET);
+		const uint32_t address = read_le4(phdr, ELF_PHDR_PADDR);
+		const uint32_t length = read_le4(phdr, ELF_PHDR_FILESZ);
+		if (offset > size || length > size - offset) {
+			DEBUG_ERROR("ELF segment at 0x%08" PRIx32 " is truncated\n", address);
+			return false;
+		}
+		if (!image_append(image, address, contents + offset, length))
+			return false;
+	}
+	return true;
+}
+
+/* Decode the hex digit pairs of a text record into bytes, returning how many were decoded */
+static size_t image_unhex_record(
+	const char *const line, const size_t line_length, uint8_t *const record, const size_t record_size)
+{
+	if (line_length % 2U || line_length / 2U > record_size)
+		return 0;
+	for (size_t i = 0; i < line_length; ++i) {
+		if (!is_hex(line[i]))
+			return 0;
+	}
+	unhexify(record, line, line_length / 2U);
+	return line_length / 2U;
+}
+
+static bool image_parse_ihex_record(image_s *const image, const char *const line, const size_t line_length,
+	uint32_t *const base, bool *const end)
+{
+	/* Length, 16-bit offset, type, data and the checksum */
+	uint8_t record[IMAGE_RECORD_MAX + 5U];
+	const size_t record_length = image_unhex_record(line + 1U, line_length - 1U, record, sizeof(record));
+	if (record_length < 5U || record_length != record[0] + 5U) {
+		DEBUG_ERROR("Malformed Intel HEX record\n");
+		return false;
+	}
+	uint8_t checksum = 0;
+	for (size_t i = 0; i < record_length; ++i)
+		checksum += record[i];
+	if (checksum) {
+		DEBUG_ERROR("Intel HEX record checksum mismatch\n");
+		return false;
+	}
+
+	const uint8_t length = record[0];
+	const uint16_t offset = (uint16_t)((record[1] << 8U) | record[2]);
+	const uint8_t *const data = record + 4U;
+	switch (record[3]) {
+	case IHEX_RECORD_DATA:
+		return image_append(image, *base + offset, data, length);
+	case IHEX_RECORD_EOF:
+		*end = true;
+		return true;
+	case IHEX_RECORD_EXTENDED_SEGMENT:
+	case IHEX_RECORD_EXTENDED_LINEAR:
+		if (length != 2U) {
+			DEBUG_ERROR("Malformed Intel HEX address record\n");
+			return false;
+		}
+		*base = (uint32_t)((data[0] << 8U) | data[1]) << (record[3] == IHEX_RECORD_EXTENDED_LINEAR ? 16U : 4U);
+		return true;
+	default:
+		/* Start address records don't matter for programming */
+		return true;
+	}
+}
+
+static bool image_parse_srec_record(image_s *const image, const char *const line, const size_t line_length)
+{
+	/* S1, S2 and S3 carry data with 2, 3 and 4 byte addresses, all other record types are informational */
+	const char type = line[1];
+	if (type < '1' || type > '3')
+		return true;
+	const size_t address_length = (size_t)(type - '0') + 1U;
+
+	/* Count, address, data and the checksum */
+	uint8_t record[IMAGE_RECORD_MAX + 1U];
+	const size_t record_length = image_unhex_record(line + 2U, line_length - 2U, record, sizeof(record));
+	if (record_length < address_length + 2U || record_length != record[0] + 1U) {
+		DEBUG_ERROR("Malformed S-record\n");
+		return false;
+	}
+	uint8_t checksum = 0;
+	for (size_t i = 0; i < record_length; ++i)
+		checksum += record[i];
+	if (checksum != 0xffU) {
+		DEBUG_ERROR("S-record checksum mismatch\n");
+		return false;
+	}
+
+	uint32_t address = 0;
+	for (size_t i = 0; i < address_length; ++i)
+		address = (address << 8U) | record[1U + i];
+	return image_append(image, address, record + 1U + address_length, record_length - address_length - 2U);
+}
+
+/*
+ * Check the first record of what looks like a text image decodes with a good checksum, so a binary
+ * that just happens to start with ':' or an 'S' and a digit isn't taken for one
+ */
+static bool image_text_record_valid(const image_format_e format, const char *const line, const size_t size)
+{
+	size_t line_length = 0;
+	while (line_length < size && line[line_length] != '\n')
+		++line_length;
+	while (line_length && isspace((unsigned char)line[line_length - 1U]))
+		--line_length;
+	/* Intel HEX records start with a ':', S-records with an 'S' and their type */
+	const size_t prefix_length = format == IMAGE_FORMAT_IHEX ? 1U : 2U;
+	if (line_length <= prefix_length)
+		return false;
+
+	uint8_t record[IMAGE_RECORD_MAX + 5U];
+	const size_t record_length =
+		image_unhex_record(line + prefix_length, line_length - prefix_length, record, sizeof(record));
+	if (!record_length)
+		return false;
+	uint8_t checksum = 0;
+	for (size_t i = 0; i < record_length; ++i)
+		checksum += record[i];
+	if (format == IMAGE_FORMAT_IHEX)
+		return record_length == record[0] + 5U && checksum == 0U;
+	return record_length == record[0] + 1U && checksum == 0xffU;
+}
+
+static bool image_parse_text(image_s *const image, const char *const contents, const size_t size)
+{
+	uint32_t base = 0;
+	bool end = false;
+	size_t line_number = 0;
+	for (size_t offset = 0; offset < size && !end;) {
+		const char *const line = contents + offset;
+		size_t line_length = 0;
+		while (offset + line_length < size && line[line_length] != '\n')
+			++line_length;
+		offset += line_length + 1U;
+		++line_number;
+		/* Tolerate CRLF line endings and trailing whitespace */
+		while (line_length && isspace((unsigned char)line[line_length - 1U]))
+			--line_length;
+		if (!line_length)
+			continue;
+
+		bool ok;
+		if (image->format == IMAGE_FORMAT_IHEX)
+			ok = line[0] == ':' && image_parse_ihex_record(image, line, line_length, &base, &end);
+		else
+			ok = line[0] == 'S' && line_length >= 2U && image_parse_srec_record(image, line, line_length);
+		if (!ok) {
+			DEBUG_ERROR("Failed to parse %s image at line %zu\n", image_format_name(image->format), line_number);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool image_parse(image_s *const image, const void *const contents, const size_t size)
+{
+	memset(image, 0, sizeof(*image));
+	const uint8_t *const data = (const uint8_t *)contents;
+	size_t start = 0;
+	while (start < size && isspace(data[start]))
+		++start;
+
+	const char *const text = (const char *)data + start;
+	if (size >= 4U && memcmp(data, "\x7f" "ELF", 4U) == 0)
+		image->format = IMAGE_FORMAT_ELF;
+	else if (start < size && data[start] == ':' && image_text_record_valid(IMAGE_FORMAT_IHEX, text, size - start))
+		image->format = IMAGE_FORMAT_IHEX;
+	else if (start + 1U < size && data[start] == 'S' && isdigit(data[start + 1U]) &&
+		image_text_record_valid(IMAGE_FORMAT_SREC, text, size - start))
+		image->format = IMAGE_FORMAT_SREC;
+	else
+		return true;
+
+	bool result;
+	if (image->format == IMAGE_FORMAT_ELF)
+		result = image_parse_elf(image, data, size);
+	else
+		result = image_parse_text(image, text, size - start);
+	if (result)
+		result = image_finalise(image);
+	if (!result)
+		image_free(image);
+	return result;
+}
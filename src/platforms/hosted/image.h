@@ -0,0 +1,59 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_IMAGE_H
+#define PLATFORMS_HOSTED_IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum image_format {
+	IMAGE_FORMAT_BINARY,
+	IMAGE_FORMAT_ELF,
+	IMAGE_FORMAT_IHEX,
+	IMAGE_FORMAT_SREC,
+} image_format_e;
+
+/* A run of contiguous data to be placed at the given address */
+typedef struct image_segment {
+	uint32_t address;
+	size_t length;
+	size_t capacity;
+	uint8_t *data;
+} image_segment_s;
+
+/* A sparse firmware image: its segments are sorted by address and neither touch nor overlap */
+typedef struct image {
+	image_format_e format;
+	image_segment_s *segments;
+	size_t segment_count;
+} image_s;
+
+/*
+ * Work out what kind of image the file contents are and, for ELF, Intel HEX and S-record files,
+ * decode them into segments. The text formats are only recognised if their first record decodes, and
+ * anything unrecognised is reported as a flat binary with no segments.
+ * Returns false if the file looked like one of the image formats but is malformed.
+ */
+bool image_parse(image_s *image, const void *contents, size_t size);
+void image_free(image_s *image);
+const char *image_format_name(image_format_e format);
+/* The total number of data bytes across all the segments */
+size_t image_data_length(const image_s *image);
+
+#endif /* PLATFORMS_HOSTED_IMAGE_H */
@@ -47,6 +47,9 @@
 
 #include "bmp_remote.h"
 #include "bmp_hosted.h"
+#include "sim.h"
+#include "gang.h"
+#include "id_cache.h"
 #if HOSTED_BMP_ONLY == 0
 #include "stlinkv2.h"
 #include "ftdi_bmp.h"
@@ -90,6 +93,10 @@ static void exit_function(void)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		sim_exit_function();
+		break;
+
 	default:
 		break;
 	}
@@ -121,14 +128,21 @@ void platform_init(int argc, char **argv)
 	}
 #endif
 	cl_init(&cl_opts, argc, argv);
+	id_cache_init(cl_opts.opt_id_cache);
 	atexit(exit_function);
 	signal(SIGTERM, sigterm_handler);
 	signal(SIGINT, sigterm_handler);
 
+	/* Gang mode hands each probe off to a child process of its own, so there's no probe to open here */
+	if (cl_opts.opt_gang)
+		exit(gang_run(&cl_opts, argc, argv));
+
 	if (cl_opts.opt_device)
 		bmda_probe_info.type = PROBE_TYPE_BMP;
 	else if (cl_opts.opt_gpio_map)
 		bmda_probe_info.type = PROBE_TYPE_GPIOD;
+	else if (cl_opts.opt_sim)
+		bmda_probe_info.type = PROBE_TYPE_SIM;
 	else if (find_debuggers(&cl_opts, &bmda_probe_info))
 		exit(1);
 
@@ -172,6 +186,11 @@ void platform_init(int argc, char **argv)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		if (!sim_init(cl_opts.opt_sim))
+			exit(1);
+		break;
+
 	default:
 		exit(1);
 	}
@@ -200,6 +219,7 @@ bool bmda_swd_scan(const uint32_t targetid)
 	case PROBE_TYPE_FTDI:
 	case PROBE_TYPE_CMSIS_DAP:
 	case PROBE_TYPE_JLINK:
+	case PROBE_TYPE_SIM:
 #ifdef ENABLE_GPIOD
 	case PROBE_TYPE_GPIOD:
 #endif
@@ -217,13 +237,13 @@ bool bmda_swd_scan(const uint32_t targetid)
 
 bool bmda_swd_dp_init(adiv5_debug_port_s *dp)
 {
-#if HOSTED_BMP_ONLY == 1
-	(void)dp;
-#endif
 	switch (bmda_probe_info.type) {
 	case PROBE_TYPE_BMP:
 		return remote_swd_init();
 
+	case PROBE_TYPE_SIM:
+		return sim_swd_init(dp);
+
 #if HOSTED_BMP_ONLY == 0
 	case PROBE_TYPE_CMSIS_DAP:
 		return dap_swd_init(dp);
@@ -330,6 +350,10 @@ void bmda_adiv5_dp_init(adiv5_debug_port_s *const dp)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		sim_adiv5_dp_init(dp);
+		break;
+
 	default:
 		break;
 	}
@@ -414,11 +438,36 @@ char *bmda_adaptor_ident(void)
 	case PROBE_TYPE_GPIOD:
 		return "GPIOD";
 
+	case PROBE_TYPE_SIM:
+		return "Simulator";
+
 	default:
 		return NULL;
 	}
 }
 
+/* The most target memory the adaptor returns for a single request, used to size bulk reads */
+size_t bmda_max_mem_read(void)
+{
+	switch (bmda_probe_info.type) {
+	case PROBE_TYPE_BMP:
+		/* The data comes back hex encoded */
+		return (REMOTE_MAX_MSG_SIZE - 2U) / 2U;
+
+#if HOSTED_BMP_ONLY == 0
+	case PROBE_TYPE_CMSIS_DAP:
+		return dap_max_mem_read();
+#endif
+
+	case PROBE_TYPE_SIM:
+		return sim_max_mem_read();
+
+	default:
+		/* Everything else is at best limited by the 1KiB TAR auto-increment block */
+		return 1024U;
+	}
+}
+
 const char *platform_target_voltage(void)
 {
 	switch (bmda_probe_info.type) {
@@ -436,6 +485,9 @@ const char *platform_target_voltage(void)
 		return jlink_target_voltage_string();
 #endif
 
+	case PROBE_TYPE_SIM:
+		return "3.3V";
+
 	default:
 		return "Unknown";
 	}
@@ -466,6 +518,10 @@ void platform_nrst_set_val(bool assert)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		sim_nrst_set_val(assert);
+		break;
+
 	default:
 		break;
 	}
@@ -488,6 +544,9 @@ bool platform_nrst_get_val(void)
 		return ftdi_nrst_get_val();
 #endif
 
+	case PROBE_TYPE_SIM:
+		return sim_nrst_get_val();
+
 	default:
 		return false;
 	}
@@ -525,6 +584,10 @@ void platform_max_frequency_set(const uint32_t freq)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		sim_max_frequency_set(freq);
+		break;
+
 	default:
 		DEBUG_WARN("Setting max debug interface frequency not available or not yet implemented\n");
 		break;
@@ -560,6 +623,9 @@ uint32_t platform_max_frequency_get(void)
 		return jlink_max_frequency_get();
 #endif
 
+	case PROBE_TYPE_SIM:
+		return sim_max_frequency_get();
+
 	default:
 		DEBUG_WARN("Reading max debug interface frequency not available or not yet implemented\n");
 		return 0;
@@ -642,10 +708,29 @@ void platform_buffer_flush(void)
 	}
 }
 
+/*
+ * Pace the halt polling done while the target runs. Rather than sleeping for a fixed time, wait on GDB
+ * (and the RTT terminal) so anything they send is dealt with straight away, and otherwise poll again
+ * after an interval that starts short and doubles up to the configured maximum. A stop is then seen
+ * quickly after a resume or a step, and at worst one maximum interval late, without spinning.
+ */
 void platform_pace_poll(void)
 {
-	if (!cl_opts.fast_poll)
-		platform_delay(8);
+	static uint32_t interval = 0U;
+	static size_t rx_count = 0U;
+	/*
+	 * GDB having been heard from since last time means the target was just resumed or asked to halt,
+	 * so poll again straight away and restart the backoff
+	 */
+	if (gdb_if_rx_count() != rx_count) {
+		rx_count = gdb_if_rx_count();
+		interval = cl_opts.opt_poll_min;
+		return;
+	}
+	if (cl_opts.fast_poll || gdb_if_wait(interval))
+		interval = cl_opts.opt_poll_min;
+	else
+		interval = MIN(MAX(interval * 2U, 1U), cl_opts.opt_poll_max);
 }
 
 void platform_target_clk_output_enable(const bool enable)
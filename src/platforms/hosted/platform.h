@@ -38,6 +38,7 @@
 #include "timing.h"
 
 char *bmda_adaptor_ident(void);
+size_t bmda_max_mem_read(void);
 void platform_buffer_flush(void);
 
 #define PLATFORM_IDENT "(Black Magic Debug App) "
@@ -85,6 +86,7 @@ typedef enum probe_type {
 	PROBE_TYPE_CMSIS_DAP,
 	PROBE_TYPE_JLINK,
 	PROBE_TYPE_GPIOD,
+	PROBE_TYPE_SIM,
 } probe_type_e;
 
 void gdb_ident(char *p, int count);
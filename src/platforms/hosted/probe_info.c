@@ -67,6 +67,7 @@ probe_info_s *probe_info_add_by_id(probe_info_s *const list, const probe_type_e
 	probe_info->product = product;
 	probe_info->serial = serial;
 	probe_info->version = version;
+	probe_info->location = NULL;
 
 	probe_info->next = list;
 	return probe_info;
@@ -90,6 +91,7 @@ void probe_info_free(probe_info_s *const probe_info)
 	free((void *)probe_info->product);
 	free((void *)probe_info->serial);
 	free((void *)probe_info->version);
+	free((void *)probe_info->location);
 	free(probe_info);
 }
 
@@ -53,6 +53,8 @@ typedef struct probe_info {
 	const char *product;
 	const char *serial;
 	const char *version;
+	/* Where the probe is attached, in the form -L takes to open it without scanning for any others */
+	const char *location;
 
 	struct probe_info *next;
 } probe_info_s;
@@ -68,4 +70,8 @@ const probe_info_s *probe_info_correct_order(probe_info_s *list);
 const probe_info_s *probe_info_filter(const probe_info_s *list, const char *serial, size_t position);
 void probe_info_to_bmda_probe(const probe_info_s *probe, bmda_probe_s *info);
 
+/* Scan for every probe on the system once, as gang mode does, then release the list and the scan's resources */
+const probe_info_s *probe_info_scan(bmda_probe_s *info);
+void probe_info_scan_free(bmda_probe_s *info, const probe_info_s *list);
+
 #endif /* PLATFORMS_HOSTED_PROBE_INFO_H */
@@ -0,0 +1,154 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bmp_remote.h"
+#include "buffer_utils.h"
+#include "exception.h"
+
+#include "protocol_v4.h"
+#include "protocol_v5.h"
+#include "protocol_v5_defs.h"
+#include "protocol_v5_adiv5.h"
+#include "protocol_v5_adiv6.h"
+#include "protocol_v5_riscv.h"
+
+size_t remote_v5_frame_length = 0U;
+/* Whether the firmware can run queues of raw accesses for adiv5_debug_port_s::batch() */
+static bool remote_v5_batch_available = false;
+
+bool remote_v5_init(void)
+{
+	/* This version builds on everything v4 does, so start by setting that up */
+	if (!remote_v4_init())
+		return false;
+
+	/* Now find out which accelerations can take binary frames, and how large they may be */
+	platform_buffer_write(REMOTE_HL_FRAMES_STR, sizeof(REMOTE_HL_FRAMES_STR));
+
+	char buffer[REMOTE_MAX_MSG_SIZE];
+	const ssize_t length = platform_buffer_read(buffer, REMOTE_MAX_MSG_SIZE);
+	/* Check for communication failures */
+	if (length < 1 || buffer[0] != REMOTE_RESP_OK) {
+		DEBUG_ERROR("%s comms error: %zd\n", __func__, length);
+		return false;
+	}
+
+	const uint64_t frames = remote_decode_response(buffer + 1, length - 1);
+	remote_v5_frame_length = MIN(frames & REMOTE_FRAMES_SIZE_MASK, REMOTE_FRAME_MAX_LENGTH);
+	const uint32_t framed_accelerations = frames >> REMOTE_FRAMES_SHIFT;
+	remote_v5_batch_available = framed_accelerations & REMOTE_FRAMES_BATCH;
+	/* Our shortest useful frame is an ADIv6 memory write, anything less and we stick with text packets */
+	if (remote_v5_frame_length <= REMOTE_FRAME_ADIV6_MEM_WRITE_LENGTH) {
+		DEBUG_WARN("Firmware frames of %zu bytes are too small to use\n", remote_v5_frame_length);
+		return true;
+	}
+	DEBUG_INFO("Using binary frames of up to %zu bytes\n", remote_v5_frame_length);
+
+	/* Swap the accelerations that take frames over to their framed implementations */
+	if (remote_funcs.adiv5_init && (framed_accelerations & REMOTE_FRAMES_ADIV5))
+		remote_funcs.adiv5_init = remote_v5_adiv5_init;
+	if (remote_funcs.adiv6_init && (framed_accelerations & REMOTE_FRAMES_ADIV6))
+		remote_funcs.adiv6_init = remote_v5_adiv6_init;
+	if (remote_funcs.riscv_jtag_init && (framed_accelerations & REMOTE_FRAMES_RISCV))
+		remote_funcs.riscv_jtag_init = remote_v5_riscv_jtag_init;
+	return true;
+}
+
+bool remote_v5_adiv5_init(adiv5_debug_port_s *const dp)
+{
+	dp->low_access = remote_v5_adiv5_raw_access;
+	dp->dp_read = remote_v5_adiv5_dp_read;
+	dp->ap_read = remote_v5_adiv5_ap_read;
+	dp->ap_write = remote_v5_adiv5_ap_write;
+	dp->mem_read = remote_v5_adiv5_mem_read_bytes;
+	dp->mem_write = remote_v5_adiv5_mem_write_bytes;
+	if (remote_v5_batch_available)
+		dp->batch = remote_v5_adiv5_batch;
+	return true;
+}
+
+bool remote_v5_adiv6_init(adiv5_debug_port_s *const dp)
+{
+	dp->ap_read = remote_v5_adiv6_ap_read;
+	dp->ap_write = remote_v5_adiv6_ap_write;
+	dp->mem_read = remote_v5_adiv6_mem_read_bytes;
+	dp->mem_write = remote_v5_adiv6_mem_write_bytes;
+	return true;
+}
+
+bool remote_v5_riscv_jtag_init(riscv_dmi_s *const dmi)
+{
+	/* Framing only adds the batch, so let v4 set up the DTM and the single accesses */
+	if (!remote_v4_riscv_jtag_init(dmi))
+		return false;
+	dmi->batch = remote_v5_riscv_dmi_batch;
+	return true;
+}
+
+int remote_v5_frame_exchange(uint8_t *const frame, const size_t frame_size, const size_t payload_length)
+{
+	/* Fill in the frame header and trailer around the payload and send it all in one go */
+	frame[0] = REMOTE_FRAME_SOM;
+	write_le2(frame, 1U, (uint16_t)payload_length);
+	frame[REMOTE_FRAME_HEADER_LENGTH + payload_length] = REMOTE_EOM;
+	if (!platform_buffer_write(frame, payload_length + REMOTE_FRAME_OVERHEAD))
+		return -1;
+	/* Read back the response payload over the top of the request */
+	return platform_buffer_read_frame(frame, MIN(frame_size, remote_v5_frame_length));
+}
+
+bool remote_v5_check_error(
+	const char *const func, adiv5_debug_port_s *const dp, const uint8_t *const response, const int length)
+{
+	/* Check the response length for error codes */
+	if (length < 1) {
+		DEBUG_ERROR("%s comms error: %d\n", func, length);
+		return false;
+	}
+	/* Now check if the remote is reporting an error */
+	if (response[0] == REMOTE_RESP_ERR) {
+		if (length < (int)REMOTE_FRAME_RESULT_LENGTH) {
+			DEBUG_ERROR("%s: Truncated error response\n", func);
+			return false;
+		}
+		const uint64_t response_code = read_le8(response, 1U);
+		const uint8_t error = response_code & 0xffU;
+		/* If the error part of the response code indicates a fault, store the fault value */
+		if (error == REMOTE_ERROR_FAULT) {
+			dp->fault = response_code >> 8U;
+			/*
+			 * If we're not handling errors for a function where no-response is non-fatal,
+			 * then turn any no-response fault codes into a fatal exception.
+			 */
+			if (dp->fault == SWDP_ACK_NO_RESPONSE && strcmp(func, "remote_v5_adiv5_raw_access") != 0)
+				raise_exception(EXCEPTION_ERROR, "SWD invalid ACK");
+		}
+		/* If the error part indicates an exception had occurred, make that happen here too */
+		else if (error == REMOTE_ERROR_EXCEPTION)
+			raise_exception(response_code >> 8U, "Remote protocol exception");
+		/* Otherwise it's an unexpected error */
+		else
+			DEBUG_ERROR("%s: Unexpected error %u\n", func, error);
+	} /* Check if the remote is reporting a parameter error*/
+	else if (response[0] == REMOTE_RESP_PARERR)
+		DEBUG_ERROR("%s: !BUG! Firmware reported a parameter error\n", func);
+	/* Check if the firmware is reporting some other kind of error */
+	else if (response[0] != REMOTE_RESP_OK)
+		DEBUG_ERROR("%s: Firmware reported unexpected error: %c\n", func, response[0]);
+	/* Return whether the remote indicated the request was successful */
+	return response[0] == REMOTE_RESP_OK;
+}
@@ -0,0 +1,43 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_H
+#define PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "adiv5.h"
+#include "riscv_debug.h"
+
+/* The largest frame payload both we and the firmware can handle, as negotiated by remote_v5_init() */
+extern size_t remote_v5_frame_length;
+
+bool remote_v5_init(void);
+
+bool remote_v5_adiv5_init(adiv5_debug_port_s *dp);
+bool remote_v5_adiv6_init(adiv5_debug_port_s *dp);
+bool remote_v5_riscv_jtag_init(riscv_dmi_s *dmi);
+
+/*
+ * Send the request payload placed at frame + REMOTE_FRAME_HEADER_LENGTH as a frame, then read the
+ * response payload back into the start of frame. Returns the response length or a negative error.
+ */
+int remote_v5_frame_exchange(uint8_t *frame, size_t frame_size, size_t payload_length);
+bool remote_v5_check_error(const char *func, adiv5_debug_port_s *dp, const uint8_t *response, int length);
+
+#endif /*PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_H*/
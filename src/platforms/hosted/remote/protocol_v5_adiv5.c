@@ -0,0 +1,243 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bmp_remote.h"
+#include "buffer_utils.h"
+#include "protocol_v5.h"
+#include "protocol_v5_defs.h"
+#include "protocol_v5_adiv5.h"
+
+/* Fill in the leading part common to all ADIv5 request frames */
+static uint8_t *remote_v5_adiv5_request(
+	uint8_t *const frame, const char command, const uint8_t dev_index, const uint8_t apsel)
+{
+	uint8_t *const request = frame + REMOTE_FRAME_HEADER_LENGTH;
+	request[0] = REMOTE_ADIV5_PACKET;
+	request[1] = command;
+	request[2] = dev_index;
+	request[3] = apsel;
+	return request;
+}
+
+uint32_t remote_v5_adiv5_raw_access(
+	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t request_value)
+{
+	/* Remap the access from our current format to the remote register address format */
+	const uint16_t ap_reg = (addr & ADIV5_APnDP ? REMOTE_ADIV5_APnDP : 0U) | (addr & 0x00ffU);
+	uint8_t frame[REMOTE_FRAME_ADIV5_RAW_ACCESS_LENGTH + REMOTE_FRAME_RESULT_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* Create the request, using the AP select byte for R/!W, and send it to the remote */
+	uint8_t *const request = remote_v5_adiv5_request(frame, REMOTE_ADIV5_RAW_ACCESS, dp->dev_index, rnw);
+	write_le2(request, 4U, ap_reg);
+	write_le4(request, 6U, request_value);
+	const int length = remote_v5_frame_exchange(frame, sizeof(frame), REMOTE_FRAME_ADIV5_RAW_ACCESS_LENGTH);
+	/* Read back the answer and check for errors */
+	if (!remote_v5_check_error(__func__, dp, frame, length) || length < 5)
+		return 0U;
+	/* If the response indicates all's OK, decode the data read and return it */
+	const uint32_t result_value = read_le4(frame, 1U);
+	DEBUG_PROBE("%s: addr %04x %s %08" PRIx32, __func__, ap_reg, rnw ? "->" : "<-", rnw ? result_value : request_value);
+	if (!rnw)
+		DEBUG_PROBE(" -> %08" PRIx32, result_value);
+	DEBUG_PROBE("\n");
+	return result_value;
+}
+
+uint32_t remote_v5_adiv5_dp_read(adiv5_debug_port_s *const dp, const uint16_t addr)
+{
+	/* Remap the access from our current format to the remote register address format */
+	const uint16_t ap_reg = (addr & ADIV5_APnDP ? REMOTE_ADIV5_APnDP : 0U) | (addr & 0x00ffU);
+	uint8_t frame[REMOTE_FRAME_ADIV5_DP_READ_LENGTH + REMOTE_FRAME_RESULT_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* Create the request and send it to the remote */
+	uint8_t *const request = remote_v5_adiv5_request(frame, REMOTE_DP_READ, dp->dev_index, 0U);
+	write_le2(request, 4U, ap_reg);
+	const int length = remote_v5_frame_exchange(frame, sizeof(frame), REMOTE_FRAME_ADIV5_DP_READ_LENGTH);
+	/* Read back the answer and check for errors */
+	if (!remote_v5_check_error(__func__, dp, frame, length) || length < 5)
+		return 0U;
+	/* If the response indicates all's OK, decode the data read and return it */
+	const uint32_t value = read_le4(frame, 1U);
+	DEBUG_PROBE("%s: addr %04x -> %08" PRIx32 "\n", __func__, ap_reg, value);
+	return value;
+}
+
+uint32_t remote_v5_adiv5_ap_read(adiv5_access_port_s *const ap, const uint16_t addr)
+{
+	/* Remap the access from our current format to the remote register address format */
+	const uint16_t ap_reg = (addr & ADIV5_APnDP ? REMOTE_ADIV5_APnDP : 0U) | (addr & 0x00ffU);
+	uint8_t frame[REMOTE_FRAME_ADIV5_AP_READ_LENGTH + REMOTE_FRAME_RESULT_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* Create the request and send it to the remote */
+	uint8_t *const request = remote_v5_adiv5_request(frame, REMOTE_AP_READ, ap->dp->dev_index, ap->apsel);
+	write_le2(request, 4U, ap_reg);
+	const int length = remote_v5_frame_exchange(frame, sizeof(frame), REMOTE_FRAME_ADIV5_AP_READ_LENGTH);
+	/* Read back the answer and check for errors */
+	if (!remote_v5_check_error(__func__, ap->dp, frame, length) || length < 5)
+		return 0U;
+	/* If the response indicates all's OK, decode the data read and return it */
+	const uint32_t value = read_le4(frame, 1U);
+	DEBUG_PROBE("%s: addr %04x -> %08" PRIx32 "\n", __func__, ap_reg, value);
+	return value;
+}
+
+void remote_v5_adiv5_ap_write(adiv5_access_port_s *const ap, const uint16_t addr, const uint32_t value)
+{
+	/* Remap the access from our current format to the remote register address format */
+	const uint16_t ap_reg = (addr & ADIV5_APnDP ? REMOTE_ADIV5_APnDP : 0U) | (addr & 0x00ffU);
+	uint8_t frame[REMOTE_FRAME_ADIV5_AP_WRITE_LENGTH + REMOTE_FRAME_RESULT_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* Create the request and send it to the remote */
+	uint8_t *const request = remote_v5_adiv5_request(frame, REMOTE_AP_WRITE, ap->dp->dev_index, ap->apsel);
+	write_le2(request, 4U, ap_reg);
+	write_le4(request, 6U, value);
+	const int length = remote_v5_frame_exchange(frame, sizeof(frame), REMOTE_FRAME_ADIV5_AP_WRITE_LENGTH);
+	/* Read back the answer and check for errors */
+	if (!remote_v5_check_error(__func__, ap->dp, frame, length))
+		return;
+	DEBUG_PROBE("%s: addr %04x <- %08" PRIx32 "\n", __func__, ap_reg, value);
+}
+
+void remote_v5_adiv5_mem_read_bytes(
+	adiv5_access_port_s *const ap, void *const dest, const target_addr64_t src, const size_t read_length)
+{
+	/* Check if we have anything to do */
+	if (!read_length)
+		return;
+	uint8_t *const data = (uint8_t *)dest;
+	DEBUG_PROBE("%s: @%08" PRIx64 "+%zx\n", __func__, src, read_length);
+	uint8_t frame[REMOTE_FRAME_MAX_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* The data comes back raw after the response code, so we can use all but one byte of a frame */
+	const size_t blocksize = remote_v5_frame_length - 1U;
+	/* For each transfer block size, ask the firmware to read that block of bytes */
+	for (size_t offset = 0; offset < read_length; offset += blocksize) {
+		/* Pick the amount left to read or the block size, whichever is smaller */
+		const size_t amount = MIN(read_length - offset, blocksize);
+		/* Create the request and send it to the remote */
+		uint8_t *const request = remote_v5_adiv5_request(frame, REMOTE_MEM_READ, ap->dp->dev_index, ap->apsel);
+		write_le4(request, 4U, ap->csw);
+		write_le8(request, 8U, src + offset);
+		write_le4(request, 16U, amount);
+		const int length = remote_v5_frame_exchange(frame, sizeof(frame), REMOTE_FRAME_ADIV5_MEM_READ_LENGTH);
+
+		/* Read back the answer and check for errors */
+		if (!remote_v5_check_error(__func__, ap->dp, frame, length) || (size_t)length != amount + 1U) {
+			DEBUG_ERROR("%s error around 0x%08zx\n", __func__, (size_t)src + offset);
+			return;
+		}
+		/* If the response indicates all's OK, copy out the data read */
+		memcpy(data + offset, frame + 1U, amount);
+	}
+}
+
+void remote_v5_adiv5_mem_write_bytes(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *const src,
+	const size_t write_length, const align_e align)
+{
+	/* Check if we have anything to do */
+	if (!write_length)
+		return;
+	const uint8_t *const data = (const uint8_t *)src;
+	DEBUG_PROBE("%s: @%08" PRIx64 "+%zx alignment %u\n", __func__, dest, write_length, align);
+	uint8_t frame[REMOTE_FRAME_MAX_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* As we do, calculate how large a transfer we can do to the firmware, keeping to the alignment */
+	const size_t alignment_mask = ~((1U << align) - 1U);
+	const size_t blocksize = (remote_v5_frame_length - REMOTE_FRAME_ADIV5_MEM_WRITE_LENGTH) & alignment_mask;
+	/* For each transfer block size, ask the firmware to write that block of bytes */
+	for (size_t offset = 0; offset < write_length; offset += blocksize) {
+		/* Pick the amount left to write or the block size, whichever is smaller */
+		const size_t amount = MIN(write_length - offset, blocksize);
+		/* Create the request, with the data following it as-is */
+		uint8_t *const request = remote_v5_adiv5_request(frame, REMOTE_MEM_WRITE, ap->dp->dev_index, ap->apsel);
+		write_le4(request, 4U, ap->csw);
+		request[8] = align;
+		write_le8(request, 9U, dest + offset);
+		write_le4(request, 17U, amount);
+		memcpy(request + REMOTE_FRAME_ADIV5_MEM_WRITE_LENGTH, data + offset, amount);
+		const int length =
+			remote_v5_frame_exchange(frame, sizeof(frame), REMOTE_FRAME_ADIV5_MEM_WRITE_LENGTH + amount);
+
+		/* Read back the answer and check for errors */
+		if (!remote_v5_check_error(__func__, ap->dp, frame, length)) {
+			DEBUG_ERROR("%s error around 0x%08zx\n", __func__, (size_t)dest + offset);
+			return;
+		}
+	}
+}
+
+/* Send one frame's worth of a batch, and hand the values read back out to the accesses that asked for them */
+static bool remote_v5_adiv5_batch_frame(
+	adiv5_debug_port_s *const dp, uint8_t *const frame, const adiv5_batch_access_s *const accesses, const size_t count)
+{
+	uint8_t *const request = remote_v5_adiv5_request(frame, REMOTE_ADIV5_BATCH, dp->dev_index, 0U);
+	size_t read_count = 0U;
+	for (size_t idx = 0; idx < count; ++idx) {
+		const adiv5_batch_access_s *const access = &accesses[idx];
+		uint8_t *const encoded =
+			request + REMOTE_FRAME_ADIV5_BATCH_LENGTH + (idx * REMOTE_ADIV5_BATCH_ACCESS_LENGTH);
+		switch (access->op) {
+		case ADIV5_BATCH_WRITE:
+			encoded[0] = REMOTE_ADIV5_BATCH_WRITE;
+			break;
+		case ADIV5_BATCH_READ:
+			encoded[0] = REMOTE_ADIV5_BATCH_READ;
+			++read_count;
+			break;
+		case ADIV5_BATCH_WAIT:
+			encoded[0] = REMOTE_ADIV5_BATCH_WAIT;
+			break;
+		}
+		/* Remap the access from our current format to the remote register address format */
+		write_le2(encoded, 1U, (access->addr & ADIV5_APnDP ? REMOTE_ADIV5_APnDP : 0U) | (access->addr & 0x00ffU));
+		write_le4(encoded, 3U, access->value);
+	}
+	const int length = remote_v5_frame_exchange(frame, REMOTE_FRAME_MAX_LENGTH + REMOTE_FRAME_OVERHEAD,
+		REMOTE_FRAME_ADIV5_BATCH_LENGTH + (count * REMOTE_ADIV5_BATCH_ACCESS_LENGTH));
+	/*
+	 * Any failure here goes back to the caller to retry the slow way, so rather than raising the exceptions
+	 * remote_v5_check_error() would, only note down any fault for the caller to see.
+	 */
+	if (length < 1 || frame[0] != REMOTE_RESP_OK) {
+		if (length >= (int)REMOTE_FRAME_RESULT_LENGTH && frame[0] == REMOTE_RESP_ERR) {
+			const uint64_t response_code = read_le8(frame, 1U);
+			if ((response_code & 0xffU) == REMOTE_ERROR_FAULT)
+				dp->fault = response_code >> 8U;
+		}
+		DEBUG_ERROR("%s failed (fault = %u)\n", __func__, dp->fault);
+		return false;
+	}
+	if ((size_t)length != 1U + (read_count * 4U)) {
+		DEBUG_ERROR("%s: Expected %zu values, got %d bytes\n", __func__, read_count, length - 1);
+		return false;
+	}
+	for (size_t idx = 0, offset = 1U; idx < count; ++idx) {
+		if (accesses[idx].op != ADIV5_BATCH_READ)
+			continue;
+		*accesses[idx].result = read_le4(frame, offset);
+		offset += 4U;
+	}
+	return true;
+}
+
+bool remote_v5_adiv5_batch(adiv5_debug_port_s *const dp, const adiv5_batch_access_s *const accesses, const size_t count)
+{
+	DEBUG_PROBE("%s: %zu accesses\n", __func__, count);
+	uint8_t frame[REMOTE_FRAME_MAX_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* Work out how many accesses fit a frame, the values read back always taking less space than the request */
+	const size_t accesses_per_frame =
+		(remote_v5_frame_length - REMOTE_FRAME_ADIV5_BATCH_LENGTH) / REMOTE_ADIV5_BATCH_ACCESS_LENGTH;
+	for (size_t offset = 0; offset < count; offset += accesses_per_frame) {
+		if (!remote_v5_adiv5_batch_frame(dp, frame, accesses + offset, MIN(count - offset, accesses_per_frame)))
+			return false;
+	}
+	return true;
+}
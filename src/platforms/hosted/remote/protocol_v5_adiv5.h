@@ -0,0 +1,34 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_ADIV5_H
+#define PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_ADIV5_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "adiv5.h"
+
+uint32_t remote_v5_adiv5_raw_access(adiv5_debug_port_s *dp, uint8_t rnw, uint16_t addr, uint32_t request_value);
+uint32_t remote_v5_adiv5_dp_read(adiv5_debug_port_s *dp, uint16_t addr);
+uint32_t remote_v5_adiv5_ap_read(adiv5_access_port_s *ap, uint16_t addr);
+void remote_v5_adiv5_ap_write(adiv5_access_port_s *ap, uint16_t addr, uint32_t value);
+void remote_v5_adiv5_mem_read_bytes(adiv5_access_port_s *ap, void *dest, target_addr64_t src, size_t read_length);
+void remote_v5_adiv5_mem_write_bytes(
+	adiv5_access_port_s *ap, target_addr64_t dest, const void *src, size_t write_length, align_e align);
+bool remote_v5_adiv5_batch(adiv5_debug_port_s *dp, const adiv5_batch_access_s *accesses, size_t count);
+
+#endif /*PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_ADIV5_H*/
@@ -0,0 +1,134 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bmp_remote.h"
+#include "buffer_utils.h"
+#include "protocol_v5.h"
+#include "protocol_v5_defs.h"
+#include "protocol_v5_adiv6.h"
+
+/* Fill in the leading part common to all ADIv6 request frames */
+static uint8_t *remote_v5_adiv6_request(uint8_t *const frame, const char command, const adiv6_access_port_s *const ap)
+{
+	uint8_t *const request = frame + REMOTE_FRAME_HEADER_LENGTH;
+	request[0] = REMOTE_ADIV5_PACKET;
+	request[1] = REMOTE_ADIV6_PACKET;
+	request[2] = command;
+	request[3] = ap->base.dp->dev_index;
+	write_le8(request, 4U, ap->ap_address);
+	return request;
+}
+
+uint32_t remote_v5_adiv6_ap_read(adiv5_access_port_s *const base_ap, const uint16_t addr)
+{
+	adiv6_access_port_s *const ap = (adiv6_access_port_s *)base_ap;
+	uint8_t frame[REMOTE_FRAME_ADIV6_AP_READ_LENGTH + REMOTE_FRAME_RESULT_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* Create the request and send it to the remote */
+	uint8_t *const request = remote_v5_adiv6_request(frame, REMOTE_AP_READ, ap);
+	write_le2(request, 12U, addr);
+	const int length = remote_v5_frame_exchange(frame, sizeof(frame), REMOTE_FRAME_ADIV6_AP_READ_LENGTH);
+	/* Read back the answer and check for errors */
+	if (!remote_v5_check_error(__func__, ap->base.dp, frame, length) || length < 5)
+		return 0U;
+	/* If the response indicates all's OK, decode the data read and return it */
+	const uint32_t value = read_le4(frame, 1U);
+	DEBUG_PROBE("%s: addr %04x -> %08" PRIx32 "\n", __func__, addr, value);
+	return value;
+}
+
+void remote_v5_adiv6_ap_write(adiv5_access_port_s *const base_ap, const uint16_t addr, const uint32_t value)
+{
+	adiv6_access_port_s *const ap = (adiv6_access_port_s *)base_ap;
+	uint8_t frame[REMOTE_FRAME_ADIV6_AP_WRITE_LENGTH + REMOTE_FRAME_RESULT_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* Create the request and send it to the remote */
+	uint8_t *const request = remote_v5_adiv6_request(frame, REMOTE_AP_WRITE, ap);
+	write_le2(request, 12U, addr);
+	write_le4(request, 14U, value);
+	const int length = remote_v5_frame_exchange(frame, sizeof(frame), REMOTE_FRAME_ADIV6_AP_WRITE_LENGTH);
+	/* Read back the answer and check for errors */
+	if (!remote_v5_check_error(__func__, ap->base.dp, frame, length))
+		return;
+	DEBUG_PROBE("%s: addr %04x <- %08" PRIx32 "\n", __func__, addr, value);
+}
+
+void remote_v5_adiv6_mem_read_bytes(
+	adiv5_access_port_s *const base_ap, void *const dest, const target_addr64_t src, const size_t read_length)
+{
+	/* Check if we have anything to do */
+	if (!read_length)
+		return;
+	adiv6_access_port_s *const ap = (adiv6_access_port_s *)base_ap;
+	uint8_t *const data = (uint8_t *)dest;
+	DEBUG_PROBE("%s: @%08" PRIx64 "+%zx\n", __func__, src, read_length);
+	uint8_t frame[REMOTE_FRAME_MAX_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* The data comes back raw after the response code, so we can use all but one byte of a frame */
+	const size_t blocksize = remote_v5_frame_length - 1U;
+	/* For each transfer block size, ask the firmware to read that block of bytes */
+	for (size_t offset = 0; offset < read_length; offset += blocksize) {
+		/* Pick the amount left to read or the block size, whichever is smaller */
+		const size_t amount = MIN(read_length - offset, blocksize);
+		/* Create the request and send it to the remote */
+		uint8_t *const request = remote_v5_adiv6_request(frame, REMOTE_MEM_READ, ap);
+		write_le4(request, 12U, ap->base.csw);
+		write_le8(request, 16U, src + offset);
+		write_le4(request, 24U, amount);
+		const int length = remote_v5_frame_exchange(frame, sizeof(frame), REMOTE_FRAME_ADIV6_MEM_READ_LENGTH);
+
+		/* Read back the answer and check for errors */
+		if (!remote_v5_check_error(__func__, ap->base.dp, frame, length) || (size_t)length != amount + 1U) {
+			DEBUG_ERROR("%s error around 0x%08zx\n", __func__, (size_t)src + offset);
+			return;
+		}
+		/* If the response indicates all's OK, copy out the data read */
+		memcpy(data + offset, frame + 1U, amount);
+	}
+}
+
+void remote_v5_adiv6_mem_write_bytes(adiv5_access_port_s *const base_ap, const target_addr64_t dest,
+	const void *const src, const size_t write_length, const align_e align)
+{
+	/* Check if we have anything to do */
+	if (!write_length)
+		return;
+	adiv6_access_port_s *const ap = (adiv6_access_port_s *)base_ap;
+	const uint8_t *const data = (const uint8_t *)src;
+	DEBUG_PROBE("%s: @%08" PRIx64 "+%zx alignment %u\n", __func__, dest, write_length, align);
+	uint8_t frame[REMOTE_FRAME_MAX_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* As we do, calculate how large a transfer we can do to the firmware, keeping to the alignment */
+	const size_t alignment_mask = ~((1U << align) - 1U);
+	const size_t blocksize = (remote_v5_frame_length - REMOTE_FRAME_ADIV6_MEM_WRITE_LENGTH) & alignment_mask;
+	/* For each transfer block size, ask the firmware to write that block of bytes */
+	for (size_t offset = 0; offset < write_length; offset += blocksize) {
+		/* Pick the amount left to write or the block size, whichever is smaller */
+		const size_t amount = MIN(write_length - offset, blocksize);
+		/* Create the request, with the data following it as-is */
+		uint8_t *const request = remote_v5_adiv6_request(frame, REMOTE_MEM_WRITE, ap);
+		write_le4(request, 12U, ap->base.csw);
+		request[16] = align;
+		write_le8(request, 17U, dest + offset);
+		write_le4(request, 25U, amount);
+		memcpy(request + REMOTE_FRAME_ADIV6_MEM_WRITE_LENGTH, data + offset, amount);
+		const int length =
+			remote_v5_frame_exchange(frame, sizeof(frame), REMOTE_FRAME_ADIV6_MEM_WRITE_LENGTH + amount);
+
+		/* Read back the answer and check for errors */
+		if (!remote_v5_check_error(__func__, ap->base.dp, frame, length)) {
+			DEBUG_ERROR("%s error around 0x%08zx\n", __func__, (size_t)dest + offset);
+			return;
+		}
+	}
+}
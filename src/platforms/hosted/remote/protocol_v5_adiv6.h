@@ -0,0 +1,31 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_ADIV6_H
+#define PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_ADIV6_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "adiv6.h"
+
+uint32_t remote_v5_adiv6_ap_read(adiv5_access_port_s *base_ap, uint16_t addr);
+void remote_v5_adiv6_ap_write(adiv5_access_port_s *base_ap, uint16_t addr, uint32_t value);
+void remote_v5_adiv6_mem_read_bytes(adiv5_access_port_s *base_ap, void *dest, target_addr64_t src, size_t read_length);
+void remote_v5_adiv6_mem_write_bytes(
+	adiv5_access_port_s *base_ap, target_addr64_t dest, const void *src, size_t write_length, align_e align);
+
+#endif /*PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_ADIV6_H*/
@@ -0,0 +1,94 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_DEFS_H
+#define PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_DEFS_H
+
+/* Bring in the v4 protocol definitions, which this version only extends */
+#include "protocol_v4_defs.h"
+
+/*
+ * This version of the protocol introduces binary frames for the ADIv5 and ADIv6 accelerations:
+ * REMOTE_FRAME_SOM, the payload length as a 16-bit little endian value, the payload, then REMOTE_EOM
+ */
+#define REMOTE_FRAME_SOM '\x02'
+/* 1 start byte and 2 length bytes lead the payload, and one trailer byte follows it */
+#define REMOTE_FRAME_HEADER_LENGTH 3U
+#define REMOTE_FRAME_OVERHEAD      4U
+/* The largest frame payload we will use, whatever the firmware offers */
+#define REMOTE_FRAME_MAX_LENGTH 4096U
+
+/* High-level protocol message for asking which accelerations take frames, and how large */
+#define REMOTE_HL_FRAMES 'B'
+
+#define REMOTE_HL_FRAMES_STR                                          \
+	(char[])                                                          \
+	{                                                                 \
+		REMOTE_SOM, REMOTE_HL_PACKET, REMOTE_HL_FRAMES, REMOTE_EOM, 0 \
+	}
+
+/* The reply packs the largest payload into the bottom 32 bits, and which accelerations take frames into the top */
+#define REMOTE_FRAMES_SIZE_MASK 0xffffffffU
+#define REMOTE_FRAMES_ADIV5     (1U << 0U)
+#define REMOTE_FRAMES_ADIV6     (1U << 1U)
+#define REMOTE_FRAMES_BATCH     (1U << 2U)
+#define REMOTE_FRAMES_RISCV     (1U << 3U)
+#define REMOTE_FRAMES_SHIFT     32U
+
+/*
+ * Fixed part of each ADIv5 request frame: the packet type and command, the dev index and AP select
+ * (or R/!W for raw accesses), then the parameters listed per request, all little endian
+ */
+#define REMOTE_FRAME_ADIV5_DP_READ_LENGTH    6U  /* 16-bit address */
+#define REMOTE_FRAME_ADIV5_RAW_ACCESS_LENGTH 10U /* 16-bit address and 32-bit value */
+#define REMOTE_FRAME_ADIV5_AP_READ_LENGTH    6U  /* 16-bit address */
+#define REMOTE_FRAME_ADIV5_AP_WRITE_LENGTH   10U /* 16-bit address and 32-bit value */
+#define REMOTE_FRAME_ADIV5_MEM_READ_LENGTH   20U /* 32-bit CSW, 64-bit address and 32-bit count */
+#define REMOTE_FRAME_ADIV5_MEM_WRITE_LENGTH  21U /* CSW, 8-bit alignment, address, count, then the data */
+#define REMOTE_FRAME_ADIV5_BATCH_LENGTH      4U  /* Followed by the queued accesses */
+
+/* Frames may carry a queue of raw DP/AP accesses, each the operation, 16-bit address and 32-bit value */
+#define REMOTE_ADIV5_BATCH               'Q'
+#define REMOTE_ADIV5_BATCH_ACCESS_LENGTH 7U
+#define REMOTE_ADIV5_BATCH_WRITE         'W'
+#define REMOTE_ADIV5_BATCH_READ          'R'
+#define REMOTE_ADIV5_BATCH_WAIT          'w'
+
+/*
+ * Fixed part of each ADIv6 request frame: the packet type, '6' and command, the dev index
+ * and 64-bit AP base address, then the same parameters as for ADIv5
+ */
+#define REMOTE_FRAME_ADIV6_AP_READ_LENGTH   14U
+#define REMOTE_FRAME_ADIV6_AP_WRITE_LENGTH  18U
+#define REMOTE_FRAME_ADIV6_MEM_READ_LENGTH  28U
+#define REMOTE_FRAME_ADIV6_MEM_WRITE_LENGTH 29U
+
+/*
+ * The one RISC-V request frame is a batch: the packet type and command, the dev index, idle cycles and
+ * address width, then the queued DMI accesses, each the operation, 32-bit address and 32-bit value
+ */
+#define REMOTE_RISCV_BATCH               'Q'
+#define REMOTE_FRAME_RISCV_BATCH_LENGTH  5U
+#define REMOTE_RISCV_BATCH_ACCESS_LENGTH 9U
+#define REMOTE_RISCV_BATCH_WRITE         'W'
+#define REMOTE_RISCV_BATCH_READ          'R'
+#define REMOTE_RISCV_BATCH_WAIT_CLEAR    'c'
+
+/* Response frames start with the response code, then either the data or a 64-bit result value */
+#define REMOTE_FRAME_RESULT_LENGTH 9U
+
+#endif /*PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_DEFS_H*/
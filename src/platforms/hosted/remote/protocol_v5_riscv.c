@@ -0,0 +1,92 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bmp_remote.h"
+#include "buffer_utils.h"
+#include "protocol_v5.h"
+#include "protocol_v5_defs.h"
+#include "protocol_v5_riscv.h"
+
+/* Send one frame's worth of a batch, and hand the values read back out to the accesses that asked for them */
+static bool remote_v5_riscv_dmi_batch_frame(
+	riscv_dmi_s *const dmi, uint8_t *const frame, const riscv_dmi_batch_access_s *const accesses, const size_t count)
+{
+	uint8_t *const request = frame + REMOTE_FRAME_HEADER_LENGTH;
+	request[0] = REMOTE_RISCV_PACKET;
+	request[1] = REMOTE_RISCV_BATCH;
+	request[2] = dmi->dev_index;
+	request[3] = dmi->idle_cycles;
+	request[4] = dmi->address_width;
+	size_t read_count = 0U;
+	for (size_t idx = 0; idx < count; ++idx) {
+		const riscv_dmi_batch_access_s *const access = &accesses[idx];
+		uint8_t *const encoded =
+			request + REMOTE_FRAME_RISCV_BATCH_LENGTH + (idx * REMOTE_RISCV_BATCH_ACCESS_LENGTH);
+		switch (access->op) {
+		case RISCV_DMI_BATCH_WRITE:
+			encoded[0] = REMOTE_RISCV_BATCH_WRITE;
+			break;
+		case RISCV_DMI_BATCH_READ:
+			encoded[0] = REMOTE_RISCV_BATCH_READ;
+			++read_count;
+			break;
+		case RISCV_DMI_BATCH_WAIT_CLEAR:
+			encoded[0] = REMOTE_RISCV_BATCH_WAIT_CLEAR;
+			break;
+		}
+		write_le4(encoded, 1U, access->address);
+		write_le4(encoded, 5U, access->value);
+	}
+	const int length = remote_v5_frame_exchange(frame, REMOTE_FRAME_MAX_LENGTH + REMOTE_FRAME_OVERHEAD,
+		REMOTE_FRAME_RISCV_BATCH_LENGTH + (count * REMOTE_RISCV_BATCH_ACCESS_LENGTH));
+	/* Any failure here goes back to the caller to retry the slow way, so only note down any fault */
+	if (length < 1 || frame[0] != REMOTE_RESP_OK) {
+		if (length >= (int)REMOTE_FRAME_RESULT_LENGTH && frame[0] == REMOTE_RESP_ERR) {
+			const uint64_t response_code = read_le8(frame, 1U);
+			if ((response_code & 0xffU) == REMOTE_ERROR_FAULT)
+				dmi->fault = response_code >> 8U;
+		}
+		DEBUG_ERROR("%s failed (fault = %u)\n", __func__, dmi->fault);
+		return false;
+	}
+	if ((size_t)length != 1U + (read_count * 4U)) {
+		DEBUG_ERROR("%s: Expected %zu values, got %d bytes\n", __func__, read_count, length - 1);
+		return false;
+	}
+	for (size_t idx = 0, offset = 1U; idx < count; ++idx) {
+		if (accesses[idx].op != RISCV_DMI_BATCH_READ)
+			continue;
+		*accesses[idx].result = read_le4(frame, offset);
+		offset += 4U;
+	}
+	return true;
+}
+
+bool remote_v5_riscv_dmi_batch(
+	riscv_dmi_s *const dmi, const riscv_dmi_batch_access_s *const accesses, const size_t count)
+{
+	DEBUG_PROBE("%s: %zu accesses\n", __func__, count);
+	uint8_t frame[REMOTE_FRAME_MAX_LENGTH + REMOTE_FRAME_OVERHEAD];
+	/* Work out how many accesses fit a frame, the values read back always taking less space than the request */
+	const size_t accesses_per_frame =
+		(remote_v5_frame_length - REMOTE_FRAME_RISCV_BATCH_LENGTH) / REMOTE_RISCV_BATCH_ACCESS_LENGTH;
+	for (size_t offset = 0; offset < count; offset += accesses_per_frame) {
+		if (!remote_v5_riscv_dmi_batch_frame(dmi, frame, accesses + offset, MIN(count - offset, accesses_per_frame)))
+			return false;
+	}
+	return true;
+}
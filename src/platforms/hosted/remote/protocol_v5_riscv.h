@@ -0,0 +1,27 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_RISCV_H
+#define PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_RISCV_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "riscv_debug.h"
+
+bool remote_v5_riscv_dmi_batch(riscv_dmi_s *dmi, const riscv_dmi_batch_access_s *accesses, size_t count);
+
+#endif /*PLATFORMS_HOSTED_REMOTE_PROTOCOL_V5_RISCV_H*/
@@ -364,3 +364,63 @@ int platform_buffer_read(void *const data, const size_t length)
 	}
 	return length;
 }
+
+/* Copy exactly the requested amount of data out of the read buffer, refilling it as needed. A NULL data skips it */
+static ssize_t bmda_read_exact(uint8_t *const data, const size_t length, const uint32_t end_time)
+{
+	for (size_t offset = 0; offset < length;) {
+		while (read_buffer_offset == read_buffer_fullness) {
+			const ssize_t result = bmda_read_more_data(end_time);
+			if (result < 0)
+				return result;
+		}
+		const size_t amount = MIN(length - offset, read_buffer_fullness - read_buffer_offset);
+		if (data)
+			memcpy(data + offset, read_buffer + read_buffer_offset, amount);
+		read_buffer_offset += amount;
+		offset += amount;
+	}
+	return 0;
+}
+
+int platform_buffer_read_frame(void *const data, const size_t length)
+{
+	uint8_t *const buffer = (uint8_t *)data;
+	const uint32_t end_time = platform_time_ms() + cortexm_wait_timeout;
+	/* Drain the buffer for the remote till we see a start-of-frame byte */
+	for (char response = 0; response != REMOTE_FRAME_SOM;) {
+		while (read_buffer_offset == read_buffer_fullness) {
+			const ssize_t result = bmda_read_more_data(end_time);
+			if (result < 0)
+				return result;
+		}
+		response = read_buffer[read_buffer_offset++];
+	}
+	/* Grab the payload length and check it will fit */
+	uint8_t header[2U];
+	ssize_t result = bmda_read_exact(header, sizeof(header), end_time);
+	if (result < 0)
+		return result;
+	const size_t frame_length = header[0] | ((size_t)header[1] << 8U);
+	if (frame_length > length) {
+		DEBUG_ERROR("Response frame too long (%zu > %zu)\n", frame_length, length);
+		/* Skip over the payload and end of message marker so the next read starts on a frame boundary */
+		result = bmda_read_exact(NULL, frame_length + 1U, end_time);
+		return result < 0 ? result : -5;
+	}
+	/* Now collect the payload and the end of message marker that should follow it */
+	result = bmda_read_exact(buffer, frame_length, end_time);
+	if (result < 0)
+		return result;
+	uint8_t trailer = 0U;
+	result = bmda_read_exact(&trailer, 1U, end_time);
+	if (result < 0)
+		return result;
+	if (trailer != REMOTE_EOM) {
+		DEBUG_ERROR("Response frame not terminated correctly\n");
+		return -5;
+	}
+	DEBUG_WIRE("       frame of %zu bytes\n", frame_length);
+	return (int)frame_length;
+}
+
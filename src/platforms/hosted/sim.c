@@ -0,0 +1,643 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements a simulated SWD adaptor for BMDA, selected with --sim, so the cost of the
+ * ADIv5 layers and the target drivers above them can be measured without any hardware attached.
+ *
+ * The adaptor is modelled on CMSIS-DAP: every call into it is one or more request/response
+ * exchanges over a link with a fixed round-trip latency, a per-byte cost and a maximum packet
+ * size, and every DP/AP access in an exchange costs one SWD transfer at the configured clock.
+ * Nothing sleeps - instead a modelled clock is advanced, which the simulated target runs against,
+ * and the time, round trips, transfers and bytes moved are accounted per operation type and
+ * printed on exit.
+ */
+
+#include "general.h"
+#include "swd.h"
+#include "adiv5.h"
+#include "buffer_utils.h"
+#include "sim.h"
+
+/* A transfer is the 8-bit request, turnaround, 3-bit ACK, turnaround and 33 bits of data + parity */
+#define SIM_SWD_TRANSFER_CYCLES 46U
+/* How many times a WAIT in a batch re-reads its register before giving up, as DAP_TransferConfigure would */
+#define SIM_MATCH_RETRIES 100U
+
+/* DP identity: an ARM SW-DP, DPv1, not a minimal DP */
+#define SIM_DPIDR 0x1ba01477U
+/* AP 0 is the revision 1 AHB-AP genuine STM32F1 parts have, and the ROM table it points at */
+#define SIM_AHB_AP_IDR 0x14770011U
+#define SIM_AHB_AP_BASE 0xe00ff003U
+/* TAR only auto-increments within a 1KiB block */
+#define SIM_TAR_WRAP 0x3ffU
+
+/* Sizes of the CMSIS-DAP style framing the link costs are worked out from */
+#define SIM_TRANSFER_REQUEST_HEADER  3U
+#define SIM_TRANSFER_RESPONSE_HEADER 3U
+#define SIM_BLOCK_REQUEST_HEADER     5U
+#define SIM_BLOCK_RESPONSE_HEADER    4U
+
+typedef struct sim_link {
+	const char *name;
+	const char *description;
+	uint32_t round_trip_ns;
+	uint32_t byte_ns;
+	uint16_t packet_size;
+} sim_link_s;
+
+typedef enum sim_op {
+	SIM_OP_REG_READ,
+	SIM_OP_REG_WRITE,
+	SIM_OP_MEM_READ,
+	SIM_OP_MEM_WRITE,
+	SIM_OP_BATCH,
+	SIM_OP_CONTROL,
+	SIM_OP_COUNT,
+} sim_op_e;
+
+typedef struct sim_stats {
+	uint64_t calls;
+	uint64_t transfers;
+	uint64_t round_trips;
+	uint64_t bytes_out;
+	uint64_t bytes_in;
+	uint64_t time_ns;
+} sim_stats_s;
+
+static const sim_link_s sim_links[] = {
+	{"usb-fs", "USB full-speed CMSIS-DAP", 1000000U, 1000U, 64U},
+	{"usb-hs", "USB high-speed CMSIS-DAP", 250000U, 25U, 512U},
+	{"tcp", "CMSIS-DAP over a LAN", 200000U, 80U, 1024U},
+	{"none", "zero cost link", 0U, 0U, 1024U},
+};
+
+static const char *const sim_op_names[SIM_OP_COUNT] = {
+	"reg read",
+	"reg write",
+	"mem read",
+	"mem write",
+	"batch",
+	"control",
+};
+
+static sim_link_s sim_link;
+static sim_stats_s sim_stats[SIM_OP_COUNT];
+static uint64_t sim_now_ns;
+static uint32_t sim_frequency = 4000000U;
+static bool sim_nrst;
+
+/* DP and AHB-AP state */
+static uint32_t sim_ctrlstat;
+static uint32_t sim_select;
+static uint32_t sim_rdbuff;
+static uint32_t sim_csw;
+static uint32_t sim_tar;
+
+/* The operation, and the time it started, currently being accounted for */
+static sim_op_e sim_current_op;
+static uint64_t sim_op_start_ns;
+
+uint64_t sim_time_ns(void)
+{
+	return sim_now_ns;
+}
+
+void sim_stall_until(const uint64_t time_ns)
+{
+	if (time_ns > sim_now_ns)
+		sim_now_ns = time_ns;
+}
+
+void sim_delay(const uint32_t ms)
+{
+	sim_now_ns += ms * UINT64_C(1000000);
+}
+
+void sim_counters(sim_counters_s *const counters)
+{
+	memset(counters, 0, sizeof(*counters));
+	counters->time_ns = sim_now_ns;
+	for (size_t op = 0; op < SIM_OP_COUNT; ++op) {
+		counters->transfers += sim_stats[op].transfers;
+		counters->round_trips += sim_stats[op].round_trips;
+		counters->bytes += sim_stats[op].bytes_out + sim_stats[op].bytes_in;
+	}
+}
+
+const char *sim_link_name(void)
+{
+	return sim_link.name;
+}
+
+static void sim_op_begin(const sim_op_e op)
+{
+	sim_current_op = op;
+	sim_op_start_ns = sim_now_ns;
+	++sim_stats[op].calls;
+}
+
+static void sim_op_end(void)
+{
+	sim_stats[sim_current_op].time_ns += sim_now_ns - sim_op_start_ns;
+}
+
+/* Send the request half of an exchange; the transfers it carries then happen before the response */
+static void sim_exchange_begin(const size_t bytes_out)
+{
+	sim_stats_s *const stats = &sim_stats[sim_current_op];
+	++stats->round_trips;
+	stats->bytes_out += bytes_out;
+	sim_now_ns += sim_link.round_trip_ns / 2U + (uint64_t)bytes_out * sim_link.byte_ns;
+}
+
+static void sim_exchange_end(const size_t bytes_in)
+{
+	sim_stats[sim_current_op].bytes_in += bytes_in;
+	sim_now_ns += sim_link.round_trip_ns - sim_link.round_trip_ns / 2U + (uint64_t)bytes_in * sim_link.byte_ns;
+}
+
+/* Account the wire time of one SWD transfer */
+static void sim_transfer(void)
+{
+	++sim_stats[sim_current_op].transfers;
+	sim_now_ns += (SIM_SWD_TRANSFER_CYCLES * UINT64_C(1000000000)) / sim_frequency;
+}
+
+static uint32_t sim_ap_read(const uint8_t reg)
+{
+	switch (reg) {
+	case 0x00U:
+		return sim_csw | ADIV5_AP_CSW_AP_ENABLED;
+	case 0x04U:
+		return sim_tar;
+	case 0x0cU:
+	case 0x10U:
+	case 0x14U:
+	case 0x18U:
+	case 0x1cU: {
+		/* DRW accesses TAR, the banked data registers the 16 bytes TAR points into */
+		const uint32_t addr = reg == 0x0cU ? sim_tar : (sim_tar & ~0xfU) + (reg & 0x0cU);
+		const uint8_t size = 1U << (sim_csw & ADIV5_AP_CSW_SIZE_MASK);
+		uint32_t value = 0;
+		if (!sim_target_read(addr, size, &value)) {
+			sim_ctrlstat |= ADIV5_DP_CTRLSTAT_STICKYERR;
+			return 0U;
+		}
+		if (reg == 0x0cU && (sim_csw & ADIV5_AP_CSW_ADDRINC_MASK) == ADIV5_AP_CSW_ADDRINC_SINGLE)
+			sim_tar = (sim_tar & ~SIM_TAR_WRAP) | ((sim_tar + size) & SIM_TAR_WRAP);
+		/* The data shows up on the byte lanes matching the address */
+		return value << ((addr & 3U) * 8U);
+	}
+	case 0xf4U:
+		return 0U;
+	case 0xf8U:
+		return SIM_AHB_AP_BASE;
+	case 0xfcU:
+		return SIM_AHB_AP_IDR;
+	default:
+		return 0U;
+	}
+}
+
+static void sim_ap_write(const uint8_t reg, const uint32_t value)
+{
+	switch (reg) {
+	case 0x00U:
+		sim_csw = value & ~(ADIV5_AP_CSW_TRINPROG | ADIV5_AP_CSW_AP_ENABLED);
+		break;
+	case 0x04U:
+		sim_tar = value;
+		break;
+	case 0x0cU:
+	case 0x10U:
+	case 0x14U:
+	case 0x18U:
+	case 0x1cU: {
+		const uint32_t addr = reg == 0x0cU ? sim_tar : (sim_tar & ~0xfU) + (reg & 0x0cU);
+		const uint8_t size = 1U << (sim_csw & ADIV5_AP_CSW_SIZE_MASK);
+		const uint32_t data = size == 4U ? value : (value >> ((addr & 3U) * 8U)) & ((1U << (size * 8U)) - 1U);
+		if (!sim_target_write(addr, size, data)) {
+			sim_ctrlstat |= ADIV5_DP_CTRLSTAT_STICKYERR;
+			break;
+		}
+		if (reg == 0x0cU && (sim_csw & ADIV5_AP_CSW_ADDRINC_MASK) == ADIV5_AP_CSW_ADDRINC_SINGLE)
+			sim_tar = (sim_tar & ~SIM_TAR_WRAP) | ((sim_tar + size) & SIM_TAR_WRAP);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+/*
+ * Perform one DP or AP register access as the adaptor would, with non-posted semantics for AP reads.
+ * AP accesses are answered with FAULT while a sticky error is pending.
+ */
+static uint32_t sim_reg_access(
+	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	sim_transfer();
+	const uint8_t reg = addr & 0x0cU;
+	if (addr & ADIV5_APnDP) {
+		if (sim_ctrlstat & ADIV5_DP_CTRLSTAT_STICKYERR) {
+			if (dp)
+				dp->fault = SWDP_ACK_FAULT;
+			return 0U;
+		}
+		/* Only AP 0 exists, the rest read as all zeros so they're skipped over */
+		if (sim_select >> 24U)
+			return 0U;
+		const uint8_t ap_reg = (sim_select & 0xf0U) | reg;
+		if (rnw == ADIV5_LOW_WRITE) {
+			sim_ap_write(ap_reg, value);
+			return 0U;
+		}
+		sim_rdbuff = sim_ap_read(ap_reg);
+		return sim_rdbuff;
+	}
+
+	if (rnw == ADIV5_LOW_WRITE) {
+		switch (reg) {
+		case 0x0U:
+			if (value & ADIV5_DP_ABORT_STKERRCLR)
+				sim_ctrlstat &= ~ADIV5_DP_CTRLSTAT_STICKYERR;
+			break;
+		case 0x4U:
+			sim_ctrlstat = (sim_ctrlstat & ADIV5_DP_CTRLSTAT_STICKYERR) |
+				(value & (ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ | ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ));
+			break;
+		case 0x8U:
+			sim_select = value;
+			break;
+		default:
+			break;
+		}
+		return 0U;
+	}
+	switch (reg) {
+	case 0x0U:
+		return SIM_DPIDR;
+	case 0x4U:
+		/* Power-up requests are acknowledged immediately */
+		return sim_ctrlstat | ((sim_ctrlstat & ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ) << 1U) |
+			((sim_ctrlstat & ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ) << 1U);
+	case 0xcU:
+		return sim_rdbuff;
+	default:
+		return 0U;
+	}
+}
+
+/* One DAP_Transfer style exchange carrying a single register access */
+static uint32_t sim_single_access(
+	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	sim_op_begin(rnw == ADIV5_LOW_READ ? SIM_OP_REG_READ : SIM_OP_REG_WRITE);
+	sim_exchange_begin(SIM_TRANSFER_REQUEST_HEADER + 1U + (rnw == ADIV5_LOW_READ ? 0U : 4U));
+	const uint32_t result = sim_reg_access(dp, rnw, addr, value);
+	sim_exchange_end(SIM_TRANSFER_RESPONSE_HEADER + (rnw == ADIV5_LOW_READ ? 4U : 0U));
+	sim_op_end();
+	DEBUG_PROBE("%s: %s 0x%04x 0x%08" PRIx32 "\n", __func__, rnw == ADIV5_LOW_READ ? "read" : "write", addr,
+		rnw == ADIV5_LOW_READ ? result : value);
+	return result;
+}
+
+static bool sim_write_no_check(const uint16_t addr, const uint32_t data)
+{
+	sim_single_access(NULL, ADIV5_LOW_WRITE, addr, data);
+	return false;
+}
+
+static uint32_t sim_read_no_check(const uint16_t addr)
+{
+	return sim_single_access(NULL, ADIV5_LOW_READ, addr, 0U);
+}
+
+static uint32_t sim_dp_read(adiv5_debug_port_s *const dp, const uint16_t addr)
+{
+	return sim_single_access(dp, ADIV5_LOW_READ, addr, 0U);
+}
+
+static uint32_t sim_low_access(
+	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	return sim_single_access(dp, rnw, addr, value);
+}
+
+static uint32_t sim_error(adiv5_debug_port_s *const dp, const bool protocol_recovery)
+{
+	(void)protocol_recovery;
+	/* Read CTRL/STAT and clear whatever was set through ABORT in one exchange */
+	sim_op_begin(SIM_OP_CONTROL);
+	sim_exchange_begin(SIM_TRANSFER_REQUEST_HEADER + 1U + 5U);
+	const uint32_t error = sim_reg_access(dp, ADIV5_LOW_READ, ADIV5_DP_CTRLSTAT, 0U) & ADIV5_DP_CTRLSTAT_STICKYERR;
+	sim_reg_access(dp, ADIV5_LOW_WRITE, ADIV5_DP_ABORT, ADIV5_DP_ABORT_STKERRCLR);
+	sim_exchange_end(SIM_TRANSFER_RESPONSE_HEADER + 4U);
+	sim_op_end();
+	dp->fault = 0U;
+	return error;
+}
+
+static void sim_abort(adiv5_debug_port_s *const dp, const uint32_t abort)
+{
+	sim_single_access(dp, ADIV5_LOW_WRITE, ADIV5_DP_ABORT, abort);
+}
+
+/* The line sequences are only clocked out, so only cost the wire time of sending them */
+static void sim_seq_out(const uint32_t tms_states, const size_t clock_cycles)
+{
+	(void)tms_states;
+	sim_op_begin(SIM_OP_CONTROL);
+	sim_exchange_begin(2U + (clock_cycles + 7U) / 8U);
+	sim_now_ns += (clock_cycles * UINT64_C(1000000000)) / sim_frequency;
+	sim_exchange_end(1U);
+	sim_op_end();
+}
+
+static void sim_seq_out_parity(const uint32_t tms_states, const size_t clock_cycles)
+{
+	sim_seq_out(tms_states, clock_cycles + 1U);
+}
+
+static uint32_t sim_seq_in(const size_t clock_cycles)
+{
+	sim_seq_out(0U, clock_cycles);
+	return 0U;
+}
+
+static bool sim_seq_in_parity(uint32_t *const ret, const size_t clock_cycles)
+{
+	*ret = sim_seq_in(clock_cycles + 1U);
+	return false;
+}
+
+bool sim_swd_init(adiv5_debug_port_s *const dp)
+{
+	DEBUG_PROBE("-> %s\n", __func__);
+	swd_proc.seq_in = sim_seq_in;
+	swd_proc.seq_in_parity = sim_seq_in_parity;
+	swd_proc.seq_out = sim_seq_out;
+	swd_proc.seq_out_parity = sim_seq_out_parity;
+
+	dp->write_no_check = sim_write_no_check;
+	dp->read_no_check = sim_read_no_check;
+	dp->dp_read = sim_dp_read;
+	dp->low_access = sim_low_access;
+	dp->error = sim_error;
+	dp->abort = sim_abort;
+	return true;
+}
+
+static uint32_t sim_adiv5_ap_read(adiv5_access_port_s *const ap, const uint16_t addr)
+{
+	/* SELECT and the access itself go in the one exchange */
+	sim_op_begin(SIM_OP_REG_READ);
+	sim_exchange_begin(SIM_TRANSFER_REQUEST_HEADER + 5U + 1U);
+	sim_reg_access(ap->dp, ADIV5_LOW_WRITE, ADIV5_DP_SELECT, ((uint32_t)ap->apsel << 24U) | (addr & 0xf0U));
+	const uint32_t result = sim_reg_access(ap->dp, ADIV5_LOW_READ, addr, 0U);
+	sim_exchange_end(SIM_TRANSFER_RESPONSE_HEADER + 4U);
+	sim_op_end();
+	return result;
+}
+
+static void sim_adiv5_ap_write(adiv5_access_port_s *const ap, const uint16_t addr, const uint32_t value)
+{
+	sim_op_begin(SIM_OP_REG_WRITE);
+	sim_exchange_begin(SIM_TRANSFER_REQUEST_HEADER + 5U + 5U);
+	sim_reg_access(ap->dp, ADIV5_LOW_WRITE, ADIV5_DP_SELECT, ((uint32_t)ap->apsel << 24U) | (addr & 0xf0U));
+	sim_reg_access(ap->dp, ADIV5_LOW_WRITE, addr, value);
+	sim_exchange_end(SIM_TRANSFER_RESPONSE_HEADER);
+	sim_op_end();
+}
+
+/* Set up CSW and TAR for a block, costing it as its own exchange as CMSIS-DAP adaptors do */
+static void sim_mem_access_setup(adiv5_access_port_s *const ap, const uint32_t addr, const align_e align)
+{
+	sim_exchange_begin(SIM_TRANSFER_REQUEST_HEADER + 5U * 3U);
+	sim_reg_access(ap->dp, ADIV5_LOW_WRITE, ADIV5_DP_SELECT, (uint32_t)ap->apsel << 24U);
+	sim_reg_access(ap->dp, ADIV5_LOW_WRITE, ADIV5_AP_CSW, ap->csw | ADIV5_AP_CSW_ADDRINC_SINGLE | align);
+	sim_reg_access(ap->dp, ADIV5_LOW_WRITE, ADIV5_AP_TAR_LOW, addr);
+	sim_exchange_end(SIM_TRANSFER_RESPONSE_HEADER);
+}
+
+/*
+ * Work out how many transfers starting at addr can go in the next DAP_TransferBlock: no more than
+ * fit in a packet, and not past the end of the TAR auto-increment block.
+ */
+static size_t sim_mem_block_transfers(const uint32_t addr, const size_t remaining, const align_e align)
+{
+	const size_t packet_transfers = (sim_link.packet_size - SIM_BLOCK_REQUEST_HEADER) / 4U;
+	const size_t wrap_transfers = ((SIM_TAR_WRAP + 1U) - (addr & SIM_TAR_WRAP)) >> align;
+	const size_t transfers = remaining >> align;
+	return MIN(transfers, MIN(packet_transfers, wrap_transfers));
+}
+
+static void sim_mem_read(adiv5_access_port_s *const ap, void *dest, const target_addr64_t src, const size_t len)
+{
+	if (len == 0U)
+		return;
+	DEBUG_PROBE("%s @ %08" PRIx32 "+%zu\n", __func__, (uint32_t)src, len);
+	sim_op_begin(SIM_OP_MEM_READ);
+	const align_e align = MIN_ALIGN(src, len);
+	uint32_t addr = (uint32_t)src;
+	for (size_t offset = 0; offset < len;) {
+		const size_t transfers = sim_mem_block_transfers(addr, len - offset, align);
+		sim_mem_access_setup(ap, addr, align);
+		sim_exchange_begin(SIM_BLOCK_REQUEST_HEADER);
+		for (size_t i = 0; i < transfers && !ap->dp->fault; ++i) {
+			const uint32_t value = sim_reg_access(ap->dp, ADIV5_LOW_READ, ADIV5_AP_DRW, 0U);
+			dest = adiv5_unpack_data(dest, addr, value, align);
+			addr += 1U << align;
+		}
+		sim_exchange_end(SIM_BLOCK_RESPONSE_HEADER + transfers * 4U);
+		if (ap->dp->fault) {
+			DEBUG_ERROR("%s failed at 0x%08" PRIx32 "\n", __func__, addr);
+			break;
+		}
+		offset += transfers << align;
+	}
+	sim_op_end();
+}
+
+static void sim_mem_write(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *src,
+	const size_t len, const align_e align)
+{
+	if (len == 0U)
+		return;
+	DEBUG_PROBE("%s @ %08" PRIx32 "+%zu\n", __func__, (uint32_t)dest, len);
+	sim_op_begin(SIM_OP_MEM_WRITE);
+	uint32_t addr = (uint32_t)dest;
+	for (size_t offset = 0; offset < len;) {
+		const size_t transfers = sim_mem_block_transfers(addr, len - offset, align);
+		sim_mem_access_setup(ap, addr, align);
+		sim_exchange_begin(SIM_BLOCK_REQUEST_HEADER + transfers * 4U);
+		for (size_t i = 0; i < transfers && !ap->dp->fault; ++i) {
+			uint32_t value = 0;
+			src = adiv5_pack_data(addr, src, &value, align);
+			sim_reg_access(ap->dp, ADIV5_LOW_WRITE, ADIV5_AP_DRW, value);
+			addr += 1U << align;
+		}
+		sim_exchange_end(SIM_BLOCK_RESPONSE_HEADER);
+		if (ap->dp->fault) {
+			DEBUG_ERROR("%s failed at 0x%08" PRIx32 "\n", __func__, addr);
+			break;
+		}
+		offset += transfers << align;
+	}
+	sim_op_end();
+}
+
+static bool sim_batch(adiv5_debug_port_s *const dp, const adiv5_batch_access_s *const accesses, const size_t count)
+{
+	sim_op_begin(SIM_OP_BATCH);
+	bool result = true;
+	for (size_t begin = 0; begin < count && result;) {
+		/* Fill a request packet with as many accesses as will fit, a WAIT takes a match mask too */
+		size_t bytes_out = SIM_TRANSFER_REQUEST_HEADER;
+		size_t bytes_in = SIM_TRANSFER_RESPONSE_HEADER;
+		size_t end = begin;
+		for (; end < count; ++end) {
+			const size_t request = accesses[end].op == ADIV5_BATCH_WAIT ? 10U : 5U;
+			const size_t response = accesses[end].op == ADIV5_BATCH_READ ? 4U : 0U;
+			if (end > begin &&
+				(bytes_out + request > sim_link.packet_size || bytes_in + response > sim_link.packet_size))
+				break;
+			bytes_out += request;
+			bytes_in += response;
+		}
+
+		sim_exchange_begin(bytes_out);
+		for (size_t i = begin; i < end && result; ++i) {
+			const adiv5_batch_access_s *const access = &accesses[i];
+			switch (access->op) {
+			case ADIV5_BATCH_WRITE:
+				sim_reg_access(dp, ADIV5_LOW_WRITE, access->addr, access->value);
+				break;
+			case ADIV5_BATCH_READ:
+				*access->result = sim_reg_access(dp, ADIV5_LOW_READ, access->addr, 0U);
+				break;
+			case ADIV5_BATCH_WAIT: {
+				size_t retries = 0;
+				while ((sim_reg_access(dp, ADIV5_LOW_READ, access->addr, 0U) & access->value) != access->value &&
+					retries < SIM_MATCH_RETRIES)
+					++retries;
+				if (retries == SIM_MATCH_RETRIES)
+					result = false;
+				break;
+			}
+			}
+			if (dp->fault)
+				result = false;
+		}
+		sim_exchange_end(bytes_in);
+		begin = end;
+	}
+	sim_op_end();
+	if (!result)
+		DEBUG_ERROR("%s failed (fault = %u)\n", __func__, dp->fault);
+	return result;
+}
+
+void sim_adiv5_dp_init(adiv5_debug_port_s *const dp)
+{
+	dp->ap_read = sim_adiv5_ap_read;
+	dp->ap_write = sim_adiv5_ap_write;
+	dp->mem_read = sim_mem_read;
+	dp->mem_write = sim_mem_write;
+	dp->batch = sim_batch;
+}
+
+void sim_nrst_set_val(const bool assert)
+{
+	sim_op_begin(SIM_OP_CONTROL);
+	sim_exchange_begin(3U);
+	sim_nrst = assert;
+	sim_target_nrst_set_val(assert);
+	sim_exchange_end(2U);
+	sim_op_end();
+}
+
+bool sim_nrst_get_val(void)
+{
+	return sim_nrst;
+}
+
+void sim_max_frequency_set(const uint32_t frequency)
+{
+	sim_frequency = frequency;
+}
+
+uint32_t sim_max_frequency_get(void)
+{
+	return sim_frequency;
+}
+
+size_t sim_max_mem_read(void)
+{
+	return (sim_link.packet_size - SIM_BLOCK_RESPONSE_HEADER) & ~3U;
+}
+
+bool sim_init(const char *const link)
+{
+	/* The link is given as NAME, or NAME:US to override its round trip latency */
+	const char *const latency = strchr(link, ':');
+	const size_t name_length = latency ? (size_t)(latency - link) : strlen(link);
+	const sim_link_s *profile = NULL;
+	for (size_t i = 0; i < ARRAY_LENGTH(sim_links); ++i) {
+		if (strlen(sim_links[i].name) == name_length && strncmp(sim_links[i].name, link, name_length) == 0) {
+			profile = &sim_links[i];
+			break;
+		}
+	}
+	if (!profile) {
+		DEBUG_ERROR("Unknown simulated link '%s', use one of:", link);
+		for (size_t i = 0; i < ARRAY_LENGTH(sim_links); ++i)
+			DEBUG_ERROR(" %s", sim_links[i].name);
+		DEBUG_ERROR("\n");
+		return false;
+	}
+	sim_link = *profile;
+	if (latency)
+		sim_link.round_trip_ns = strtoul(latency + 1U, NULL, 0) * 1000U;
+
+	strncpy(bmda_probe_info.manufacturer, "Black Magic Debug", sizeof(bmda_probe_info.manufacturer) - 1U);
+	strncpy(bmda_probe_info.product, "Simulator", sizeof(bmda_probe_info.product) - 1U);
+	snprintf(bmda_probe_info.version, sizeof(bmda_probe_info.version), "%s, %" PRIu32 "us round trip",
+		sim_link.name, sim_link.round_trip_ns / 1000U);
+	DEBUG_INFO("Simulating a %s with %" PRIu32 "us round trip, %" PRIu32 "ns/byte and %u byte packets\n",
+		sim_link.description, sim_link.round_trip_ns / 1000U, sim_link.byte_ns, sim_link.packet_size);
+
+	sim_target_init();
+	return true;
+}
+
+void sim_exit_function(void)
+{
+	if (!sim_link.name)
+		return;
+	DEBUG_WARN("Simulated link %s, %" PRIu64 ".%03" PRIu64 "ms modelled in total\n", sim_link.name,
+		sim_now_ns / 1000000U, (sim_now_ns / 1000U) % 1000U);
+	DEBUG_WARN("%-10s %10s %10s %10s %10s %10s %12s\n", "operation", "calls", "transfers", "round trips", "bytes out",
+		"bytes in", "time (us)");
+	for (size_t op = 0; op < SIM_OP_COUNT; ++op) {
+		const sim_stats_s *const stats = &sim_stats[op];
+		DEBUG_WARN("%-10s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %12" PRIu64 "\n",
+			sim_op_names[op], stats->calls, stats->transfers, stats->round_trips, stats->bytes_out, stats->bytes_in,
+			stats->time_ns / 1000U);
+	}
+}
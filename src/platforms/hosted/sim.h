@@ -0,0 +1,63 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLATFORMS_HOSTED_SIM_H
+#define PLATFORMS_HOSTED_SIM_H
+
+#include "bmp_hosted.h"
+#include "adiv5.h"
+
+/* The simulated adaptor and link model, sim.c */
+bool sim_init(const char *link);
+bool sim_swd_init(adiv5_debug_port_s *dp);
+void sim_adiv5_dp_init(adiv5_debug_port_s *dp);
+void sim_nrst_set_val(bool assert);
+bool sim_nrst_get_val(void);
+void sim_max_frequency_set(uint32_t frequency);
+uint32_t sim_max_frequency_get(void);
+size_t sim_max_mem_read(void);
+void sim_exit_function(void);
+
+/* Modelled time since the simulation started, advanced by every link exchange */
+uint64_t sim_time_ns(void);
+/* Hold up the access in progress until the given modelled time, as an AHB wait state would */
+void sim_stall_until(uint64_t time_ns);
+/* Let modelled time pass with the link idle, as the host sleeping would */
+void sim_delay(uint32_t ms);
+
+/* Link totals over all operation types, so a caller can measure the cost of what it does in between */
+typedef struct sim_counters {
+	uint64_t time_ns;
+	uint64_t transfers;
+	uint64_t round_trips;
+	uint64_t bytes;
+} sim_counters_s;
+
+void sim_counters(sim_counters_s *counters);
+const char *sim_link_name(void);
+
+/* The simulated STM32F103 (Cortex-M3, 128KiB Flash, 20KiB SRAM), sim_target.c */
+void sim_target_init(void);
+void sim_target_nrst_set_val(bool assert);
+/*
+ * Perform a bus access of 1, 2 or 4 bytes on behalf of the AHB-AP, values are right-aligned.
+ * These return false on a bus error.
+ */
+bool sim_target_read(uint32_t addr, uint8_t size, uint32_t *value);
+bool sim_target_write(uint32_t addr, uint8_t size, uint32_t value);
+
+#endif /* PLATFORMS_HOSTED_SIM_H */
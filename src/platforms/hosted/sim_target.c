@@ -0,0 +1,1129 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This file implements the target side of the simulated probe: an STM32F103x8 with
+ * enough of the Cortex-M3 debug logic, ROM table, DBGMCU and Flash controller (FPEC)
+ * for the stm32f1 driver to probe, attach, erase, program and run stubs on it.
+ *
+ * The core executes the 16-bit ARMv6-M Thumb instruction set plus BL and the barriers,
+ * which covers the stubs in target/flashstub. It runs in lockstep with the modelled
+ * time of the link so a stub or a Flash operation takes as many polls to complete as
+ * it would on real hardware. Anything the model doesn't implement raises a HardFault.
+ */
+
+#include "general.h"
+#include "buffer_utils.h"
+#include "cortexm.h"
+#include "jep106.h"
+#include "sim.h"
+
+#define SIM_FLASH_BASE      0x08000000U
+#define SIM_FLASH_SIZE      0x00020000U
+#define SIM_FLASH_PAGE_SIZE 0x00000400U
+#define SIM_SRAM_BASE       0x20000000U
+#define SIM_SRAM_SIZE       0x00005000U
+#define SIM_FLASH_SIZE_REG  0x1ffff7e0U
+#define SIM_UID_BASE        0x1ffff7e8U
+#define SIM_PPB_SIZE        0x00010000U
+#define SIM_ROM_TABLE_BASE  0xe00ff000U
+#define SIM_DBGMCU_IDCODE   0xe0042000U
+#define SIM_DBGMCU_CR       0xe0042004U
+
+/* Flash Program and Erase Controller */
+#define SIM_FPEC_BASE   0x40022000U
+#define SIM_FLASH_ACR   (SIM_FPEC_BASE + 0x00U)
+#define SIM_FLASH_KEYR  (SIM_FPEC_BASE + 0x04U)
+#define SIM_FLASH_SR    (SIM_FPEC_BASE + 0x0cU)
+#define SIM_FLASH_CR    (SIM_FPEC_BASE + 0x10U)
+#define SIM_FLASH_AR    (SIM_FPEC_BASE + 0x14U)
+#define SIM_FLASH_OBR   (SIM_FPEC_BASE + 0x1cU)
+#define SIM_FLASH_WRPR  (SIM_FPEC_BASE + 0x20U)
+#define SIM_FLASH_KEY1  0x45670123U
+#define SIM_FLASH_KEY2  0xcdef89abU
+#define SIM_FLASH_SR_BSY     (1U << 0U)
+#define SIM_FLASH_SR_PGERR   (1U << 2U)
+#define SIM_FLASH_SR_WRPRT   (1U << 4U)
+#define SIM_FLASH_SR_EOP     (1U << 5U)
+#define SIM_FLASH_CR_PG      (1U << 0U)
+#define SIM_FLASH_CR_PER     (1U << 1U)
+#define SIM_FLASH_CR_MER     (1U << 2U)
+#define SIM_FLASH_CR_STRT    (1U << 6U)
+#define SIM_FLASH_CR_LOCK    (1U << 7U)
+
+/* Datasheet typical timings: the core clock out of reset is the 8MHz HSI */
+#define SIM_CORE_CYCLE_NS    125U
+#define SIM_FLASH_PROGRAM_NS 52500U
+#define SIM_FLASH_ERASE_NS   20000000U
+
+/* Core register file indices as selected by DCRSR.REGSEL */
+#define SIM_REG_SP      13U
+#define SIM_REG_LR      14U
+#define SIM_REG_PC      15U
+#define SIM_REG_XPSR    16U
+#define SIM_REG_MSP     17U
+#define SIM_REG_PSP     18U
+#define SIM_REG_SPECIAL 20U
+#define SIM_REG_COUNT   21U
+
+#define SIM_XPSR_N (1U << 31U)
+#define SIM_XPSR_Z (1U << 30U)
+#define SIM_XPSR_C (1U << 29U)
+#define SIM_XPSR_V (1U << 28U)
+
+/* CONTROL.SPSEL as it sits in the special register word */
+#define SIM_CONTROL_SPSEL (2U << 24U)
+
+#define SIM_FPB_NUM_CODE 6U
+#define SIM_DWT_NUM_COMP 4U
+
+typedef enum sim_shift {
+	SIM_SHIFT_LSL,
+	SIM_SHIFT_LSR,
+	SIM_SHIFT_ASR,
+	SIM_SHIFT_ROR,
+} sim_shift_e;
+
+typedef struct sim_core {
+	uint32_t regs[SIM_REG_COUNT];
+	/* DHCSR control bits as last written */
+	uint32_t dhcsr;
+	uint32_t dfsr;
+	bool halted;
+	bool locked_up;
+	bool in_reset;
+	/* DHCSR.S_RESET_ST, sticky until DHCSR is read */
+	bool reset_seen;
+	/* Don't let an FPB comparator match the instruction the core is resuming on */
+	bool resuming;
+	bool fpb_enabled;
+	/* Modelled time the core has executed up to, and cycles spent on the current instruction */
+	uint64_t time_ns;
+	uint32_t cycles;
+	/* Set while an instruction executes, so bus timing follows the core rather than the link */
+	bool on_bus;
+} sim_core_s;
+
+typedef struct sim_fpec {
+	bool locked;
+	uint8_t key_state;
+	uint32_t sr;
+	uint32_t cr;
+	uint32_t ar;
+	uint32_t acr;
+	uint64_t busy_until;
+} sim_fpec_s;
+
+static uint8_t sim_flash[SIM_FLASH_SIZE];
+static uint8_t sim_sram[SIM_SRAM_SIZE];
+/* Plain register storage for the whole PPB, the registers with behaviour are handled in sim_ppb_read/write */
+static uint32_t sim_ppb[SIM_PPB_SIZE / 4U];
+static uint32_t sim_rom_table[0x1000U / 4U];
+static uint32_t sim_dbgmcu_cr;
+static sim_core_s sim_core;
+static sim_fpec_s sim_fpec;
+
+static void sim_core_run(void);
+static void sim_core_step(void);
+
+/* Modelled time of the bus master doing the current access, the core runs behind the link while it catches up */
+static uint64_t sim_bus_time_ns(void)
+{
+	return sim_core.on_bus ? sim_core.time_ns : sim_time_ns();
+}
+
+/* Hold up the current bus master until the given modelled time */
+static void sim_bus_stall_until(const uint64_t time_ns)
+{
+	if (!sim_core.on_bus)
+		sim_stall_until(time_ns);
+	else if (sim_core.time_ns < time_ns)
+		sim_core.time_ns = time_ns;
+}
+
+/* Fill in the CoreSight CIDR and PIDR registers of a 4KiB component from its designer and part number */
+static void sim_component_id(
+	uint32_t *const regs, const uint16_t designer_code, const uint16_t part_number, const uint8_t cid_class)
+{
+	const uint8_t code = designer_code & 0x7fU;
+	regs[0xfd0U / 4U] = (designer_code >> 8U) & 0xfU; /* PIDR4: JEP-106 continuation, 4KiB */
+	regs[0xfe0U / 4U] = part_number & 0xffU;
+	regs[0xfe4U / 4U] = ((part_number >> 8U) & 0xfU) | ((code & 0xfU) << 4U);
+	regs[0xfe8U / 4U] = ((code >> 4U) & 0x7U) | 0x08U; /* JEP-106 code used */
+	regs[0xff0U / 4U] = 0x0dU;
+	regs[0xff4U / 4U] = (uint32_t)cid_class << 4U;
+	regs[0xff8U / 4U] = 0x05U;
+	regs[0xffcU / 4U] = 0xb1U;
+}
+
+static uint32_t *sim_ppb_reg(const uint32_t addr)
+{
+	return &sim_ppb[(addr - CORTEXM_PPB_BASE) / 4U];
+}
+
+static void sim_fpec_reset(void)
+{
+	sim_fpec = (sim_fpec_s){.locked = true, .cr = SIM_FLASH_CR_LOCK, .acr = 0x30U};
+}
+
+/* Entering debug state also takes the core out of lockup */
+static void sim_core_halt(const uint32_t reason)
+{
+	sim_core.halted = true;
+	sim_core.locked_up = false;
+	sim_core.dfsr |= reason;
+}
+
+/* A system reset, as from nRST or AIRCR.SYSRESETREQ, which leaves the debug logic alone */
+static void sim_core_reset(void)
+{
+	memset(sim_core.regs, 0, sizeof(sim_core.regs));
+	sim_core.regs[SIM_REG_MSP] = read_le4(sim_flash, 0U) & ~3U;
+	sim_core.regs[SIM_REG_PC] = read_le4(sim_flash, 4U) & ~1U;
+	sim_core.regs[SIM_REG_LR] = 0xffffffffU;
+	sim_core.regs[SIM_REG_XPSR] = CORTEXM_XPSR_THUMB;
+	sim_core.halted = false;
+	sim_core.locked_up = false;
+	sim_core.reset_seen = true;
+	sim_core.resuming = true;
+	sim_core.time_ns = sim_time_ns();
+	sim_fpec_reset();
+
+	if (!(sim_core.dhcsr & CORTEXM_DHCSR_C_DEBUGEN))
+		return;
+	if (*sim_ppb_reg(CORTEXM_DEMCR) & CORTEXM_DEMCR_VC_CORERESET)
+		sim_core_halt(CORTEXM_DFSR_VCATCH);
+	else if (sim_core.dhcsr & CORTEXM_DHCSR_C_HALT)
+		sim_core_halt(CORTEXM_DFSR_HALTED);
+}
+
+void sim_target_init(void)
+{
+	memset(sim_flash, 0xff, sizeof(sim_flash));
+	memset(sim_sram, 0, sizeof(sim_sram));
+	memset(sim_ppb, 0, sizeof(sim_ppb));
+	memset(sim_rom_table, 0, sizeof(sim_rom_table));
+	memset(&sim_core, 0, sizeof(sim_core));
+	sim_dbgmcu_cr = 0;
+
+	/* Cortex-M3 r1p1 */
+	*sim_ppb_reg(CORTEXM_CPUID) = 0x411fc231U;
+	*sim_ppb_reg(CORTEXM_SCS_BASE + 0xd0cU) = 0xfa050000U;
+	sim_component_id(sim_ppb_reg(CORTEXM_SCS_BASE), JEP106_MANUFACTURER_ARM, 0x000U, 0xeU);
+	sim_component_id(sim_ppb_reg(CORTEXM_PPB_BASE + 0x1000U), JEP106_MANUFACTURER_ARM, 0x002U, 0xeU);
+	sim_component_id(sim_ppb_reg(CORTEXM_FPB_BASE), JEP106_MANUFACTURER_ARM, 0x003U, 0xeU);
+
+	/* The STM32F1 ROM table, pointing at the SCS, DWT and FPB */
+	sim_rom_table[0] = 0xfff0f003U;
+	sim_rom_table[1] = 0xfff02003U;
+	sim_rom_table[2] = 0xfff03003U;
+	sim_rom_table[0xfccU / 4U] = 1U; /* MEMTYPE.SYSMEM */
+	sim_component_id(sim_rom_table, JEP106_MANUFACTURER_STM, 0x410U, 0x1U);
+
+	sim_core_reset();
+	sim_core.reset_seen = false;
+}
+
+void sim_target_nrst_set_val(const bool assert)
+{
+	sim_core_run();
+	if (assert) {
+		sim_core.in_reset = true;
+		sim_core.reset_seen = true;
+	} else if (sim_core.in_reset) {
+		sim_core.in_reset = false;
+		sim_core_reset();
+	}
+}
+
+static uint8_t *sim_memory(const uint32_t addr, const uint8_t size)
+{
+	/* Boot from main Flash, so Flash is also aliased from address 0 */
+	if (addr < SIM_FLASH_SIZE && addr + size <= SIM_FLASH_SIZE)
+		return sim_flash + addr;
+	if (addr >= SIM_FLASH_BASE && addr - SIM_FLASH_BASE + size <= SIM_FLASH_SIZE)
+		return sim_flash + (addr - SIM_FLASH_BASE);
+	if (addr >= SIM_SRAM_BASE && addr - SIM_SRAM_BASE + size <= SIM_SRAM_SIZE)
+		return sim_sram + (addr - SIM_SRAM_BASE);
+	return NULL;
+}
+
+static uint32_t sim_dhcsr_read(void)
+{
+	uint32_t dhcsr = sim_core.dhcsr & 0x3fU;
+	if (sim_core.halted)
+		dhcsr |= CORTEXM_DHCSR_S_HALT | CORTEXM_DHCSR_S_REGRDY;
+	if (sim_core.locked_up)
+		dhcsr |= CORTEXM_DHCSR_S_LOCKUP;
+	if (sim_core.reset_seen || sim_core.in_reset)
+		dhcsr |= CORTEXM_DHCSR_S_RESET_ST;
+	sim_core.reset_seen = false;
+	return dhcsr;
+}
+
+static void sim_dhcsr_write(const uint32_t value)
+{
+	if ((value & 0xffff0000U) != CORTEXM_DHCSR_DBGKEY)
+		return;
+	sim_core.dhcsr = value & 0x3fU;
+	if (sim_core.in_reset)
+		return;
+	if (!(value & CORTEXM_DHCSR_C_DEBUGEN)) {
+		if (sim_core.halted) {
+			sim_core.halted = false;
+			sim_core.resuming = true;
+			sim_core.time_ns = sim_time_ns();
+		}
+		return;
+	}
+	if (value & CORTEXM_DHCSR_C_HALT) {
+		if (!sim_core.halted)
+			sim_core_halt(CORTEXM_DFSR_HALTED);
+	} else if (sim_core.halted) {
+		sim_core.halted = false;
+		sim_core.resuming = true;
+		sim_core.time_ns = sim_time_ns();
+		/* Single step: run exactly one instruction then halt again */
+		if (value & CORTEXM_DHCSR_C_STEP) {
+			sim_core_step();
+			if (!sim_core.halted)
+				sim_core_halt(CORTEXM_DFSR_HALTED);
+			sim_core.time_ns = sim_time_ns();
+		}
+	}
+}
+
+static uint32_t *sim_core_reg(uint32_t regsel)
+{
+	/* SP is whichever of MSP and PSP CONTROL.SPSEL picks */
+	if (regsel == SIM_REG_SP)
+		regsel = sim_core.regs[SIM_REG_SPECIAL] & SIM_CONTROL_SPSEL ? SIM_REG_PSP : SIM_REG_MSP;
+	if (regsel >= SIM_REG_COUNT || regsel == 19U)
+		return NULL;
+	return &sim_core.regs[regsel];
+}
+
+static void sim_dcrsr_write(const uint32_t value)
+{
+	if (!sim_core.halted)
+		return;
+	uint32_t *const reg = sim_core_reg(value & 0x7fU);
+	if (!reg)
+		return;
+	if (value & CORTEXM_DCRSR_REGWnR)
+		*reg = *sim_ppb_reg(CORTEXM_DCRDR);
+	else
+		*sim_ppb_reg(CORTEXM_DCRDR) = *reg;
+	if ((value & 0x7fU) == SIM_REG_SP)
+		*reg &= ~3U;
+}
+
+static uint32_t sim_ppb_read(const uint32_t addr)
+{
+	switch (addr) {
+	case CORTEXM_DHCSR:
+		return sim_dhcsr_read();
+	case CORTEXM_DFSR:
+		return sim_core.dfsr;
+	case CORTEXM_FPB_CTRL:
+		return (SIM_FPB_NUM_CODE << 4U) | (2U << 8U) | (sim_core.fpb_enabled ? CORTEXM_FPB_CTRL_ENABLE : 0U);
+	case CORTEXM_DWT_CTRL:
+		return SIM_DWT_NUM_COMP << 28U;
+	default:
+		return *sim_ppb_reg(addr);
+	}
+}
+
+static void sim_ppb_write(const uint32_t addr, const uint32_t value)
+{
+	switch (addr) {
+	case CORTEXM_DHCSR:
+		sim_dhcsr_write(value);
+		break;
+	case CORTEXM_DCRSR:
+		sim_dcrsr_write(value);
+		break;
+	case CORTEXM_DFSR:
+		sim_core.dfsr &= ~value;
+		break;
+	case CORTEXM_AIRCR:
+		if ((value & 0xffff0000U) == CORTEXM_AIRCR_VECTKEY &&
+			(value & (CORTEXM_AIRCR_SYSRESETREQ | CORTEXM_AIRCR_VECTRESET)))
+			sim_core_reset();
+		break;
+	case CORTEXM_FPB_CTRL:
+		if (value & CORTEXM_FPB_CTRL_KEY)
+			sim_core.fpb_enabled = value & CORTEXM_FPB_CTRL_ENABLE;
+		break;
+	case CORTEXM_CPUID:
+	case CORTEXM_DWT_CTRL:
+		break;
+	default:
+		/* The ID registers are read-only */
+		if ((addr & 0xfffU) < 0xfd0U)
+			*sim_ppb_reg(addr) = value;
+		break;
+	}
+}
+
+static void sim_flash_erase(const uint32_t offset, const size_t len)
+{
+	sim_bus_stall_until(sim_fpec.busy_until);
+	memset(sim_flash + offset, 0xff, len);
+	sim_fpec.busy_until = sim_bus_time_ns() + SIM_FLASH_ERASE_NS;
+	sim_fpec.sr |= SIM_FLASH_SR_EOP;
+}
+
+static bool sim_flash_program(const uint32_t addr, const uint8_t size, const uint32_t value)
+{
+	/* The FPEC only accepts half-word writes, and only while programming is enabled */
+	if (size != 2U || !(sim_fpec.cr & SIM_FLASH_CR_PG) || sim_fpec.locked)
+		return false;
+	/* The write stalls the bus until the previous programming operation completes */
+	sim_bus_stall_until(sim_fpec.busy_until);
+	uint8_t *const dest = sim_memory(addr, size);
+	const uint16_t current = read_le2(dest, 0U);
+	if (current != 0xffffU && value != 0U)
+		sim_fpec.sr |= SIM_FLASH_SR_PGERR;
+	else {
+		write_le2(dest, 0U, (uint16_t)value);
+		sim_fpec.busy_until = sim_bus_time_ns() + SIM_FLASH_PROGRAM_NS;
+		sim_fpec.sr |= SIM_FLASH_SR_EOP;
+	}
+	return true;
+}
+
+static uint32_t sim_fpec_read(const uint32_t addr)
+{
+	switch (addr) {
+	case SIM_FLASH_ACR:
+		return sim_fpec.acr;
+	case SIM_FLASH_SR:
+		return sim_fpec.sr | (sim_bus_time_ns() < sim_fpec.busy_until ? SIM_FLASH_SR_BSY : 0U);
+	case SIM_FLASH_CR:
+		return sim_fpec.cr;
+	case SIM_FLASH_AR:
+		return sim_fpec.ar;
+	case SIM_FLASH_OBR:
+		return 0x03fffffcU;
+	case SIM_FLASH_WRPR:
+		return 0xffffffffU;
+	default:
+		return 0U;
+	}
+}
+
+static void sim_fpec_write(const uint32_t addr, const uint32_t value)
+{
+	switch (addr) {
+	case SIM_FLASH_ACR:
+		sim_fpec.acr = value & 0x3fU;
+		break;
+	case SIM_FLASH_KEYR:
+		if (sim_fpec.key_state == 0U && value == SIM_FLASH_KEY1)
+			sim_fpec.key_state = 1U;
+		else if (sim_fpec.key_state == 1U && value == SIM_FLASH_KEY2) {
+			sim_fpec.key_state = 0U;
+			sim_fpec.locked = false;
+			sim_fpec.cr &= ~SIM_FLASH_CR_LOCK;
+		} else
+			/* A bad key sequence locks the FPEC until the next reset */
+			sim_fpec.key_state = 2U;
+		break;
+	case SIM_FLASH_SR:
+		sim_fpec.sr &= ~(value & (SIM_FLASH_SR_PGERR | SIM_FLASH_SR_WRPRT | SIM_FLASH_SR_EOP));
+		break;
+	case SIM_FLASH_CR:
+		if (sim_fpec.locked)
+			break;
+		sim_fpec.cr = value & 0x1277U;
+		if (value & SIM_FLASH_CR_LOCK) {
+			sim_fpec.locked = true;
+			sim_fpec.cr = SIM_FLASH_CR_LOCK;
+		} else if ((value & (SIM_FLASH_CR_STRT | SIM_FLASH_CR_MER)) == (SIM_FLASH_CR_STRT | SIM_FLASH_CR_MER))
+			sim_flash_erase(0U, SIM_FLASH_SIZE);
+		else if ((value & (SIM_FLASH_CR_STRT | SIM_FLASH_CR_PER)) == (SIM_FLASH_CR_STRT | SIM_FLASH_CR_PER)) {
+			const uint32_t page = (sim_fpec.ar - SIM_FLASH_BASE) & ~(SIM_FLASH_PAGE_SIZE - 1U);
+			if (page < SIM_FLASH_SIZE)
+				sim_flash_erase(page, SIM_FLASH_PAGE_SIZE);
+		}
+		sim_fpec.cr &= ~SIM_FLASH_CR_STRT;
+		break;
+	case SIM_FLASH_AR:
+		sim_fpec.ar = value;
+		break;
+	default:
+		break;
+	}
+}
+
+/* Registers outside of memory are only modelled as whole words */
+static bool sim_reg_read(const uint32_t addr, uint32_t *const value)
+{
+	if (addr >= CORTEXM_PPB_BASE && addr < CORTEXM_PPB_BASE + SIM_PPB_SIZE)
+		*value = sim_ppb_read(addr);
+	else if (addr >= SIM_ROM_TABLE_BASE && addr < SIM_ROM_TABLE_BASE + sizeof(sim_rom_table))
+		*value = sim_rom_table[(addr - SIM_ROM_TABLE_BASE) / 4U];
+	else if (addr >= SIM_FPEC_BASE && addr < SIM_FPEC_BASE + 0x400U)
+		*value = sim_fpec_read(addr);
+	else if (addr == SIM_DBGMCU_IDCODE)
+		*value = 0x20036410U;
+	else if (addr == SIM_DBGMCU_CR)
+		*value = sim_dbgmcu_cr;
+	else if (addr == SIM_FLASH_SIZE_REG)
+		*value = 0xffff0000U | (SIM_FLASH_SIZE / 1024U);
+	else if (addr >= SIM_UID_BASE && addr < SIM_UID_BASE + 12U)
+		*value = 0x424d4400U | ((addr - SIM_UID_BASE) / 4U);
+	else
+		return false;
+	return true;
+}
+
+static bool sim_reg_write(const uint32_t addr, const uint32_t value)
+{
+	if (addr >= CORTEXM_PPB_BASE && addr < CORTEXM_PPB_BASE + SIM_PPB_SIZE)
+		sim_ppb_write(addr, value);
+	else if (addr >= SIM_FPEC_BASE && addr < SIM_FPEC_BASE + 0x400U)
+		sim_fpec_write(addr, value);
+	else if (addr == SIM_DBGMCU_CR)
+		sim_dbgmcu_cr = value;
+	else
+		return false;
+	return true;
+}
+
+static bool sim_bus_read(const uint32_t addr, const uint8_t size, uint32_t *const value)
+{
+	/* AHB doesn't do unaligned accesses */
+	if (addr & (size - 1U))
+		return false;
+	const uint8_t *const mem = sim_memory(addr, size);
+	if (mem) {
+		*value = size == 4U ? read_le4(mem, 0U) : size == 2U ? read_le2(mem, 0U) : mem[0];
+		return true;
+	}
+	uint32_t reg = 0;
+	if (!sim_reg_read(addr & ~3U, &reg))
+		return false;
+	reg >>= (addr & 3U) * 8U;
+	*value = size == 4U ? reg : reg & ((1U << (size * 8U)) - 1U);
+	return true;
+}
+
+static bool sim_bus_write(const uint32_t addr, const uint8_t size, const uint32_t value)
+{
+	if (addr & (size - 1U))
+		return false;
+	uint8_t *const mem = sim_memory(addr, size);
+	if (mem) {
+		if (addr < SIM_SRAM_BASE)
+			return sim_flash_program(addr, size, value);
+		if (size == 4U)
+			write_le4(mem, 0U, value);
+		else if (size == 2U)
+			write_le2(mem, 0U, (uint16_t)value);
+		else
+			mem[0] = (uint8_t)value;
+		return true;
+	}
+	uint32_t reg = value;
+	/* Merge narrower writes into the rest of the register */
+	if (size != 4U) {
+		if (!sim_reg_read(addr & ~3U, &reg))
+			return false;
+		const uint8_t shift = (addr & 3U) * 8U;
+		const uint32_t mask = ((1U << (size * 8U)) - 1U) << shift;
+		reg = (reg & ~mask) | ((value << shift) & mask);
+	}
+	return sim_reg_write(addr & ~3U, reg);
+}
+
+bool sim_target_read(const uint32_t addr, const uint8_t size, uint32_t *const value)
+{
+	/* Let the core catch up with the debugger before it looks at anything */
+	sim_core_run();
+	return sim_bus_read(addr, size, value);
+}
+
+bool sim_target_write(const uint32_t addr, const uint8_t size, const uint32_t value)
+{
+	sim_core_run();
+	return sim_bus_write(addr, size, value);
+}
+
+/*
+ * The following implements the core itself: ARMv6-M Thumb execution against the bus above.
+ * Cycle counts are roughly those of the Cortex-M3 with zero wait state memory.
+ */
+
+static uint32_t sim_core_read_reg(const uint8_t reg)
+{
+	/* Reads of the PC see the address of the current instruction plus 4 */
+	if (reg == SIM_REG_PC)
+		return sim_core.regs[SIM_REG_PC] + 4U;
+	return *sim_core_reg(reg);
+}
+
+static void sim_core_write_reg(const uint8_t reg, const uint32_t value)
+{
+	*sim_core_reg(reg) = reg == SIM_REG_SP ? value & ~3U : value;
+}
+
+static void sim_core_set_nz(const uint32_t result)
+{
+	uint32_t xpsr = sim_core.regs[SIM_REG_XPSR] & ~(SIM_XPSR_N | SIM_XPSR_Z);
+	if (result & 0x80000000U)
+		xpsr |= SIM_XPSR_N;
+	if (!result)
+		xpsr |= SIM_XPSR_Z;
+	sim_core.regs[SIM_REG_XPSR] = xpsr;
+}
+
+static void sim_core_set_c(const bool carry)
+{
+	if (carry)
+		sim_core.regs[SIM_REG_XPSR] |= SIM_XPSR_C;
+	else
+		sim_core.regs[SIM_REG_XPSR] &= ~SIM_XPSR_C;
+}
+
+static bool sim_core_c(void)
+{
+	return sim_core.regs[SIM_REG_XPSR] & SIM_XPSR_C;
+}
+
+/* AddWithCarry() from the architecture reference, always setting the flags */
+static uint32_t sim_core_add(const uint32_t lhs, const uint32_t rhs, const bool carry_in)
+{
+	const uint64_t sum = (uint64_t)lhs + rhs + carry_in;
+	const uint32_t result = (uint32_t)sum;
+	sim_core_set_nz(result);
+	sim_core_set_c(sum >> 32U);
+	if ((~(lhs ^ rhs) & (lhs ^ result)) & 0x80000000U)
+		sim_core.regs[SIM_REG_XPSR] |= SIM_XPSR_V;
+	else
+		sim_core.regs[SIM_REG_XPSR] &= ~SIM_XPSR_V;
+	return result;
+}
+
+/* Shift_C() from the architecture reference, for shift amounts in the range 0 to 255 */
+static uint32_t sim_core_shift(const sim_shift_e type, const uint32_t value, const uint32_t amount, bool *const carry)
+{
+	if (!amount)
+		return value;
+	switch (type) {
+	case SIM_SHIFT_LSL:
+		*carry = amount <= 32U && ((value << (amount - 1U)) & 0x80000000U);
+		return amount < 32U ? value << amount : 0U;
+	case SIM_SHIFT_LSR:
+		*carry = amount <= 32U && ((value >> (amount - 1U)) & 1U);
+		return amount < 32U ? value >> amount : 0U;
+	case SIM_SHIFT_ASR: {
+		const uint32_t sign = value & 0x80000000U ? 0xffffffffU : 0U;
+		if (amount >= 32U) {
+			*carry = sign;
+			return sign;
+		}
+		*carry = (value >> (amount - 1U)) & 1U;
+		return (value >> amount) | (sign << (32U - amount));
+	}
+	case SIM_SHIFT_ROR: {
+		const uint32_t rotate = amount & 31U;
+		const uint32_t result = rotate ? (value >> rotate) | (value << (32U - rotate)) : value;
+		*carry = result & 0x80000000U;
+		return result;
+	}
+	}
+	return value;
+}
+
+static bool sim_core_condition(const uint8_t cond)
+{
+	const uint32_t xpsr = sim_core.regs[SIM_REG_XPSR];
+	const bool n = xpsr & SIM_XPSR_N;
+	const bool z = xpsr & SIM_XPSR_Z;
+	const bool c = xpsr & SIM_XPSR_C;
+	const bool v = xpsr & SIM_XPSR_V;
+	switch (cond >> 1U) {
+	case 0U:
+		return z != (cond & 1U);
+	case 1U:
+		return c != (cond & 1U);
+	case 2U:
+		return n != (cond & 1U);
+	case 3U:
+		return v != (cond & 1U);
+	case 4U:
+		return (c && !z) != (cond & 1U);
+	case 5U:
+		return (n == v) != (cond & 1U);
+	case 6U:
+		return (!z && n == v) != (cond & 1U);
+	default:
+		return true;
+	}
+}
+
+static bool sim_core_load(const uint32_t addr, const uint8_t size, const bool sign_extend, const uint8_t reg)
+{
+	uint32_t value = 0;
+	if (!sim_bus_read(addr, size, &value))
+		return false;
+	if (sign_extend && size == 1U)
+		value = (uint32_t)(int32_t)(int8_t)value;
+	else if (sign_extend && size == 2U)
+		value = (uint32_t)(int32_t)(int16_t)value;
+	sim_core_write_reg(reg, value);
+	++sim_core.cycles;
+	return true;
+}
+
+static bool sim_core_store(const uint32_t addr, const uint8_t size, const uint8_t reg)
+{
+	++sim_core.cycles;
+	return sim_bus_write(addr, size, sim_core_read_reg(reg));
+}
+
+static void sim_core_branch(const uint32_t target)
+{
+	sim_core.regs[SIM_REG_PC] = target & ~1U;
+	sim_core.cycles += 2U;
+}
+
+/* Load or store a register list for LDM/STM/PUSH/POP, lowest register at the lowest address */
+static bool sim_core_transfer_list(uint32_t addr, const uint16_t list, const bool load)
+{
+	for (uint8_t reg = 0U; reg < 16U; ++reg) {
+		if (!(list & (1U << reg)))
+			continue;
+		if (load && reg == SIM_REG_PC) {
+			uint32_t target = 0;
+			if (!sim_bus_read(addr, 4U, &target))
+				return false;
+			sim_core_branch(target);
+		} else if (load ? !sim_core_load(addr, 4U, false, reg) : !sim_core_store(addr, 4U, reg))
+			return false;
+		addr += 4U;
+	}
+	return true;
+}
+
+static bool sim_core_data_processing(const uint16_t insn)
+{
+	const uint8_t rdn = insn & 7U;
+	const uint32_t lhs = sim_core_read_reg(rdn);
+	const uint32_t rhs = sim_core_read_reg((insn >> 3U) & 7U);
+	bool carry = sim_core_c();
+	uint32_t result = 0;
+	switch ((insn >> 6U) & 0xfU) {
+	case 0x0U: /* AND */
+		result = lhs & rhs;
+		break;
+	case 0x1U: /* EOR */
+		result = lhs ^ rhs;
+		break;
+	case 0x2U: /* LSL */
+		result = sim_core_shift(SIM_SHIFT_LSL, lhs, rhs & 0xffU, &carry);
+		break;
+	case 0x3U: /* LSR */
+		result = sim_core_shift(SIM_SHIFT_LSR, lhs, rhs & 0xffU, &carry);
+		break;
+	case 0x4U: /* ASR */
+		result = sim_core_shift(SIM_SHIFT_ASR, lhs, rhs & 0xffU, &carry);
+		break;
+	case 0x5U: /* ADC */
+		sim_core_write_reg(rdn, sim_core_add(lhs, rhs, carry));
+		return true;
+	case 0x6U: /* SBC */
+		sim_core_write_reg(rdn, sim_core_add(lhs, ~rhs, carry));
+		return true;
+	case 0x7U: /* ROR */
+		result = sim_core_shift(SIM_SHIFT_ROR, lhs, rhs & 0xffU, &carry);
+		break;
+	case 0x8U: /* TST */
+		sim_core_set_nz(lhs & rhs);
+		return true;
+	case 0x9U: /* RSB #0 */
+		sim_core_write_reg(rdn, sim_core_add(~rhs, 0U, true));
+		return true;
+	case 0xaU: /* CMP */
+		sim_core_add(lhs, ~rhs, true);
+		return true;
+	case 0xbU: /* CMN */
+		sim_core_add(lhs, rhs, false);
+		return true;
+	case 0xcU: /* ORR */
+		result = lhs | rhs;
+		break;
+	case 0xdU: /* MUL */
+		result = lhs * rhs;
+		break;
+	case 0xeU: /* BIC */
+		result = lhs & ~rhs;
+		break;
+	default: /* MVN */
+		result = ~rhs;
+		break;
+	}
+	sim_core_set_nz(result);
+	sim_core_set_c(carry);
+	sim_core_write_reg(rdn, result);
+	return true;
+}
+
+static bool sim_core_special_data(const uint16_t insn)
+{
+	const uint8_t rdn = (insn & 7U) | ((insn >> 4U) & 8U);
+	const uint8_t rm = (insn >> 3U) & 0xfU;
+	switch ((insn >> 8U) & 3U) {
+	case 0U: { /* ADD (register) */
+		const uint32_t result = sim_core_read_reg(rdn) + sim_core_read_reg(rm);
+		if (rdn == SIM_REG_PC)
+			sim_core_branch(result);
+		else
+			sim_core_write_reg(rdn, result);
+		return true;
+	}
+	case 1U: /* CMP (register) */
+		sim_core_add(sim_core_read_reg(rdn), ~sim_core_read_reg(rm), true);
+		return true;
+	case 2U: /* MOV (register) */
+		if (rdn == SIM_REG_PC)
+			sim_core_branch(sim_core_read_reg(rm));
+		else
+			sim_core_write_reg(rdn, sim_core_read_reg(rm));
+		return true;
+	default: { /* BX, BLX */
+		const uint32_t target = sim_core_read_reg(rm);
+		if (!(target & 1U))
+			return false;
+		if (insn & 0x80U)
+			sim_core.regs[SIM_REG_LR] = (sim_core.regs[SIM_REG_PC] + 2U) | 1U;
+		sim_core_branch(target);
+		return true;
+	}
+	}
+}
+
+static bool sim_core_load_store(const uint16_t insn)
+{
+	const uint8_t rt = insn & 7U;
+	const uint32_t base = sim_core_read_reg((insn >> 3U) & 7U);
+	if ((insn & 0xf000U) == 0x5000U) {
+		/* Register offset forms */
+		const uint32_t addr = base + sim_core_read_reg((insn >> 6U) & 7U);
+		switch ((insn >> 9U) & 7U) {
+		case 0U:
+			return sim_core_store(addr, 4U, rt);
+		case 1U:
+			return sim_core_store(addr, 2U, rt);
+		case 2U:
+			return sim_core_store(addr, 1U, rt);
+		case 3U:
+			return sim_core_load(addr, 1U, true, rt);
+		case 4U:
+			return sim_core_load(addr, 4U, false, rt);
+		case 5U:
+			return sim_core_load(addr, 2U, false, rt);
+		case 6U:
+			return sim_core_load(addr, 1U, false, rt);
+		default:
+			return sim_core_load(addr, 2U, true, rt);
+		}
+	}
+	/* Immediate offset forms, the offset is scaled by the access size */
+	const uint32_t offset = (insn >> 6U) & 0x1fU;
+	const bool load = insn & 0x0800U;
+	switch (insn & 0xf000U) {
+	case 0x6000U:
+		return load ? sim_core_load(base + offset * 4U, 4U, false, rt) : sim_core_store(base + offset * 4U, 4U, rt);
+	case 0x7000U:
+		return load ? sim_core_load(base + offset, 1U, false, rt) : sim_core_store(base + offset, 1U, rt);
+	default:
+		return load ? sim_core_load(base + offset * 2U, 2U, false, rt) : sim_core_store(base + offset * 2U, 2U, rt);
+	}
+}
+
+static bool sim_core_misc(const uint16_t insn)
+{
+	const uint8_t rd = insn & 7U;
+	const uint32_t rm = sim_core_read_reg((insn >> 3U) & 7U);
+	switch (insn & 0x0f00U) {
+	case 0x0000U: { /* ADD/SUB SP, SP, #imm7 */
+		const uint32_t offset = (insn & 0x7fU) * 4U;
+		const uint32_t sp = sim_core_read_reg(SIM_REG_SP);
+		sim_core_write_reg(SIM_REG_SP, insn & 0x80U ? sp - offset : sp + offset);
+		return true;
+	}
+	case 0x0200U: /* SXTH, SXTB, UXTH, UXTB */
+		switch ((insn >> 6U) & 3U) {
+		case 0U:
+			sim_core_write_reg(rd, (uint32_t)(int32_t)(int16_t)rm);
+			break;
+		case 1U:
+			sim_core_write_reg(rd, (uint32_t)(int32_t)(int8_t)rm);
+			break;
+		case 2U:
+			sim_core_write_reg(rd, rm & 0xffffU);
+			break;
+		default:
+			sim_core_write_reg(rd, rm & 0xffU);
+			break;
+		}
+		return true;
+	case 0x0400U:
+	case 0x0500U: { /* PUSH */
+		const uint16_t list = (insn & 0xffU) | (insn & 0x100U ? 1U << SIM_REG_LR : 0U);
+		const uint32_t sp = sim_core_read_reg(SIM_REG_SP) - 4U * (uint32_t)__builtin_popcount(list);
+		if (!sim_core_transfer_list(sp, list, false))
+			return false;
+		sim_core_write_reg(SIM_REG_SP, sp);
+		return true;
+	}
+	case 0x0c00U:
+	case 0x0d00U: { /* POP */
+		const uint16_t list = (insn & 0xffU) | (insn & 0x100U ? 1U << SIM_REG_PC : 0U);
+		const uint32_t sp = sim_core_read_reg(SIM_REG_SP);
+		if (!sim_core_transfer_list(sp, list, true))
+			return false;
+		sim_core_write_reg(SIM_REG_SP, sp + 4U * (uint32_t)__builtin_popcount(list));
+		return true;
+	}
+	case 0x0600U: /* CPSIE i, CPSID i */
+		if ((insn & 0xffefU) != 0xb662U)
+			return false;
+		if (insn & 0x10U)
+			sim_core.regs[SIM_REG_SPECIAL] |= 1U;
+		else
+			sim_core.regs[SIM_REG_SPECIAL] &= ~1U;
+		return true;
+	case 0x0a00U: /* REV, REV16, REVSH */
+		switch ((insn >> 6U) & 3U) {
+		case 0U:
+			sim_core_write_reg(rd, __builtin_bswap32(rm));
+			return true;
+		case 1U:
+			sim_core_write_reg(rd, ((rm >> 8U) & 0x00ff00ffU) | ((rm << 8U) & 0xff00ff00U));
+			return true;
+		case 3U:
+			sim_core_write_reg(rd, (uint32_t)(int32_t)(int16_t)__builtin_bswap16((uint16_t)rm));
+			return true;
+		default:
+			return false;
+		}
+	case 0x0e00U: /* BKPT, which halts with the PC still on it */
+		sim_core.regs[SIM_REG_PC] -= 2U;
+		sim_core_halt(CORTEXM_DFSR_BKPT);
+		return true;
+	case 0x0f00U: /* NOP and the other hints, but not Thumb-2's IT */
+		return !(insn & 0xfU);
+	default:
+		return false;
+	}
+}
+
+static bool sim_core_32bit(const uint16_t insn)
+{
+	uint32_t insn2 = 0;
+	if (!sim_bus_read(sim_core.regs[SIM_REG_PC] + 2U, 2U, &insn2))
+		return false;
+	const uint32_t pc = sim_core.regs[SIM_REG_PC];
+	/* BL */
+	if ((insn & 0xf800U) == 0xf000U && (insn2 & 0xd000U) == 0xd000U) {
+		const uint32_t sign = (insn >> 10U) & 1U;
+		const uint32_t i1 = !(((insn2 >> 13U) & 1U) ^ sign);
+		const uint32_t i2 = !(((insn2 >> 11U) & 1U) ^ sign);
+		uint32_t offset =
+			(sign << 24U) | (i1 << 23U) | (i2 << 22U) | ((insn & 0x3ffU) << 12U) | ((insn2 & 0x7ffU) << 1U);
+		if (sign)
+			offset |= 0xfe000000U;
+		sim_core.regs[SIM_REG_LR] = (pc + 4U) | 1U;
+		sim_core_branch(pc + 4U + offset);
+		++sim_core.cycles;
+		return true;
+	}
+	/* DSB, DMB, ISB */
+	if (insn == 0xf3bfU && (insn2 & 0xffc0U) == 0x8f40U) {
+		sim_core.regs[SIM_REG_PC] = pc + 4U;
+		return true;
+	}
+	return false;
+}
+
+/* Execute the instruction at PC, returning false if it faults */
+static bool sim_core_execute(void)
+{
+	const uint32_t pc = sim_core.regs[SIM_REG_PC];
+	uint32_t fetched = 0;
+	if (!sim_bus_read(pc, 2U, &fetched))
+		return false;
+	const uint16_t insn = (uint16_t)fetched;
+	sim_core.cycles = 1U;
+	/* Assume we fall through to the next instruction, branches override this */
+	sim_core.regs[SIM_REG_PC] = pc + 2U;
+
+	if ((insn & 0xe000U) == 0xe000U && (insn & 0xf800U) != 0xe000U) {
+		sim_core.regs[SIM_REG_PC] = pc;
+		return sim_core_32bit(insn);
+	}
+
+	const uint8_t rd = insn & 7U;
+	const uint8_t rn = (insn >> 3U) & 7U;
+	switch (insn >> 11U) {
+	case 0x00U: /* LSL, LSR, ASR (immediate) */
+	case 0x01U:
+	case 0x02U: {
+		const sim_shift_e type = (sim_shift_e)(insn >> 11U);
+		uint32_t amount = (insn >> 6U) & 0x1fU;
+		if (!amount && type != SIM_SHIFT_LSL)
+			amount = 32U;
+		bool carry = sim_core_c();
+		const uint32_t result = sim_core_shift(type, sim_core_read_reg(rn), amount, &carry);
+		sim_core_set_nz(result);
+		sim_core_set_c(carry);
+		sim_core_write_reg(rd, result);
+		return true;
+	}
+	case 0x03U: { /* ADD, SUB (register and 3-bit immediate) */
+		const uint32_t operand = insn & 0x0400U ? (insn >> 6U) & 7U : sim_core_read_reg((insn >> 6U) & 7U);
+		const uint32_t lhs = sim_core_read_reg(rn);
+		sim_core_write_reg(rd, insn & 0x0200U ? sim_core_add(lhs, ~operand, true) : sim_core_add(lhs, operand, false));
+		return true;
+	}
+	case 0x04U: /* MOV (immediate) */
+		sim_core_write_reg((insn >> 8U) & 7U, insn & 0xffU);
+		sim_core_set_nz(insn & 0xffU);
+		return true;
+	case 0x05U: /* CMP (immediate) */
+		sim_core_add(sim_core_read_reg((insn >> 8U) & 7U), ~(uint32_t)(insn & 0xffU), true);
+		return true;
+	case 0x06U: /* ADD (8-bit immediate) */
+		sim_core_write_reg((insn >> 8U) & 7U, sim_core_add(sim_core_read_reg((insn >> 8U) & 7U), insn & 0xffU, false));
+		return true;
+	case 0x07U: /* SUB (8-bit immediate) */
+		sim_core_write_reg(
+			(insn >> 8U) & 7U, sim_core_add(sim_core_read_reg((insn >> 8U) & 7U), ~(uint32_t)(insn & 0xffU), true));
+		return true;
+	case 0x08U:
+		if (insn & 0x0400U)
+			return sim_core_special_data(insn);
+		return sim_core_data_processing(insn);
+	case 0x09U: /* LDR (literal) */
+		return sim_core_load(((pc + 4U) & ~3U) + (insn & 0xffU) * 4U, 4U, false, (insn >> 8U) & 7U);
+	case 0x0aU:
+	case 0x0bU:
+	case 0x0cU:
+	case 0x0dU:
+	case 0x0eU:
+	case 0x0fU:
+	case 0x10U:
+	case 0x11U:
+		return sim_core_load_store(insn);
+	case 0x12U: /* STR (SP relative) */
+		return sim_core_store(sim_core_read_reg(SIM_REG_SP) + (insn & 0xffU) * 4U, 4U, (insn >> 8U) & 7U);
+	case 0x13U: /* LDR (SP relative) */
+		return sim_core_load(sim_core_read_reg(SIM_REG_SP) + (insn & 0xffU) * 4U, 4U, false, (insn >> 8U) & 7U);
+	case 0x14U: /* ADR */
+		sim_core_write_reg((insn >> 8U) & 7U, ((pc + 4U) & ~3U) + (insn & 0xffU) * 4U);
+		return true;
+	case 0x15U: /* ADD (SP plus immediate) */
+		sim_core_write_reg((insn >> 8U) & 7U, sim_core_read_reg(SIM_REG_SP) + (insn & 0xffU) * 4U);
+		return true;
+	case 0x16U:
+	case 0x17U:
+		return sim_core_misc(insn);
+	case 0x18U:
+	case 0x19U: { /* STM, LDM */
+		const uint8_t base_reg = (insn >> 8U) & 7U;
+		const uint16_t list = insn & 0xffU;
+		const uint32_t base = sim_core_read_reg(base_reg);
+		const bool load = insn & 0x0800U;
+		if (!list || !sim_core_transfer_list(base, list, load))
+			return false;
+		/* LDM with the base register in the list doesn't write back */
+		if (!load || !(list & (1U << base_reg)))
+			sim_core_write_reg(base_reg, base + 4U * (uint32_t)__builtin_popcount(list));
+		return true;
+	}
+	case 0x1aU:
+	case 0x1bU: { /* B<cond>, UDF is cond 0xe and SVC cond 0xf */
+		const uint8_t cond = (insn >> 8U) & 0xfU;
+		if (cond >= 0xeU)
+			return false;
+		if (sim_core_condition(cond))
+			sim_core_branch(pc + 4U + (uint32_t)((int32_t)(int8_t)(insn & 0xffU) * 2));
+		return true;
+	}
+	default: { /* B */
+		uint32_t offset = (insn & 0x7ffU) << 1U;
+		if (offset & 0x800U)
+			offset |= 0xfffff000U;
+		sim_core_branch(pc + 4U + offset);
+		return true;
+	}
+	}
+}
+
+static bool sim_core_fpb_match(const uint32_t pc)
+{
+	if (!sim_core.fpb_enabled)
+		return false;
+	for (size_t i = 0; i < SIM_FPB_NUM_CODE; ++i) {
+		const uint32_t comp = *sim_ppb_reg(CORTEXM_FPB_COMP(i));
+		if (!(comp & 1U) || (comp & 0x1ffffffcU) != (pc & 0x1ffffffcU))
+			continue;
+		/* REPLACE picks the half-word of the matched word to break on */
+		if ((comp >> 30U) == (pc & 2U ? 2U : 1U) || (comp >> 30U) == 3U)
+			return true;
+	}
+	return false;
+}
+
+/* Execute one instruction, or halt on a breakpoint on it, escalating faults to lockup or a vector catch */
+static void sim_core_step(void)
+{
+	const uint32_t pc = sim_core.regs[SIM_REG_PC];
+	if (!sim_core.resuming && sim_core_fpb_match(pc)) {
+		sim_core_halt(CORTEXM_DFSR_BKPT);
+		return;
+	}
+	sim_core.resuming = false;
+	sim_core.on_bus = true;
+	const bool executed = sim_core_execute();
+	sim_core.on_bus = false;
+	if (!executed) {
+		/* Everything that isn't implemented escalates to HardFault */
+		sim_core.regs[SIM_REG_PC] = pc;
+		if (*sim_ppb_reg(CORTEXM_DEMCR) & CORTEXM_DEMCR_VC_HARDERR && sim_core.dhcsr & CORTEXM_DHCSR_C_DEBUGEN)
+			sim_core_halt(CORTEXM_DFSR_VCATCH);
+		else
+			sim_core.locked_up = true;
+		DEBUG_TARGET("Simulated core faulted at 0x%08" PRIx32 "\n", pc);
+		return;
+	}
+	sim_core.time_ns += (uint64_t)sim_core.cycles * SIM_CORE_CYCLE_NS;
+}
+
+/* Run the core until it has caught up with the modelled time of the link, or until it stops */
+static void sim_core_run(void)
+{
+	const uint64_t now = sim_time_ns();
+	while (!sim_core.halted && !sim_core.locked_up && !sim_core.in_reset && sim_core.time_ns < now)
+		sim_core_step();
+	if (sim_core.time_ns < now || sim_core.halted || sim_core.locked_up)
+		sim_core.time_ns = now;
+}
@@ -30,9 +30,15 @@
 #include "timeofday.h"
 #include "timing.h"
 #include "bmp_hosted.h"
+#include "sim.h"
 
 void platform_delay(uint32_t ms)
 {
+	/* The simulated target runs on modelled time, so sleeping for real would only hold the host up */
+	if (bmda_probe_info.type == PROBE_TYPE_SIM) {
+		sim_delay(ms);
+		return;
+	}
 #if defined(_WIN32) && !defined(__MINGW32__)
 	Sleep(ms);
 #else
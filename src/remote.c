@@ -41,9 +41,33 @@
 #include "version.h"
 #include "exception.h"
 #include "hex_utils.h"
+#include "buffer_utils.h"
 
 #if PC_HOSTED == 0
+/* Frame lengths are 16-bit, and a frame has to fit in the packet buffer */
+#define REMOTE_FRAME_MAX_LENGTH MIN(GDB_PACKET_BUFFER_SIZE, UINT16_MAX)
+/* Which accelerations may send us binary frames */
+#if defined(ENABLE_RISCV_ACCEL) && ENABLE_RISCV_ACCEL == 1
+#define REMOTE_FRAMES_ACCEPTED (REMOTE_FRAMES_ADIV5 | REMOTE_FRAMES_ADIV6 | REMOTE_FRAMES_BATCH | REMOTE_FRAMES_RISCV)
+#else
+#define REMOTE_FRAMES_ACCEPTED (REMOTE_FRAMES_ADIV5 | REMOTE_FRAMES_ADIV6 | REMOTE_FRAMES_BATCH)
+#endif
+
 static void remote_packet_process_adiv6(const char *packet, size_t packet_len);
+static void remote_frame_process_adiv6(const uint8_t *frame, size_t frame_len);
+
+/* Whether the request being handled came in as a binary frame, and so must be answered with one */
+static bool remote_framed = false;
+
+/* Send the start of a binary response frame with the given amount of data to follow the response code */
+static void remote_frame_begin(const char response_code, const size_t len)
+{
+	const size_t frame_length = len + 1U;
+	gdb_if_putchar(REMOTE_FRAME_SOM, false);
+	gdb_if_putchar((char)(frame_length & 0xffU), false);
+	gdb_if_putchar((char)(frame_length >> 8U), false);
+	gdb_if_putchar(response_code, false);
+}
 
 /* hex-ify and send a buffer of data */
 static void remote_send_buf(const void *const buffer, const size_t len)
@@ -60,6 +84,14 @@ static void remote_send_buf(const void *const buffer, const size_t len)
 /* Send a response with some data following */
 static void remote_respond_buf(const char response_code, const void *const buffer, const size_t len)
 {
+	if (remote_framed) {
+		remote_frame_begin(response_code, len);
+		const uint8_t *const data = (const uint8_t *)buffer;
+		for (size_t offset = 0; offset < len; ++offset)
+			gdb_if_putchar((char)data[offset], false);
+		gdb_if_putchar(REMOTE_EOM, true);
+		return;
+	}
 	gdb_if_putchar(REMOTE_RESP, 0);
 	gdb_if_putchar(response_code, 0);
 
@@ -71,6 +103,12 @@ static void remote_respond_buf(const char response_code, const void *const buffe
 /* Send a response with a simple result code parameter */
 static void remote_respond(const char response_code, uint64_t param)
 {
+	if (remote_framed) {
+		uint8_t value[8];
+		write_le8(value, 0, param);
+		remote_respond_buf(response_code, value, sizeof(value));
+		return;
+	}
 	/* Put out the start of response marker and response code */
 	gdb_if_putchar(REMOTE_RESP, false);
 	gdb_if_putchar(response_code, false);
@@ -98,6 +136,10 @@ static void remote_respond(const char response_code, uint64_t param)
 /* Send a response with a string following */
 static void remote_respond_string(const char response_code, const char *const str)
 {
+	if (remote_framed) {
+		remote_respond_buf(response_code, str, strlen(str));
+		return;
+	}
 	gdb_if_putchar(REMOTE_RESP, 0);
 	gdb_if_putchar(response_code, 0);
 	const size_t str_length = strlen(str);
@@ -349,6 +391,11 @@ static void remote_packet_process_high_level(const char *packet, const size_t pa
 		break;
 	}
 
+	case REMOTE_HL_FRAMES: /* HB = request which accelerations can take binary frames, and how large */
+		remote_respond(REMOTE_RESP_OK,
+			((uint64_t)REMOTE_FRAMES_ACCEPTED << REMOTE_FRAMES_SHIFT) | REMOTE_FRAME_MAX_LENGTH);
+		break;
+
 	case REMOTE_HL_ACCEL: { /* HA = request what accelerations are available */
 		/* Build a response value that depends on what things are built into the firmare */
 		remote_respond(REMOTE_RESP_OK,
@@ -596,6 +643,236 @@ static void remote_packet_process_adiv6(const char *const packet, const size_t p
 	SET_IDLE_STATE(1);
 }
 
+/* Run a queue of raw DP/AP register accesses back to back, replying with all the values read at the end */
+static void remote_frame_adiv5_batch(const uint8_t *const frame, const size_t frame_len)
+{
+	const size_t count = (frame_len - REMOTE_FRAME_ADIV5_BATCH_LENGTH) / REMOTE_ADIV5_BATCH_ACCESS_LENGTH;
+	if (frame_len != REMOTE_FRAME_ADIV5_BATCH_LENGTH + (count * REMOTE_ADIV5_BATCH_ACCESS_LENGTH)) {
+		remote_respond(REMOTE_RESP_PARERR, 0);
+		return;
+	}
+	/*
+	 * The values read are collected at the start of the packet buffer the frame arrived in. Each access
+	 * is 7 bytes and yields at most 4, so this never overtakes the access being decoded.
+	 */
+	uint8_t *const results = (uint8_t *)gdb_packet_buffer();
+	size_t result_length = 0U;
+	for (size_t idx = 0; idx < count; ++idx) {
+		const uint8_t *const access =
+			frame + REMOTE_FRAME_ADIV5_BATCH_LENGTH + (idx * REMOTE_ADIV5_BATCH_ACCESS_LENGTH);
+		const uint16_t addr = read_le2(access, 1U);
+		const uint16_t reg = (addr & REMOTE_ADIV5_APnDP ? ADIV5_APnDP : 0U) | (addr & 0x00ffU);
+		const uint32_t value = read_le4(access, 3U);
+		switch (access[0]) {
+		case REMOTE_ADIV5_BATCH_WRITE:
+			adiv5_dp_write(&remote_dp, reg, value);
+			break;
+		case REMOTE_ADIV5_BATCH_READ:
+			write_le4(results, result_length, adiv5_dp_read(&remote_dp, reg));
+			result_length += 4U;
+			break;
+		case REMOTE_ADIV5_BATCH_WAIT: {
+			platform_timeout_s timeout;
+			platform_timeout_set(&timeout, REMOTE_ADIV5_BATCH_WAIT_TIMEOUT);
+			while ((adiv5_dp_read(&remote_dp, reg) & value) != value && !remote_dp.fault) {
+				if (platform_timeout_is_expired(&timeout))
+					raise_exception(EXCEPTION_TIMEOUT, "Batched wait timed out");
+			}
+			break;
+		}
+		default:
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			return;
+		}
+		/* Stop at the first access to fault, the rest of the queue likely depends on it */
+		if (remote_dp.fault)
+			break;
+	}
+	remote_adiv5_respond(results, result_length);
+}
+
+static void remote_frame_process_adiv5(const uint8_t *const frame, const size_t frame_len)
+{
+	/* Check if this is actually an ADIv6 acceleration frame and dispatch */
+	if (frame[1] == REMOTE_ADIV6_PACKET) {
+		remote_frame_process_adiv6(frame, frame_len);
+		return;
+	}
+
+	/* Our shortest ADIv5 frame is 6 bytes long, check that we have at least that */
+	if (frame_len < REMOTE_FRAME_ADIV5_DP_READ_LENGTH) {
+		remote_respond(REMOTE_RESP_PARERR, 0);
+		return;
+	}
+
+	/* Set up the DP and a fake AP structure to perform the access with */
+	remote_dp.dev_index = frame[2];
+	remote_dp.fault = 0U;
+	adiv5_access_port_s remote_ap;
+	remote_ap.apsel = frame[3];
+	remote_ap.dp = &remote_dp;
+	/* For the register access commands, decode the register address */
+	const uint16_t addr = read_le2(frame, 4U);
+	const uint16_t reg = (addr & REMOTE_ADIV5_APnDP ? ADIV5_APnDP : 0U) | (addr & 0x00ffU);
+
+	SET_IDLE_STATE(0);
+	switch (frame[1]) {
+	case REMOTE_ADIV5_BATCH:
+		remote_frame_adiv5_batch(frame, frame_len);
+		break;
+	case REMOTE_DP_READ: {
+		const uint32_t data = adiv5_dp_read(&remote_dp, reg);
+		remote_adiv5_respond(&data, 4U);
+		break;
+	}
+	case REMOTE_ADIV5_RAW_ACCESS: {
+		if (frame_len != REMOTE_FRAME_ADIV5_RAW_ACCESS_LENGTH) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		/* The AP select byte holds R/!W for this access */
+		const uint32_t data = adiv5_dp_low_access(&remote_dp, remote_ap.apsel, reg, read_le4(frame, 6U));
+		remote_adiv5_respond(&data, 4U);
+		break;
+	}
+	case REMOTE_AP_READ: {
+		const uint32_t data = adiv5_ap_read(&remote_ap, reg);
+		remote_adiv5_respond(&data, 4U);
+		break;
+	}
+	case REMOTE_AP_WRITE:
+		if (frame_len != REMOTE_FRAME_ADIV5_AP_WRITE_LENGTH) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		adiv5_ap_write(&remote_ap, reg, read_le4(frame, 6U));
+		remote_adiv5_respond(NULL, 0U);
+		break;
+	case REMOTE_MEM_READ: {
+		if (frame_len != REMOTE_FRAME_ADIV5_MEM_READ_LENGTH) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		remote_ap.csw = read_le4(frame, 4U);
+		const target_addr64_t address = read_le8(frame, 8U);
+		const uint32_t length = read_le4(frame, 16U);
+		/* The data read has to fit in a reply frame after the response code */
+		if (length > REMOTE_FRAME_MAX_LENGTH - 1U) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		/* The request has been fully decoded, so the packet buffer can be reused for the data read */
+		void *data = gdb_packet_buffer();
+		adiv5_mem_read(&remote_ap, data, address, length);
+		remote_adiv5_respond(data, length);
+		break;
+	}
+	case REMOTE_MEM_WRITE: {
+		if (frame_len < REMOTE_FRAME_ADIV5_MEM_WRITE_LENGTH) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		remote_ap.csw = read_le4(frame, 4U);
+		const align_e align = frame[8];
+		const target_addr64_t address = read_le8(frame, 9U);
+		const uint32_t length = read_le4(frame, 17U);
+		/* Validate the data is all there and that the alignment is suitable */
+		if (length != frame_len - REMOTE_FRAME_ADIV5_MEM_WRITE_LENGTH || (length & ((1U << align) - 1U))) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		/* Move the data down to the (aligned) start of the packet buffer it arrived in */
+		void *data = gdb_packet_buffer();
+		memmove(data, frame + REMOTE_FRAME_ADIV5_MEM_WRITE_LENGTH, length);
+		adiv5_mem_write_aligned(&remote_ap, address, data, length, align);
+		remote_adiv5_respond(NULL, 0);
+		break;
+	}
+	default:
+		remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_UNRECOGNISED);
+		break;
+	}
+	SET_IDLE_STATE(1);
+}
+
+static void remote_frame_process_adiv6(const uint8_t *const frame, const size_t frame_len)
+{
+	/* Our shortest ADIv6 frame is 14 bytes long, check that we have at least that */
+	if (frame_len < REMOTE_FRAME_ADIV6_AP_READ_LENGTH) {
+		remote_respond(REMOTE_RESP_PARERR, 0);
+		return;
+	}
+
+	/* Set up the DP, a copy using the ADIv6 AP routines, and a fake AP structure to perform the access with */
+	remote_dp.dev_index = frame[3];
+	remote_dp.fault = 0U;
+	adiv5_debug_port_s dp = remote_dp;
+	dp.ap_read = adiv6_ap_reg_read;
+	dp.ap_write = adiv6_ap_reg_write;
+	adiv6_access_port_s remote_ap;
+	remote_ap.ap_address = read_le8(frame, 4U);
+	remote_ap.base.dp = &dp;
+
+	SET_IDLE_STATE(0);
+	switch (frame[2]) {
+	case REMOTE_AP_READ: {
+		const uint32_t data = adiv5_ap_read(&remote_ap.base, read_le2(frame, 12U));
+		remote_adiv5_respond(&data, 4U);
+		break;
+	}
+	case REMOTE_AP_WRITE:
+		if (frame_len != REMOTE_FRAME_ADIV6_AP_WRITE_LENGTH) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		adiv5_ap_write(&remote_ap.base, read_le2(frame, 12U), read_le4(frame, 14U));
+		remote_adiv5_respond(NULL, 0U);
+		break;
+	case REMOTE_MEM_READ: {
+		if (frame_len != REMOTE_FRAME_ADIV6_MEM_READ_LENGTH) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		remote_ap.base.csw = read_le4(frame, 12U);
+		const target_addr64_t address = read_le8(frame, 16U);
+		const uint32_t length = read_le4(frame, 24U);
+		/* The data read has to fit in a reply frame after the response code */
+		if (length > REMOTE_FRAME_MAX_LENGTH - 1U) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		void *data = gdb_packet_buffer();
+		adiv5_mem_read(&remote_ap.base, data, address, length);
+		remote_adiv5_respond(data, length);
+		break;
+	}
+	case REMOTE_MEM_WRITE: {
+		if (frame_len < REMOTE_FRAME_ADIV6_MEM_WRITE_LENGTH) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		remote_ap.base.csw = read_le4(frame, 12U);
+		const align_e align = frame[16];
+		const target_addr64_t address = read_le8(frame, 17U);
+		const uint32_t length = read_le4(frame, 25U);
+		/* Validate the data is all there and that the alignment is suitable */
+		if (length != frame_len - REMOTE_FRAME_ADIV6_MEM_WRITE_LENGTH || (length & ((1U << align) - 1U))) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		void *data = gdb_packet_buffer();
+		memmove(data, frame + REMOTE_FRAME_ADIV6_MEM_WRITE_LENGTH, length);
+		adiv5_mem_write_aligned(&remote_ap.base, address, data, length, align);
+		remote_adiv5_respond(NULL, 0);
+		break;
+	}
+	default:
+		remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_UNRECOGNISED);
+		break;
+	}
+	SET_IDLE_STATE(1);
+}
+
 #if defined(ENABLE_RISCV_ACCEL) && ENABLE_RISCV_ACCEL == 1
 /*
  * This faked RISC-V DMI structure holds the currently used low-level implementation functions and basic DMI
@@ -695,6 +972,83 @@ void remote_packet_process_riscv(const char *const packet, const size_t packet_l
 		break;
 	}
 }
+
+/* Run a queue of DMI register accesses back to back, replying with all the values read at the end */
+static void remote_frame_riscv_batch(const uint8_t *const frame, const size_t frame_len)
+{
+	const size_t count = (frame_len - REMOTE_FRAME_RISCV_BATCH_LENGTH) / REMOTE_RISCV_BATCH_ACCESS_LENGTH;
+	if (frame_len != REMOTE_FRAME_RISCV_BATCH_LENGTH + (count * REMOTE_RISCV_BATCH_ACCESS_LENGTH)) {
+		remote_respond(REMOTE_RESP_PARERR, 0);
+		return;
+	}
+	remote_dmi.dev_index = frame[2];
+	remote_dmi.idle_cycles = frame[3];
+	remote_dmi.address_width = frame[4];
+	remote_dmi.fault = 0U;
+	/*
+	 * The values read are collected at the start of the packet buffer the frame arrived in. Each access
+	 * is 9 bytes and yields at most 4, so this never overtakes the access being decoded.
+	 */
+	uint8_t *const results = (uint8_t *)gdb_packet_buffer();
+	size_t result_length = 0U;
+	for (size_t idx = 0; idx < count; ++idx) {
+		const uint8_t *const access =
+			frame + REMOTE_FRAME_RISCV_BATCH_LENGTH + (idx * REMOTE_RISCV_BATCH_ACCESS_LENGTH);
+		const uint32_t address = read_le4(access, 1U);
+		const uint32_t value = read_le4(access, 5U);
+		bool result = true;
+		switch (access[0]) {
+		case REMOTE_RISCV_BATCH_WRITE:
+			result = remote_dmi.write(&remote_dmi, address, value);
+			break;
+		case REMOTE_RISCV_BATCH_READ: {
+			uint32_t data = 0U;
+			result = remote_dmi.read(&remote_dmi, address, &data);
+			write_le4(results, result_length, data);
+			result_length += 4U;
+			break;
+		}
+		case REMOTE_RISCV_BATCH_WAIT_CLEAR: {
+			platform_timeout_s timeout;
+			platform_timeout_set(&timeout, REMOTE_RISCV_BATCH_WAIT_TIMEOUT);
+			uint32_t data = value;
+			while (result && (data & value)) {
+				if (platform_timeout_is_expired(&timeout))
+					raise_exception(EXCEPTION_TIMEOUT, "Batched wait timed out");
+				result = remote_dmi.read(&remote_dmi, address, &data);
+			}
+			break;
+		}
+		default:
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			return;
+		}
+		/* Stop at the first access to fail, the rest of the queue likely depends on it */
+		if (!result) {
+			remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_FAULT | ((uint16_t)remote_dmi.fault << 8U));
+			return;
+		}
+	}
+	remote_respond_buf(REMOTE_RESP_OK, results, result_length);
+}
+
+static void remote_frame_process_riscv(const uint8_t *const frame, const size_t frame_len)
+{
+	/* The batch is the only RISC-V request taking a frame, check we have at least its fixed part */
+	if (frame_len < REMOTE_FRAME_RISCV_BATCH_LENGTH) {
+		remote_respond(REMOTE_RESP_PARERR, 0);
+		return;
+	}
+
+	switch (frame[1]) {
+	case REMOTE_RISCV_BATCH:
+		remote_frame_riscv_batch(frame, frame_len);
+		break;
+	default:
+		remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_UNRECOGNISED);
+		break;
+	}
+}
 #endif
 
 static void remote_spi_respond(const bool result)
@@ -858,4 +1212,41 @@ void remote_packet_process(char *const packet, const size_t packet_length)
 		break;
 	}
 }
+
+static void remote_frame_dispatch(const uint8_t *const frame, const size_t frame_length)
+{
+	/* Only the ADIv5, ADIv6 and RISC-V accelerations take frames */
+	switch (frame[0]) {
+	case REMOTE_ADIV5_PACKET:
+		remote_frame_process_adiv5(frame, frame_length);
+		break;
+#if defined(ENABLE_RISCV_ACCEL) && ENABLE_RISCV_ACCEL == 1
+	case REMOTE_RISCV_PACKET:
+		remote_frame_process_riscv(frame, frame_length);
+		break;
+#endif
+	default:
+		remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_UNRECOGNISED);
+		break;
+	}
+}
+
+void remote_frame_process(const uint8_t *const frame, const size_t frame_length)
+{
+	/* Everything we send back for this request has to be framed too */
+	remote_framed = true;
+	if (frame_length >= 3U) {
+		/* Setup an exception frame to try the operation in */
+		TRY (EXCEPTION_ALL) {
+			remote_frame_dispatch(frame, frame_length);
+		}
+		CATCH () {
+		/* Handle any exception we've caught by translating it into a remote protocol response */
+		default:
+			remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_EXCEPTION | ((uint64_t)exception_frame.type << 8U));
+		}
+	} else
+		remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_UNRECOGNISED);
+	remote_framed = false;
+}
 #endif
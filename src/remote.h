@@ -26,7 +26,7 @@
 #include <stddef.h>
 #include "general.h"
 
-#define REMOTE_HL_VERSION 4
+#define REMOTE_HL_VERSION 5
 
 /*
  * Commands to remote end, and responses
@@ -52,6 +52,25 @@
  * to be marshalled in remote.c, swdptap.c and jtagtap.c, so be
  * careful to ensure the parameter handling matches the protocol
  * definition when anything is changed.
+ *
+ * Binary frames
+ * =============
+ *
+ * From protocol v5, once the host has checked for support with the HB request, ADIv5 and ADIv6
+ * acceleration requests may instead be sent as binary frames. These avoid the hex encoding and
+ * its parsing, so a frame carries twice the memory data an ASCII request of the same size can.
+ *
+ * \x02<LEN><PAYLOAD>#
+ *   <LEN>     - payload length as a 16-bit little endian value
+ *   <PAYLOAD> - the packet type and command characters, as for the ASCII request, followed by
+ *               the same parameters in the same order but as little endian binary values
+ *
+ * The reply to a frame is a frame whose payload is the response code, followed by the response
+ * data if there is any, and otherwise the 64-bit result value.
+ *
+ * Where HB reports it, the AQ frame carries a whole queue of raw DP/AP register accesses which the
+ * firmware runs back to back, replying with the values read in the order they were queued. This
+ * turns what would be a USB round-trip per register access into one per queue.
  */
 
 /* Protocol error messages */
@@ -64,6 +83,8 @@
 #define REMOTE_SOM  '!'
 #define REMOTE_EOM  '#'
 #define REMOTE_RESP '&'
+/* Start of a binary frame, which ends with REMOTE_EOM */
+#define REMOTE_FRAME_SOM '\x02'
 
 /* Protocol response options */
 #define REMOTE_RESP_OK     'K'
@@ -223,6 +244,7 @@
 #define REMOTE_HL_CHECK        'C'
 #define REMOTE_HL_ACCEL        'A'
 #define REMOTE_HL_ADD_JTAG_DEV 'J'
+#define REMOTE_HL_FRAMES       'B'
 
 #define REMOTE_HL_CHECK_STR                                          \
 	(char[])                                                         \
@@ -234,6 +256,11 @@
 	{                                                                \
 		REMOTE_SOM, REMOTE_HL_PACKET, REMOTE_HL_ACCEL, REMOTE_EOM, 0 \
 	}
+#define REMOTE_HL_FRAMES_STR                                          \
+	(char[])                                                          \
+	{                                                                 \
+		REMOTE_SOM, REMOTE_HL_PACKET, REMOTE_HL_FRAMES, REMOTE_EOM, 0 \
+	}
 #define REMOTE_JTAG_ADD_DEV_STR                                                               \
 	(char[])                                                                                  \
 	{                                                                                         \
@@ -253,6 +280,17 @@
 #define REMOTE_ACCEL_RISCV     (1U << 2U)
 #define REMOTE_ACCEL_ADIV6     (1U << 3U)
 
+/*
+ * The reply to HB packs the largest frame payload the firmware accepts into the bottom 32 bits,
+ * and which acceleration protocols may be sent as frames into the top 32 bits
+ */
+#define REMOTE_FRAMES_SIZE_MASK 0xffffffffU
+#define REMOTE_FRAMES_ADIV5     (1U << 0U)
+#define REMOTE_FRAMES_ADIV6     (1U << 1U)
+#define REMOTE_FRAMES_BATCH     (1U << 2U)
+#define REMOTE_FRAMES_RISCV     (1U << 3U)
+#define REMOTE_FRAMES_SHIFT     32U
+
 /* ADIv5 accleration protocol elements */
 #define REMOTE_ADIV5_PACKET     'A'
 #define REMOTE_DP_READ          'd'
@@ -261,6 +299,7 @@
 #define REMOTE_ADIV5_RAW_ACCESS 'R'
 #define REMOTE_MEM_READ         'm'
 #define REMOTE_MEM_WRITE        'M'
+#define REMOTE_ADIV5_BATCH      'Q'
 
 #define REMOTE_ADIV5_DEV_INDEX REMOTE_UINT8
 #define REMOTE_ADIV5_AP_SEL    REMOTE_UINT8
@@ -317,9 +356,38 @@
  */
 #define REMOTE_ADIV5_MEM_WRITE_LENGTH 42U
 
+/*
+ * Fixed part of each ADIv5 request when sent as a binary frame: the packet type and command, the
+ * dev index and AP select (or R/!W for raw accesses), then the parameters listed per request
+ */
+#define REMOTE_FRAME_ADIV5_DP_READ_LENGTH    6U  /* 16-bit address */
+#define REMOTE_FRAME_ADIV5_RAW_ACCESS_LENGTH 10U /* 16-bit address and 32-bit value */
+#define REMOTE_FRAME_ADIV5_AP_READ_LENGTH    6U  /* 16-bit address */
+#define REMOTE_FRAME_ADIV5_AP_WRITE_LENGTH   10U /* 16-bit address and 32-bit value */
+#define REMOTE_FRAME_ADIV5_MEM_READ_LENGTH   20U /* 32-bit CSW, 64-bit address and 32-bit count */
+#define REMOTE_FRAME_ADIV5_MEM_WRITE_LENGTH  21U /* CSW, 8-bit alignment, address, count, then the data */
+#define REMOTE_FRAME_ADIV5_BATCH_LENGTH      4U  /* Followed by the queued accesses */
+
+/* Each access in a batch is the operation, 16-bit register address and 32-bit value (the mask for a wait) */
+#define REMOTE_ADIV5_BATCH_ACCESS_LENGTH 7U
+#define REMOTE_ADIV5_BATCH_WRITE         'W'
+#define REMOTE_ADIV5_BATCH_READ          'R'
+/* Read the register until all the bits in the value are set, or give up after REMOTE_ADIV5_BATCH_WAIT_TIMEOUT ms */
+#define REMOTE_ADIV5_BATCH_WAIT         'w'
+#define REMOTE_ADIV5_BATCH_WAIT_TIMEOUT 250U
+
 /* ADIv6 acceleration protocol elements */
 #define REMOTE_ADIV6_PACKET '6'
 
+/*
+ * Fixed part of each ADIv6 request when sent as a binary frame: the packet type, '6' and command,
+ * the dev index and 64-bit AP base address, then the same parameters as for ADIv5
+ */
+#define REMOTE_FRAME_ADIV6_AP_READ_LENGTH   14U
+#define REMOTE_FRAME_ADIV6_AP_WRITE_LENGTH  18U
+#define REMOTE_FRAME_ADIV6_MEM_READ_LENGTH  28U
+#define REMOTE_FRAME_ADIV6_MEM_WRITE_LENGTH 29U
+
 #define REMOTE_ADIV6_AP_READ_STR                                                                      \
 	(char[])                                                                                          \
 	{                                                                                                 \
@@ -394,6 +462,20 @@
 /* Remote protocol enabled RISC-V protocols bit values */
 #define REMOTE_RISCV_PROTOCOL_JTAG (1U << 0U)
 
+/*
+ * The one RISC-V request sent as a binary frame is a batch: the packet type and command, the dev index,
+ * idle cycles and address width, then the queued DMI accesses, each the operation, 32-bit address and
+ * 32-bit value (the mask for a wait)
+ */
+#define REMOTE_RISCV_BATCH               'Q'
+#define REMOTE_FRAME_RISCV_BATCH_LENGTH  5U
+#define REMOTE_RISCV_BATCH_ACCESS_LENGTH 9U
+#define REMOTE_RISCV_BATCH_WRITE         'W'
+#define REMOTE_RISCV_BATCH_READ          'R'
+/* Read the register until all the bits in the value are clear, or give up after REMOTE_RISCV_BATCH_WAIT_TIMEOUT ms */
+#define REMOTE_RISCV_BATCH_WAIT_CLEAR   'c'
+#define REMOTE_RISCV_BATCH_WAIT_TIMEOUT 250U
+
 /* SPI protocol elements */
 #define REMOTE_SPI_PACKET      's'
 #define REMOTE_SPI_BEGIN       'B'
@@ -450,5 +532,6 @@
 	}
 
 void remote_packet_process(char *packet, size_t packet_length);
+void remote_frame_process(const uint8_t *frame, size_t frame_length);
 
 #endif /* REMOTE_H */
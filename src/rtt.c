@@ -73,6 +73,10 @@ char rtt_ident[16] = {0};
 
 /* usb uart transmit buffer */
 static char xmit_buf[RTT_UP_BUF_SIZE];
+/* host to target data gathered up so it can be written to the target in blocks */
+static char recv_buf[RTT_DOWN_BUF_SIZE];
+/* channels whose head or tail index was updated this poll and needs writing back to the target */
+static uint32_t rtt_dirty_chan = 0;
 
 /*********************************************************************
 *
@@ -81,60 +85,93 @@ static char xmit_buf[RTT_UP_BUF_SIZE];
 **********************************************************************
 */
 
-static uint32_t fast_search(target_s *const cur_target, const uint32_t ram_start, const uint32_t ram_end)
+/*
+ * Control block searches read target RAM a window at a time. Hosted builds can afford a much larger window,
+ * cutting down the number of probe round-trips needed to scan a large RAM.
+ */
+#if PC_HOSTED == 1
+#define RTT_SEARCH_WINDOW 4096U
+#else
+#define RTT_SEARCH_WINDOW 256U
+#endif
+#define RTT_MAX_IDENT_LEN 16U
+
+/* Default control block ident, "SEGGER RTT" padded out with NULs to 16 bytes */
+static const char rtt_default_ident[RTT_MAX_IDENT_LEN] = "SEGGER RTT";
+/* Window buffer, with room in front for the tail of the previous window carried over */
+static uint8_t rtt_search_buf[RTT_MAX_IDENT_LEN + RTT_SEARCH_WINDOW];
+/* Address the control block was last found at, checked before falling back to a full search */
+static uint32_t rtt_cbaddr_hint = 0;
+
+static size_t rtt_search_ident(const uint8_t **const ident)
 {
-	static const uint32_t m = 16;
-	static const uint64_t p = 0x444110cd;
-	static const uint64_t q = 0x797a9691; /* prime */
-	static const uint64_t r = 0x73b07d01;
-	static const uint32_t stride = 128;
-	uint64_t t = 0;
-	uint8_t *srch_buf = alloca(m + stride);
-
-	memset(srch_buf, 0, m + stride);
-
-	for (uint32_t addr = ram_start; addr < ram_end; addr += stride) {
-		uint32_t buf_siz = MIN(stride, ram_end - addr);
-		memcpy(srch_buf, srch_buf + stride, m);
-		if (target_mem32_read(cur_target, srch_buf + m, addr, buf_siz)) {
-			gdb_outf("rtt: read fail at 0x%" PRIx32 "\r\n", addr);
-			return 0;
-		}
-		for (uint32_t i = 0; i < buf_siz; i++) {
-			t = (t + q - r * srch_buf[i] % q) % q;
-			t = ((t << 8U) + srch_buf[i + m]) % q;
-			if (p == t)
-				return addr + i - m + 1U;
-		}
+	if (rtt_ident[0] == 0) {
+		*ident = (const uint8_t *)rtt_default_ident;
+		return sizeof(rtt_default_ident);
 	}
-	/* no match */
-	return 0;
+	*ident = (const uint8_t *)rtt_ident;
+	return strnlen(rtt_ident, sizeof(rtt_ident));
 }
 
-static uint32_t memory_search(target_s *const cur_target, const uint32_t ram_start, const uint32_t ram_end)
+/* Boyer-Moore-Horspool search of target memory in the range [ram_start, ram_end) for the given ident */
+static uint32_t memory_search(target_s *const cur_target, const uint8_t *const ident, const size_t ident_len,
+	const uint32_t ram_start, const uint32_t ram_end)
 {
-	const char *const srch_str = rtt_ident;
-	const uint32_t srch_str_len = strlen(srch_str);
-	uint8_t srch_buf[128];
-
-	if (srch_str_len == 0 || srch_str_len > sizeof(srch_buf) / 2U)
+	if (ident_len == 0 || ident_len > RTT_MAX_IDENT_LEN)
 		return 0;
 
-	for (uint32_t addr = ram_start; addr < ram_end; addr += sizeof(srch_buf) - srch_str_len - 1U) {
-		uint32_t buf_siz = MIN(ram_end - addr, sizeof(srch_buf));
-		if (target_mem32_read(cur_target, srch_buf, addr, buf_siz)) {
+	/* Build the bad character shift table */
+	uint8_t shift[256];
+	memset(shift, (int)ident_len, sizeof(shift));
+	for (size_t i = 0; i + 1U < ident_len; ++i)
+		shift[ident[i]] = (uint8_t)(ident_len - 1U - i);
+
+	size_t carried = 0;
+	for (uint32_t addr = ram_start; addr < ram_end;) {
+		const uint32_t chunk = MIN(ram_end - addr, RTT_SEARCH_WINDOW);
+		if (target_mem32_read(cur_target, rtt_search_buf + carried, addr, chunk)) {
 			gdb_outf("rtt: read fail at 0x%" PRIx32 "\r\n", addr);
+			carried = 0;
+			addr += chunk;
 			continue;
 		}
-		for (uint32_t offset = 0; offset + srch_str_len + 1U < buf_siz; offset++) {
-			if (strncmp((const char *)(srch_buf + offset), srch_str, srch_str_len) == 0)
-				return addr + offset;
+		const size_t valid = carried + chunk;
+		for (size_t offset = 0; offset + ident_len <= valid;) {
+			const uint8_t last = rtt_search_buf[offset + ident_len - 1U];
+			if (last == ident[ident_len - 1U] && memcmp(rtt_search_buf + offset, ident, ident_len - 1U) == 0)
+				return addr - carried + offset;
+			offset += shift[last];
 		}
+		/* Carry the end of this window over so a match straddling two reads is still found */
+		carried = MIN(ident_len - 1U, valid);
+		memmove(rtt_search_buf, rtt_search_buf + valid - carried, carried);
+		addr += chunk;
 	}
 	return 0;
 }
 
-static void find_rtt(target_s *const cur_target)
+/* Check if the control block is still where we last found it, so a re-search can skip the full scan */
+static bool rtt_check_hint(target_s *const cur_target, const uint8_t *const ident, const size_t ident_len)
+{
+	if (!rtt_cbaddr_hint)
+		return false;
+
+	bool in_range = false;
+	if (rtt_flag_ram)
+		in_range = rtt_cbaddr_hint >= rtt_ram_start && rtt_cbaddr_hint + ident_len <= rtt_ram_end;
+	else {
+		for (const target_ram_s *r = cur_target->ram; r && !in_range; r = r->next)
+			in_range = rtt_cbaddr_hint >= r->start && rtt_cbaddr_hint + ident_len <= r->start + r->length;
+	}
+	if (!in_range)
+		return false;
+
+	uint8_t found_ident[RTT_MAX_IDENT_LEN];
+	return !target_mem32_read(cur_target, found_ident, rtt_cbaddr_hint, ident_len) &&
+		memcmp(found_ident, ident, ident_len) == 0;
+}
+
+void find_rtt(target_s *const cur_target)
 {
 	rtt_found = false;
 	poll_ms = rtt_max_poll_ms;
@@ -144,26 +181,22 @@ static void find_rtt(target_s *const cur_target)
 	if (!cur_target || !rtt_enabled)
 		return;
 
+	const uint8_t *ident = NULL;
+	const size_t ident_len = rtt_search_ident(&ident);
 	rtt_cbaddr = 0;
-	if (!rtt_flag_ram) {
+	if (rtt_check_hint(cur_target, ident, ident_len))
+		rtt_cbaddr = rtt_cbaddr_hint;
+	else if (!rtt_flag_ram) {
 		/* search all of target ram */
 		for (const target_ram_s *r = cur_target->ram; r; r = r->next) {
-			const uint32_t ram_start = r->start;
-			const uint32_t ram_end = r->start + r->length;
-			if (rtt_ident[0] == 0)
-				rtt_cbaddr = fast_search(cur_target, ram_start, ram_end);
-			else
-				rtt_cbaddr = memory_search(cur_target, ram_start, ram_end);
+			rtt_cbaddr = memory_search(cur_target, ident, ident_len, r->start, r->start + r->length);
 			if (rtt_cbaddr)
 				break;
 		}
-	} else {
+	} else
 		/* search  only given target address range */
-		if (rtt_ident[0] == 0)
-			rtt_cbaddr = fast_search(cur_target, rtt_ram_start, rtt_ram_end);
-		else
-			rtt_cbaddr = memory_search(cur_target, rtt_ram_start, rtt_ram_end);
-	}
+		rtt_cbaddr = memory_search(cur_target, ident, ident_len, rtt_ram_start, rtt_ram_end);
+	rtt_cbaddr_hint = rtt_cbaddr;
 	DEBUG_INFO("rtt: match at 0x%" PRIx32 "\r\n", rtt_cbaddr);
 
 	if (rtt_cbaddr) {
@@ -232,24 +265,31 @@ static rtt_retval_e read_rtt(target_s *const cur_target, const uint32_t i)
 	if (rtt_channel[i].head >= rtt_channel[i].buf_size || rtt_channel[i].tail >= rtt_channel[i].buf_size)
 		return RTT_ERR;
 
-	/* write recv_buf to target rtt 'down' buf */
-	while (true) {
-		const uint32_t next_head = (rtt_channel[i].head + 1U) % rtt_channel[i].buf_size;
-		if (rtt_channel[i].tail == next_head)
-			break;
-		const int ch = rtt_getchar();
+	/* free space in target rtt 'down' buf, one slot is always left empty to tell full from empty */
+	const uint32_t bytes_free =
+		(rtt_channel[i].tail + rtt_channel[i].buf_size - rtt_channel[i].head - 1U) % rtt_channel[i].buf_size;
+	/* gather up as much host data as will fit */
+	uint32_t len = 0;
+	while (len < MIN(bytes_free, sizeof(recv_buf))) {
+		const int32_t ch = rtt_getchar();
 		if (ch == -1)
 			break;
-		if (target_mem32_write(cur_target, rtt_channel[i].buf_addr + rtt_channel[i].head, &ch, 1))
-			return RTT_ERR;
-		/* advance head pointer */
-		rtt_channel[i].head = next_head;
+		recv_buf[len++] = (char)ch;
 	}
+	if (len == 0)
+		return RTT_OK;
 
-	/* update head of target 'down' buffer */
-	const uint32_t head_addr = rtt_cbaddr + 24U + i * 24U + 12U;
-	if (target_mem32_write(cur_target, head_addr, &rtt_channel[i].head, sizeof(rtt_channel[i].head)))
+	/* write recv_buf to target rtt 'down' buf, in two blocks if it wraps around the end */
+	const uint32_t first_len = MIN(len, rtt_channel[i].buf_size - rtt_channel[i].head);
+	if (target_mem32_write(cur_target, rtt_channel[i].buf_addr + rtt_channel[i].head, recv_buf, first_len))
+		return RTT_ERR;
+	if (len > first_len &&
+		target_mem32_write(cur_target, rtt_channel[i].buf_addr, recv_buf + first_len, len - first_len))
 		return RTT_ERR;
+
+	/* advance head pointer, the target copy gets updated once all channels are serviced */
+	rtt_channel[i].head = (rtt_channel[i].head + len) % rtt_channel[i].buf_size;
+	rtt_dirty_chan |= 1U << i;
 	return RTT_OK;
 }
 
@@ -292,32 +332,36 @@ static rtt_retval_e print_rtt(target_s *const cur_target, const uint32_t i)
 
 	uint32_t bytes_free = sizeof(xmit_buf) - 8U; /* need 8 bytes for alignment and padding */
 	uint32_t bytes_read = 0;
-
-	if (rtt_channel[i].tail > rtt_channel[i].head) {
-		uint32_t len = rtt_channel[i].buf_size - rtt_channel[i].tail;
+	/*
+	 * work on a copy of the tail, so a read that fails part way leaves the channel as it was. Otherwise
+	 * write_rtt_indices() could still write the tail back when it covers this channel alongside others.
+	 */
+	uint32_t tail = rtt_channel[i].tail;
+
+	if (tail > rtt_channel[i].head) {
+		uint32_t len = rtt_channel[i].buf_size - tail;
 		if (len > bytes_free)
 			len = bytes_free;
-		if (rtt_aligned_mem_read(cur_target, xmit_buf + bytes_read, rtt_channel[i].buf_addr + rtt_channel[i].tail, len))
+		if (rtt_aligned_mem_read(cur_target, xmit_buf + bytes_read, rtt_channel[i].buf_addr + tail, len))
 			return RTT_ERR;
 		bytes_free -= len;
 		bytes_read += len;
-		rtt_channel[i].tail = (rtt_channel[i].tail + len) % rtt_channel[i].buf_size;
+		tail = (tail + len) % rtt_channel[i].buf_size;
 	}
 
-	if (rtt_channel[i].head > rtt_channel[i].tail && bytes_free > 0) {
-		uint32_t len = rtt_channel[i].head - rtt_channel[i].tail;
+	if (rtt_channel[i].head > tail && bytes_free > 0) {
+		uint32_t len = rtt_channel[i].head - tail;
 		if (len > bytes_free)
 			len = bytes_free;
-		if (rtt_aligned_mem_read(cur_target, xmit_buf + bytes_read, rtt_channel[i].buf_addr + rtt_channel[i].tail, len))
+		if (rtt_aligned_mem_read(cur_target, xmit_buf + bytes_read, rtt_channel[i].buf_addr + tail, len))
 			return RTT_ERR;
 		bytes_read += len;
-		rtt_channel[i].tail = (rtt_channel[i].tail + len) % rtt_channel[i].buf_size;
+		tail = (tail + len) % rtt_channel[i].buf_size;
 	}
 
-	/* update tail of target 'up' buffer */
-	const uint32_t tail_addr = rtt_cbaddr + 24U + i * 24U + 16U;
-	if (target_mem32_write(cur_target, tail_addr, &rtt_channel[i].tail, sizeof(rtt_channel[i].tail)))
-		return RTT_ERR;
+	/* tail of target 'up' buffer gets updated once all channels are serviced */
+	rtt_channel[i].tail = tail;
+	rtt_dirty_chan |= 1U << i;
 
 	/* write buffer to usb */
 	rtt_write(xmit_buf, bytes_read);
@@ -325,6 +369,43 @@ static rtt_retval_e print_rtt(target_s *const cur_target, const uint32_t i)
 	return RTT_OK;
 }
 
+/*
+ * Write back the head ('down' channels) and tail ('up' channels) indices updated while servicing the channels.
+ * With the target halted the channel table can't change under us, so the span of channel descriptors covering
+ * all the updates is written back in one go, otherwise only the individual index fields are touched.
+ */
+static rtt_retval_e write_rtt_indices(target_s *const cur_target, const bool target_halted)
+{
+	const uint32_t dirty = rtt_dirty_chan;
+	rtt_dirty_chan = 0;
+	if (!dirty)
+		return RTT_IDLE;
+
+	if (target_halted) {
+		uint32_t first = 0;
+		while (!(dirty & (1U << first)))
+			++first;
+		uint32_t last = MAX_RTT_CHAN - 1U;
+		while (!(dirty & (1U << last)))
+			--last;
+		const uint32_t addr = rtt_cbaddr + 24U + first * 24U;
+		if (target_mem32_write(cur_target, addr, &rtt_channel[first], sizeof(rtt_channel[0]) * (last - first + 1U)))
+			return RTT_ERR;
+		return RTT_OK;
+	}
+
+	for (uint32_t i = 0; i < MAX_RTT_CHAN; i++) {
+		if (!(dirty & (1U << i)))
+			continue;
+		const bool up_channel = i < rtt_num_up_chan;
+		const uint32_t index_addr = rtt_cbaddr + 24U + i * 24U + (up_channel ? 16U : 12U);
+		const uint32_t *const index = up_channel ? &rtt_channel[i].tail : &rtt_channel[i].head;
+		if (target_mem32_write(cur_target, index_addr, index, sizeof(*index)))
+			return RTT_ERR;
+	}
+	return RTT_OK;
+}
+
 /*********************************************************************
 *
 *       rtt top level
@@ -373,6 +454,7 @@ void poll_rtt(target_s *const cur_target)
 
 		bool rtt_err = false;
 		bool rtt_busy = false;
+		rtt_dirty_chan = 0;
 		/* do rtt i/o if control block found */
 		if (rtt_found && rtt_cbaddr) {
 			/* copy control block from target */
@@ -398,6 +480,8 @@ void poll_rtt(target_s *const cur_target)
 							rtt_err = true;
 					}
 				}
+				if (write_rtt_indices(cur_target, resume_target) == RTT_ERR)
+					rtt_err = true;
 			}
 		}
 
@@ -41,6 +41,10 @@
 #include "cortex.h"
 #include "cortex_internal.h"
 
+#if PC_HOSTED == 1
+#include "id_cache.h"
+#endif
+
 /* Used to probe for a protected SAMX5X device */
 #define SAMX5X_DSU_CTRLSTAT 0x41002100U
 #define SAMX5X_STATUSB_PROT (1U << 16U)
@@ -53,6 +57,16 @@
 #define ARM_COMPONENT_STR(...)
 #endif
 
+#if PC_HOSTED == 1
+/*
+ * What the ROM table walk in progress has dispatched so far, recorded into the identification cache
+ * once the walk completes: the first ROM table entry as a signature, then each core as "<arch>@<base>"
+ */
+static char adi_id_record[ID_CACHE_VALUE_MAX];
+static size_t adi_id_record_length;
+static bool adi_id_recording;
+#endif
+
 /*
  * The product ID register consists of several parts. For a full description
  * refer to the ADIv5 and ADIv6 specifications.
@@ -536,6 +550,63 @@ uint32_t adi_mem_read32(adiv5_access_port_s *const ap, const target_addr32_t add
 	return ret;
 }
 
+#if PC_HOSTED == 1
+void adi_id_cache_key(char *const key, const size_t size, const char *const kind, const adiv5_access_port_s *const ap)
+{
+	const adiv5_debug_port_s *const dp = ap->dp;
+	snprintf(key, size,
+		"%s:dp%u:%03x:%04x:%08" PRIx32 ":%03x:%04x:ap%u:%08" PRIx32 ":%08" PRIx32 "%08" PRIx32, kind, dp->version,
+		dp->designer_code, dp->partno, dp->targetsel, dp->target_designer_code, dp->target_partno, ap->apsel, ap->idr,
+		(uint32_t)(ap->base >> 32U), (uint32_t)ap->base);
+}
+
+static void adi_id_record_core(const char arch, const target_addr64_t base_address)
+{
+	if (!adi_id_recording)
+		return;
+	const int length = snprintf(adi_id_record + adi_id_record_length, sizeof(adi_id_record) - adi_id_record_length,
+		" %c@%" PRIx64, arch, base_address);
+	/* If this doesn't fit, give up on recording the walk rather than record it incompletely */
+	if (length < 0 || (size_t)length >= sizeof(adi_id_record) - adi_id_record_length)
+		adi_id_recording = false;
+	else
+		adi_id_record_length += (size_t)length;
+}
+
+/*
+ * If a walk of this ROM table has been recorded before and its first entry still reads the same,
+ * dispatch the cores it found without walking it again. Returns false if the walk must be done.
+ */
+static bool adi_id_cache_replay(adiv5_access_port_s *const ap, const char *const key, const uint32_t first_entry)
+{
+	const char *record = id_cache_lookup(key);
+	char *end = NULL;
+	if (!record || strtoul(record, &end, 16) != first_entry || end == record)
+		return false;
+
+	DEBUG_INFO("ROM Table: walk cached, signature %08" PRIx32 "\n", first_entry);
+	for (record = end; *record == ' ' && record[1] && record[2] == '@';) {
+		const char arch = record[1];
+		const target_addr64_t base_address = strtoull(record + 3U, &end, 16);
+		record = end;
+		switch (arch) {
+		case 'm':
+			cortexm_probe(ap);
+			break;
+		case 'a':
+			cortexa_probe(ap, base_address);
+			break;
+		case 'r':
+			cortexr_probe(ap, base_address);
+			break;
+		default:
+			break;
+		}
+	}
+	return true;
+}
+#endif
+
 static void adi_parse_adi_rom_table(adiv5_access_port_s *const ap, const target_addr32_t base_address,
 	const size_t recursion_depth, const char *const indent, const uint64_t pidr)
 {
@@ -574,12 +645,34 @@ static void adi_parse_adi_rom_table(adiv5_access_port_s *const ap, const target_
 			   "%08" PRIx32 ")\n",
 		base_address, memtype, designer_code, part_number, (uint32_t)(pidr >> 32U), (uint32_t)pidr);
 
+#if PC_HOSTED == 1
+	/*
+	 * For the top level table, the walk is keyed on the DP, the AP and this table's PIDR. If it has been done
+	 * before, skip it, otherwise record what it finds
+	 */
+	char id_key[ID_CACHE_KEY_MAX];
+	if (recursion_depth == 0U) {
+		adi_id_cache_key(id_key, sizeof(id_key), "rom", ap);
+		const size_t key_length = strlen(id_key);
+		snprintf(id_key + key_length, sizeof(id_key) - key_length, ":%08" PRIx32 "%08" PRIx32, (uint32_t)(pidr >> 32U),
+			(uint32_t)pidr);
+		const uint32_t first_entry = adi_mem_read32(ap, base_address);
+		if (!adiv5_dp_error(ap->dp) && adi_id_cache_replay(ap, id_key, first_entry))
+			return;
+		adi_id_record_length = (size_t)snprintf(adi_id_record, sizeof(adi_id_record), "%08" PRIx32, first_entry);
+		adi_id_recording = true;
+	}
+#endif
+
 	for (uint32_t i = 0; i < 960U; i++) {
 		adiv5_dp_error(ap->dp);
 
 		uint32_t entry = adi_mem_read32(ap, base_address + i * 4U);
 		if (adiv5_dp_error(ap->dp)) {
 			DEBUG_ERROR("%sFault reading ROM table entry %" PRIu32 "\n", indent, i);
+#if PC_HOSTED == 1
+			adi_id_recording = false;
+#endif
 			break;
 		}
 
@@ -595,6 +688,13 @@ static void adi_parse_adi_rom_table(adiv5_access_port_s *const ap, const target_
 		adi_ap_component_probe(ap, base_address + (entry & ADIV5_ROM_ROMENTRY_OFFSET), recursion_depth + 1U, i);
 	}
 	DEBUG_INFO("%sROM Table: END\n", indent);
+#if PC_HOSTED == 1
+	/* Only keep the walk if it went through without faults */
+	if (recursion_depth == 0U && adi_id_recording)
+		id_cache_store(id_key, adi_id_record);
+	if (recursion_depth == 0U)
+		adi_id_recording = false;
+#endif
 }
 
 /* Return true if we find a debuggable device. */
@@ -608,6 +708,9 @@ void adi_ap_component_probe(
 	const uint32_t cidr = adi_ap_read_id(ap, base_address + CIDR0_OFFSET);
 	if (ap->dp->fault) {
 		DEBUG_ERROR("Error reading CIDR on AP%u: %u\n", ap->apsel, ap->dp->fault);
+#if PC_HOSTED == 1
+		adi_id_recording = false;
+#endif
 		return;
 	}
 
@@ -623,6 +726,9 @@ void adi_ap_component_probe(
 
 	if (adiv5_dp_error(ap->dp)) {
 		DEBUG_ERROR("%sFault reading ID registers\n", indent);
+#if PC_HOSTED == 1
+		adi_id_recording = false;
+#endif
 		return;
 	}
 
@@ -685,14 +791,23 @@ void adi_ap_component_probe(
 			switch (component->arch) {
 			case aa_cortexm:
 				DEBUG_INFO("%s-> cortexm_probe\n", indent + 1);
+#if PC_HOSTED == 1
+				adi_id_record_core('m', base_address);
+#endif
 				cortexm_probe(ap);
 				break;
 			case aa_cortexa:
 				DEBUG_INFO("%s-> cortexa_probe\n", indent + 1);
+#if PC_HOSTED == 1
+				adi_id_record_core('a', base_address);
+#endif
 				cortexa_probe(ap, base_address);
 				break;
 			case aa_cortexr:
 				DEBUG_INFO("%s-> cortexr_probe\n", indent + 1);
+#if PC_HOSTED == 1
+				adi_id_record_core('r', base_address);
+#endif
 				cortexr_probe(ap, base_address);
 				break;
 			default:
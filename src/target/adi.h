@@ -41,6 +41,10 @@ void adi_ap_component_probe(
 	adiv5_access_port_s *ap, target_addr64_t base_address, size_t recursion, uint32_t entry_number);
 /* Helper for resuming all cores halted on an AP during probe */
 void adi_ap_resume_cores(adiv5_access_port_s *ap);
+#if PC_HOSTED == 1
+/* Helper for building an identification cache key from what identifies an AP and the DP it's on */
+void adi_id_cache_key(char *key, size_t size, const char *kind, const adiv5_access_port_s *ap);
+#endif
 
 /* Helpers for setting up memory accesses and banked accesses */
 void adi_ap_mem_access_setup(adiv5_access_port_s *ap, target_addr64_t addr, align_e align);
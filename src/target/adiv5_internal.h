@@ -154,6 +154,26 @@
 typedef struct adiv5_access_port adiv5_access_port_s;
 typedef struct adiv5_debug_port adiv5_debug_port_s;
 
+#if PC_HOSTED == 1
+typedef enum adiv5_batch_op {
+	ADIV5_BATCH_WRITE,
+	ADIV5_BATCH_READ,
+	/*
+	 * Read the register until all the bits in value are set. Only needed by adaptors that run the
+	 * batch back to back, a USB round-trip per access being far longer than anything this waits on.
+	 */
+	ADIV5_BATCH_WAIT,
+} adiv5_batch_op_e;
+
+/* One raw DP/AP register access in a batch, addr is as for adiv5_dp_read() and adiv5_dp_write() */
+typedef struct adiv5_batch_access {
+	adiv5_batch_op_e op;
+	uint16_t addr;
+	uint32_t value;
+	uint32_t *result;
+} adiv5_batch_access_s;
+#endif
+
 struct adiv5_debug_port {
 	int refcnt;
 
@@ -169,6 +189,8 @@ struct adiv5_debug_port {
 	void (*ap_regs_read)(adiv5_access_port_s *ap, void *data);
 	uint32_t (*ap_reg_read)(adiv5_access_port_s *ap, uint8_t reg_num);
 	void (*ap_reg_write)(adiv5_access_port_s *ap, uint8_t num, uint32_t value);
+	/* Run a sequence of raw register accesses in as few adaptor transactions as possible */
+	bool (*batch)(adiv5_debug_port_s *dp, const adiv5_batch_access_s *accesses, size_t count);
 #endif
 	uint32_t (*ap_read)(adiv5_access_port_s *ap, uint16_t addr);
 	void (*ap_write)(adiv5_access_port_s *ap, uint16_t addr, uint32_t value);
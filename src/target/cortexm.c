@@ -41,6 +41,7 @@
 #include "gdb_reg.h"
 #include "command.h"
 #include "gdb_packet.h"
+#include "gdb_if.h"
 #include "semihosting.h"
 #include "platform.h"
 #include "maths_utils.h"
@@ -56,6 +57,25 @@ const command_s cortexm_cmd_list[] = {
 
 #define CORTEXM_DCRSR_REG_WRITE (1U << 16U)
 
+/* On-target CRC32 for verify, see flashstub/crc32.s */
+static const uint16_t cortexm_crc32_stub[] = {
+#include "flashstub/crc32.stub"
+};
+
+#define CORTEXM_CRC32_TABLE_SIZE 1024U
+/*
+ * Offset of the bkpt that ends the stub, as cortexm_run_stub() can't tell a halt there apart from
+ * one anywhere else in the stub
+ */
+#define CORTEXM_CRC32_STUB_DONE (sizeof(cortexm_crc32_stub) - sizeof(cortexm_crc32_stub[0]))
+/* Keep each stub run well inside cortexm_run_stub()'s timeout, even on slow clocks */
+#define CORTEXM_CRC32_CHUNK_SIZE 65536U
+/*
+ * Saving and restoring the RAM under the stub and its table moves over 2KiB across the debug link,
+ * so below this it's cheaper to just read the region back
+ */
+#define CORTEXM_CRC32_MIN_LENGTH 4096U
+
 static const char *cortexm_target_description(target_s *target);
 static void cortexm_regs_read(target_s *target, void *data);
 static void cortexm_regs_write(target_s *target, const void *data);
@@ -82,6 +102,10 @@ typedef struct cortexm_priv {
 	uint32_t flash_patch_revision;
 	/* Copy of DEMCR for vector-catch */
 	uint32_t demcr;
+#if defined(PLATFORM_HAS_DEBUG)
+	/* Registers a stub was started with, for diagnosing it hanging */
+	uint32_t stub_regs_start[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT];
+#endif
 } cortexm_priv_s;
 
 /* Register number tables */
@@ -227,6 +251,192 @@ static void cortexm_mem_write(target_s *target, target_addr64_t dest, const void
 	adiv5_mem_write(cortex_ap(target), dest, src, len);
 }
 
+/* Try the part-specific probe routines for the designer and part the target identifies as */
+static bool cortexm_probe_parts(target_s *const target)
+{
+	switch (target->designer_code) {
+	case JEP106_MANUFACTURER_FREESCALE:
+		PROBE(imxrt_probe);
+		PROBE(kinetis_probe);
+		PROBE(s32k3xx_probe);
+		PROBE(ke04_probe);
+		break;
+	case JEP106_MANUFACTURER_GIGADEVICE:
+		PROBE(gd32f1_probe);
+		PROBE(gd32f4_probe);
+		break;
+	case JEP106_MANUFACTURER_STM:
+		PROBE(stm32f1_probe);
+		PROBE(stm32f4_probe);
+		PROBE(stm32h5_probe);
+		PROBE(stm32h7_probe);
+		PROBE(stm32mp15_cm4_probe);
+		PROBE(stm32l0_probe);
+		PROBE(stm32l1_probe);
+		PROBE(stm32l4_probe);
+		PROBE(stm32g0_probe);
+		PROBE(stm32wb0_probe);
+		break;
+	case JEP106_MANUFACTURER_CYPRESS:
+		DEBUG_WARN("Unhandled Cypress device\n");
+		break;
+	case JEP106_MANUFACTURER_INFINEON:
+		DEBUG_WARN("Unhandled Infineon device\n");
+		break;
+	case JEP106_MANUFACTURER_NORDIC:
+		PROBE(nrf51_probe);
+		PROBE(nrf91_probe);
+		break;
+	case JEP106_MANUFACTURER_ATMEL:
+		PROBE(samx7x_probe);
+		PROBE(sam4l_probe);
+		PROBE(samd_probe);
+		PROBE(samx5x_probe);
+		break;
+	case JEP106_MANUFACTURER_ENERGY_MICRO:
+		PROBE(efm32_probe);
+		break;
+	case JEP106_MANUFACTURER_TEXAS:
+		PROBE(msp432p4_probe);
+		break;
+	case JEP106_MANUFACTURER_SPECULAR:
+		PROBE(lpc11xx_probe); /* LPC845 */
+		break;
+	case JEP106_MANUFACTURER_RASPBERRY:
+		PROBE(rp2040_probe);
+		PROBE(rp2350_probe);
+		break;
+	case JEP106_MANUFACTURER_RENESAS:
+		PROBE(renesas_ra_probe);
+		break;
+	case JEP106_MANUFACTURER_WCH:
+		PROBE(ch579_probe);
+		break;
+	case JEP106_MANUFACTURER_NXP:
+		if ((target->cpuid & CORTEX_CPUID_PARTNO_MASK) == CORTEX_M33)
+			PROBE(lpc55xx_probe);
+		else
+			DEBUG_WARN("Unhandled NXP device\n");
+		break;
+	case JEP106_MANUFACTURER_ARM_CHINA:
+		PROBE(mm32f3xx_probe); /* MindMotion Star-MC1 */
+		break;
+	case JEP106_MANUFACTURER_ARM:
+		/*
+		 * All of these have braces as a brake from the standard so they're completely
+		 * consistent and easier to add new probe calls to.
+		 */
+		if (target->part_id == 0x4c0U) {        /* Cortex-M0+ ROM */
+			PROBE(lpc11xx_probe);               /* LPC8 */
+			PROBE(hc32l110_probe);              /* HDSC HC32L110 */
+			PROBE(puya_probe);                  /* Puya PY32 */
+		} else if (target->part_id == 0x4c1U) { /* NXP Cortex-M0+ ROM */
+			PROBE(lpc11xx_probe);               /* newer LPC11U6x */
+		} else if (target->part_id == 0x4c3U) { /* Cortex-M3 ROM */
+			PROBE(lmi_probe);
+			PROBE(ch32f1_probe);
+			PROBE(stm32f1_probe);               /* Care for other STM32F1 clones (?) */
+			PROBE(lpc15xx_probe);               /* Thanks to JojoS for testing */
+			PROBE(mm32f3xx_probe);              /* MindMotion MM32 */
+		} else if (target->part_id == 0x471U) { /* Cortex-M0 ROM */
+			PROBE(lpc11xx_probe);               /* LPC24C11 */
+			PROBE(lpc43xx_probe);
+			PROBE(mm32l0xx_probe);              /* MindMotion MM32 */
+		} else if (target->part_id == 0x4c4U) { /* Cortex-M4 ROM */
+			PROBE(sam3x_probe);
+			PROBE(lmi_probe);
+			PROBE(apollo_3_probe);
+			/*
+			 * The LPC546xx and LPC43xx parts present with the same AP ROM part number,
+			 * so we need to probe both. Unfortunately, when probing for the LPC43xx
+			 * when the target is actually an LPC546xx, the memory location checked
+			 * is illegal for the LPC546xx and puts the chip into lockup, requiring a
+			 * reset pulse to recover. Instead, make sure to probe for the LPC546xx first,
+			 * which experimentally doesn't harm LPC43xx detection.
+			 */
+			PROBE(lpc546xx_probe);
+			PROBE(lpc43xx_probe);
+			PROBE(at32f40x_probe);
+			PROBE(at32f43x_probe); /* AT32F435 doesn't survive LPC40xx IAP */
+			PROBE(lpc40xx_probe);
+			PROBE(kinetis_probe); /* Older K-series */
+			PROBE(msp432e4_probe);
+		} else if (target->part_id == 0x4cbU) { /* Cortex-M23 ROM */
+			PROBE(gd32f1_probe);                /* GD32E23x uses GD32F1 peripherals */
+		}
+		break;
+	case ASCII_CODE_FLAG:
+		/*
+		 * these devices enumerate an AP with an empty ascii code,
+		 * and have no available designer code elsewhere
+		 */
+		PROBE(sam3x_probe);
+		PROBE(ke04_probe);
+		PROBE(lpc17xx_probe);
+		PROBE(lpc11xx_probe); /* LPC1343 */
+		break;
+	}
+	return false;
+}
+
+#if PC_HOSTED == 1
+/*
+ * Probe routines that only read ID registers before deciding and claim only parts no later routine in
+ * their chain would, so skipping them to get to a cached claimant can't change which routine claims a part
+ */
+static const char *const cortexm_side_effect_free_probes[] = {
+	"stm32f1_probe",
+	"stm32f4_probe",
+	"stm32h5_probe",
+	"stm32h7_probe",
+	"stm32mp15_cm4_probe",
+	"stm32l0_probe",
+	"stm32l1_probe",
+	"stm32l4_probe",
+	"stm32g0_probe",
+	NULL,
+};
+
+/*
+ * If this part was identified before and nothing ahead of the probe routine that claimed it in the chain
+ * needs to run to keep the chain's ordering guarantees, go straight to that routine. Otherwise, or if that
+ * no longer claims it, try them in order and record which one does for next time.
+ */
+static bool cortexm_probe_cached(target_s *const target, const adiv5_access_port_s *const ap)
+{
+	char key[ID_CACHE_KEY_MAX];
+	adi_id_cache_key(key, sizeof(key), "cortexm", ap);
+	const size_t key_length = strlen(key);
+	snprintf(key + key_length, sizeof(key) - key_length, ":%03x:%03x:%08" PRIx32, ap->designer_code, ap->partno,
+		target->cpuid);
+
+	const char *const claimant = id_cache_lookup(key);
+	if (claimant) {
+		/* Walk the chain without calling anything to find out what lies ahead of the claimant */
+		id_cache_probe_check(claimant, cortexm_side_effect_free_probes);
+		cortexm_probe_parts(target);
+		if (id_cache_probe_trusted()) {
+			id_cache_probe_only(claimant);
+			const bool claimed = cortexm_probe_parts(target);
+			id_cache_probe_only(NULL);
+			if (claimed) {
+				DEBUG_INFO("Part identified by cached %s\n", claimant);
+				return true;
+			}
+			DEBUG_WARN("Cached %s no longer claims the part, trying all probe routines\n", claimant);
+		}
+	}
+
+	id_cache_probe_only(NULL);
+	if (!cortexm_probe_parts(target))
+		return false;
+	/* Only successful identifications are recorded, a failed one may just have been a bad moment */
+	if (id_cache_probe_claimant())
+		id_cache_store(key, id_cache_probe_claimant());
+	return true;
+}
+#endif
+
 bool cortexm_probe(adiv5_access_port_s *ap)
 {
 	target_s *target = target_new();
@@ -355,131 +565,13 @@ bool cortexm_probe(adiv5_access_port_s *ap)
 
 	DEBUG_TARGET("%s: Examining Part ID 0x%04x, AP Part ID: 0x%04x\n", __func__, target->part_id, ap->partno);
 
-	switch (target->designer_code) {
-	case JEP106_MANUFACTURER_FREESCALE:
-		PROBE(imxrt_probe);
-		PROBE(kinetis_probe);
-		PROBE(s32k3xx_probe);
-		PROBE(ke04_probe);
-		break;
-	case JEP106_MANUFACTURER_GIGADEVICE:
-		PROBE(gd32f1_probe);
-		PROBE(gd32f4_probe);
-		break;
-	case JEP106_MANUFACTURER_STM:
-		PROBE(stm32f1_probe);
-		PROBE(stm32f4_probe);
-		PROBE(stm32h5_probe);
-		PROBE(stm32h7_probe);
-		PROBE(stm32mp15_cm4_probe);
-		PROBE(stm32l0_probe);
-		PROBE(stm32l1_probe);
-		PROBE(stm32l4_probe);
-		PROBE(stm32g0_probe);
-		PROBE(stm32wb0_probe);
-		break;
-	case JEP106_MANUFACTURER_CYPRESS:
-		DEBUG_WARN("Unhandled Cypress device\n");
-		break;
-	case JEP106_MANUFACTURER_INFINEON:
-		DEBUG_WARN("Unhandled Infineon device\n");
-		break;
-	case JEP106_MANUFACTURER_NORDIC:
-		PROBE(nrf51_probe);
-		PROBE(nrf91_probe);
-		break;
-	case JEP106_MANUFACTURER_ATMEL:
-		PROBE(samx7x_probe);
-		PROBE(sam4l_probe);
-		PROBE(samd_probe);
-		PROBE(samx5x_probe);
-		break;
-	case JEP106_MANUFACTURER_ENERGY_MICRO:
-		PROBE(efm32_probe);
-		break;
-	case JEP106_MANUFACTURER_TEXAS:
-		PROBE(msp432p4_probe);
-		break;
-	case JEP106_MANUFACTURER_SPECULAR:
-		PROBE(lpc11xx_probe); /* LPC845 */
-		break;
-	case JEP106_MANUFACTURER_RASPBERRY:
-		PROBE(rp2040_probe);
-		PROBE(rp2350_probe);
-		break;
-	case JEP106_MANUFACTURER_RENESAS:
-		PROBE(renesas_ra_probe);
-		break;
-	case JEP106_MANUFACTURER_WCH:
-		PROBE(ch579_probe);
-		break;
-	case JEP106_MANUFACTURER_NXP:
-		if ((target->cpuid & CORTEX_CPUID_PARTNO_MASK) == CORTEX_M33)
-			PROBE(lpc55xx_probe);
-		else
-			DEBUG_WARN("Unhandled NXP device\n");
-		break;
-	case JEP106_MANUFACTURER_ARM_CHINA:
-		PROBE(mm32f3xx_probe); /* MindMotion Star-MC1 */
-		break;
-	case JEP106_MANUFACTURER_ARM:
-		/*
-		 * All of these have braces as a brake from the standard so they're completely
-		 * consistent and easier to add new probe calls to.
-		 */
-		if (target->part_id == 0x4c0U) {        /* Cortex-M0+ ROM */
-			PROBE(lpc11xx_probe);               /* LPC8 */
-			PROBE(hc32l110_probe);              /* HDSC HC32L110 */
-			PROBE(puya_probe);                  /* Puya PY32 */
-		} else if (target->part_id == 0x4c1U) { /* NXP Cortex-M0+ ROM */
-			PROBE(lpc11xx_probe);               /* newer LPC11U6x */
-		} else if (target->part_id == 0x4c3U) { /* Cortex-M3 ROM */
-			PROBE(lmi_probe);
-			PROBE(ch32f1_probe);
-			PROBE(stm32f1_probe);               /* Care for other STM32F1 clones (?) */
-			PROBE(lpc15xx_probe);               /* Thanks to JojoS for testing */
-			PROBE(mm32f3xx_probe);              /* MindMotion MM32 */
-		} else if (target->part_id == 0x471U) { /* Cortex-M0 ROM */
-			PROBE(lpc11xx_probe);               /* LPC24C11 */
-			PROBE(lpc43xx_probe);
-			PROBE(mm32l0xx_probe);              /* MindMotion MM32 */
-		} else if (target->part_id == 0x4c4U) { /* Cortex-M4 ROM */
-			PROBE(sam3x_probe);
-			PROBE(lmi_probe);
-			PROBE(apollo_3_probe);
-			/*
-			 * The LPC546xx and LPC43xx parts present with the same AP ROM part number,
-			 * so we need to probe both. Unfortunately, when probing for the LPC43xx
-			 * when the target is actually an LPC546xx, the memory location checked
-			 * is illegal for the LPC546xx and puts the chip into lockup, requiring a
-			 * reset pulse to recover. Instead, make sure to probe for the LPC546xx first,
-			 * which experimentally doesn't harm LPC43xx detection.
-			 */
-			PROBE(lpc546xx_probe);
-			PROBE(lpc43xx_probe);
-			PROBE(at32f40x_probe);
-			PROBE(at32f43x_probe); /* AT32F435 doesn't survive LPC40xx IAP */
-			PROBE(lpc40xx_probe);
-			PROBE(kinetis_probe); /* Older K-series */
-			PROBE(msp432e4_probe);
-		} else if (target->part_id == 0x4cbU) { /* Cortex-M23 ROM */
-			PROBE(gd32f1_probe);                /* GD32E23x uses GD32F1 peripherals */
-		}
-		break;
-	case ASCII_CODE_FLAG:
-		/*
-		 * these devices enumerate an AP with an empty ascii code,
-		 * and have no available designer code elsewhere
-		 */
-		PROBE(sam3x_probe);
-		PROBE(ke04_probe);
-		PROBE(lpc17xx_probe);
-		PROBE(lpc11xx_probe); /* LPC1343 */
-		break;
-	}
 #if PC_HOSTED == 0
+	if (cortexm_probe_parts(target))
+		return true;
 	gdb_outf("Please report unknown device with Designer 0x%x Part ID 0x%x\n", target->designer_code, target->part_id);
 #else
+	if (cortexm_probe_cached(target, ap))
+		return true;
 	DEBUG_WARN(
 		"Please report unknown device with Designer 0x%x Part ID 0x%x\n", target->designer_code, target->part_id);
 #endif
@@ -575,11 +667,84 @@ enum {
 	DB_DEMCR
 };
 
+#if PC_HOSTED == 1
+#define CORTEXM_MAX_REG_COUNT (CORTEXM_GENERAL_REG_COUNT + CORTEXM_TRUSTZONE_REG_COUNT + CORTEX_FLOAT_REG_COUNT)
+
+/*
+ * Queue up the DCRSR/DCRDR accesses for a run of core registers. Every transfer is followed by a wait
+ * on DHCSR.S_REGRDY as the adaptor will run the accesses back to back without a round-trip in between.
+ */
+static size_t cortexm_queue_reg_reads(adiv5_batch_access_s *const accesses, size_t count, const uint8_t *const regnums,
+	const size_t regnum_count, uint32_t *const regs)
+{
+	for (size_t i = 0U; i < regnum_count; ++i) {
+		accesses[count++] = (adiv5_batch_access_s){ADIV5_BATCH_WRITE, ADIV5_AP_DB(DB_DCRSR), regnums[i], NULL};
+		accesses[count++] =
+			(adiv5_batch_access_s){ADIV5_BATCH_WAIT, ADIV5_AP_DB(DB_DHCSR), CORTEXM_DHCSR_S_REGRDY, NULL};
+		accesses[count++] = (adiv5_batch_access_s){ADIV5_BATCH_READ, ADIV5_AP_DB(DB_DCRDR), 0U, &regs[i]};
+	}
+	return count;
+}
+
+static size_t cortexm_queue_reg_writes(adiv5_batch_access_s *const accesses, size_t count,
+	const uint8_t *const regnums, const size_t regnum_count, const uint32_t *const regs)
+{
+	for (size_t i = 0U; i < regnum_count; ++i) {
+		accesses[count++] = (adiv5_batch_access_s){ADIV5_BATCH_WRITE, ADIV5_AP_DB(DB_DCRDR), regs[i], NULL};
+		accesses[count++] = (adiv5_batch_access_s){
+			ADIV5_BATCH_WRITE, ADIV5_AP_DB(DB_DCRSR), CORTEXM_DCRSR_REG_WRITE | regnums[i], NULL};
+		accesses[count++] =
+			(adiv5_batch_access_s){ADIV5_BATCH_WAIT, ADIV5_AP_DB(DB_DHCSR), CORTEXM_DHCSR_S_REGRDY, NULL};
+	}
+	return count;
+}
+
+/* Read the whole register file in a single batch rather than a round-trip per DCRSR write and DCRDR read */
+static bool cortexm_regs_read_batched(target_s *const target, adiv5_access_port_s *const ap, uint32_t *const regs)
+{
+	adiv5_batch_access_s accesses[CORTEXM_MAX_REG_COUNT * 3U];
+	size_t count = cortexm_queue_reg_reads(accesses, 0U, regnum_cortex_m, CORTEXM_GENERAL_REG_COUNT, regs);
+	size_t offset = CORTEXM_GENERAL_REG_COUNT;
+	if (target->target_options & CORTEXM_TOPT_TRUSTZONE) {
+		count = cortexm_queue_reg_reads(
+			accesses, count, regnum_cortex_m_trustzone, CORTEXM_TRUSTZONE_REG_COUNT, regs + offset);
+		offset += CORTEXM_TRUSTZONE_REG_COUNT;
+	}
+	if (target->target_options & CORTEXM_TOPT_FLAVOUR_V7MF)
+		count = cortexm_queue_reg_reads(accesses, count, regnum_cortex_mf, CORTEX_FLOAT_REG_COUNT, regs + offset);
+
+	adi_ap_mem_access_setup(ap, CORTEXM_DHCSR, ALIGN_32BIT);
+	adi_ap_banked_access_setup(ap);
+	return ap->dp->batch(ap->dp, accesses, count);
+}
+
+static bool cortexm_regs_write_batched(
+	target_s *const target, adiv5_access_port_s *const ap, const uint32_t *const regs)
+{
+	adiv5_batch_access_s accesses[CORTEXM_MAX_REG_COUNT * 3U];
+	size_t count = cortexm_queue_reg_writes(accesses, 0U, regnum_cortex_m, CORTEXM_GENERAL_REG_COUNT, regs);
+	size_t offset = CORTEXM_GENERAL_REG_COUNT;
+	if (target->target_options & CORTEXM_TOPT_TRUSTZONE) {
+		count = cortexm_queue_reg_writes(
+			accesses, count, regnum_cortex_m_trustzone, CORTEXM_TRUSTZONE_REG_COUNT, regs + offset);
+		offset += CORTEXM_TRUSTZONE_REG_COUNT;
+	}
+	if (target->target_options & CORTEXM_TOPT_FLAVOUR_V7MF)
+		count = cortexm_queue_reg_writes(accesses, count, regnum_cortex_mf, CORTEX_FLOAT_REG_COUNT, regs + offset);
+
+	adi_ap_mem_access_setup(ap, CORTEXM_DHCSR, ALIGN_32BIT);
+	adi_ap_banked_access_setup(ap);
+	return ap->dp->batch(ap->dp, accesses, count);
+}
+#endif
+
 static void cortexm_regs_read(target_s *const target, void *const data)
 {
 	uint32_t *const regs = data;
 	adiv5_access_port_s *const ap = cortex_ap(target);
 #if PC_HOSTED == 1
+	if (ap->dp->batch && cortexm_regs_read_batched(target, ap, regs))
+		return;
 	if (ap->dp->ap_regs_read && ap->dp->ap_reg_read) {
 		uint32_t core_regs[21U];
 		ap->dp->ap_regs_read(ap, core_regs);
@@ -632,6 +797,8 @@ static void cortexm_regs_write(target_s *const target, const void *const data)
 	const uint32_t *const regs = data;
 	adiv5_access_port_s *const ap = cortex_ap(target);
 #if PC_HOSTED == 1
+	if (ap->dp->batch && cortexm_regs_write_batched(target, ap, regs))
+		return;
 	if (ap->dp->ap_reg_write) {
 		for (size_t i = 0; i < CORTEXM_GENERAL_REG_COUNT; ++i)
 			ap->dp->ap_reg_write(ap, regnum_cortex_m[i], regs[i]);
@@ -949,7 +1116,12 @@ static int cortexm_fault_unwind(target_s *target)
 	return 0;
 }
 
-bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
+/*
+ * Load the stub's arguments and set the core running it, without waiting for it to finish.
+ * This lets a stub that takes work through a mailbox in RAM keep running while the debugger
+ * feeds it, see cortexm_wait_stub() for collecting the result.
+ */
+bool cortexm_start_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
 {
 	uint32_t regs[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT] = {0};
 
@@ -967,14 +1139,20 @@ bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t
 		return false;
 
 	/* Execute the stub */
-	target_halt_reason_e reason = TARGET_HALT_RUNNING;
 #if defined(PLATFORM_HAS_DEBUG)
-	uint32_t arm_regs_start[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT];
-	target_regs_read(target, arm_regs_start);
+	cortexm_priv_s *const priv = (cortexm_priv_s *)target->priv;
+	target_regs_read(target, priv->stub_regs_start);
 #endif
 	cortexm_halt_resume(target, 0);
+	return true;
+}
+
+/* Wait for a stub started by cortexm_start_stub() to hit a breakpoint, returning the breakpoint's immediate */
+bool cortexm_wait_stub(target_s *target, uint32_t timeout_ms)
+{
+	target_halt_reason_e reason = TARGET_HALT_RUNNING;
 	platform_timeout_s timeout;
-	platform_timeout_set(&timeout, 5000);
+	platform_timeout_set(&timeout, timeout_ms);
 	while (reason == TARGET_HALT_RUNNING) {
 		if (platform_timeout_is_expired(&timeout)) {
 			cortexm_halt_request(target);
@@ -983,7 +1161,8 @@ bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t
 			uint32_t arm_regs[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT];
 			target_regs_read(target, arm_regs);
 			for (uint32_t i = 0; i < 20U; ++i)
-				DEBUG_WARN("%2" PRIu32 ": %08" PRIx32 ", %08" PRIx32 "\n", i, arm_regs_start[i], arm_regs[i]);
+				DEBUG_WARN("%2" PRIu32 ": %08" PRIx32 ", %08" PRIx32 "\n", i,
+					((cortexm_priv_s *)target->priv)->stub_regs_start[i], arm_regs[i]);
 #endif
 			return false;
 		}
@@ -1006,6 +1185,109 @@ bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t
 	return bkpt_instr & 0xffU;
 }
 
+bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
+{
+	if (!cortexm_start_stub(target, loadaddr, r0, r1, r2, r3))
+		return false;
+	return cortexm_wait_stub(target, 5000);
+}
+
+static bool cortexm_target_listed(const target_s *const target)
+{
+	for (const target_s *listed = target_list; listed; listed = listed->next) {
+		if (listed == target)
+			return true;
+	}
+	return false;
+}
+
+/* Run the CRC32 stub loaded at work_addr over the region a chunk at a time, carrying the CRC through crc */
+static bool cortexm_crc32_run(target_s *const target, const target_addr32_t work_addr, const size_t stub_size,
+	const target_addr32_t base, const size_t len, uint32_t *const crc)
+{
+	uint32_t last_time = platform_time_ms();
+	for (size_t offset = 0; offset < len; offset += CORTEXM_CRC32_CHUNK_SIZE) {
+		const uint32_t actual_time = platform_time_ms();
+		if (actual_time > last_time + 1000U) {
+			last_time = actual_time;
+			gdb_if_putchar(0, true);
+		}
+		const size_t chunk_len = MIN(CORTEXM_CRC32_CHUNK_SIZE, len - offset);
+		if (cortexm_run_stub(target, work_addr, base + offset, chunk_len, *crc, work_addr + stub_size) ||
+			cortexm_pc_read(target) != work_addr + CORTEXM_CRC32_STUB_DONE ||
+			target_reg_read(target, 0U, crc, sizeof(*crc)) != sizeof(*crc)) {
+			DEBUG_WARN("%s: stub failed at 0x%08" PRIx32 "\n", __func__, (uint32_t)(base + offset));
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * Calculate the CRC32 of a region of target memory by running a stub on the core rather
+ * than reading the whole region back over the debug link. The RAM the stub and its table
+ * use and the core registers are saved beforehand and restored afterwards, so this can
+ * be used mid-session. Returns false without touching the target if this is not possible
+ * or the region is too small to be worth it, in which case the caller should fall back to
+ * reading the memory back.
+ */
+bool cortexm_crc32(target_s *const target, uint32_t *const result, const target_addr32_t base, const size_t len)
+{
+	if (target->halt_poll != cortexm_halt_poll || len < CORTEXM_CRC32_MIN_LENGTH)
+		return false;
+
+	/* Find a RAM region for the stub followed by its lookup table that the CRC range doesn't cover */
+	const size_t stub_size = (sizeof(cortexm_crc32_stub) + 3U) & ~3U;
+	const size_t work_size = stub_size + CORTEXM_CRC32_TABLE_SIZE;
+	const target_ram_s *ram = target->ram;
+	for (; ram; ram = ram->next) {
+		const target_addr32_t start = (ram->start + 3U) & ~3U;
+		if (start - ram->start + work_size <= ram->length && (base >= start + work_size || start >= base + len))
+			break;
+	}
+	if (!ram)
+		return false;
+	const target_addr32_t work_addr = (ram->start + 3U) & ~3U;
+
+	uint8_t *const saved_ram = malloc(work_size);
+	if (!saved_ram) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return false;
+	}
+	uint32_t saved_regs[CORTEXM_GENERAL_REG_COUNT + CORTEXM_TRUSTZONE_REG_COUNT + CORTEX_FLOAT_REG_COUNT];
+	target_regs_read(target, saved_regs);
+	if (target_mem32_read(target, saved_ram, work_addr, work_size) ||
+		target_mem32_write(target, work_addr, cortexm_crc32_stub, sizeof(cortexm_crc32_stub))) {
+		free(saved_ram);
+		return false;
+	}
+
+	uint32_t crc = 0xffffffffU;
+	volatile bool status = false;
+	TRY (EXCEPTION_ALL) {
+		status = cortexm_crc32_run(target, work_addr, stub_size, base, len, &crc);
+	}
+	CATCH () {
+	default:
+		/* Losing the target in the stub frees it, otherwise put back what we can before passing this on */
+		if (cortexm_target_listed(target)) {
+			target_mem32_write(target, work_addr, saved_ram, work_size);
+			target_regs_write(target, saved_regs);
+		}
+		free(saved_ram);
+		raise_exception(exception_frame.type, exception_frame.msg);
+	}
+
+	/* Put back everything the stub clobbered */
+	target_mem32_write(target, work_addr, saved_ram, work_size);
+	target_regs_write(target, saved_regs);
+	free(saved_ram);
+
+	if (status)
+		*result = crc;
+	return status && !target_check_error(target);
+}
+
 /*
  * The following routines implement hardware breakpoints and watchpoints.
  * The Flash Patch and Breakpoint (FPB) and Data Watch and Trace (DWT)
@@ -174,6 +174,9 @@ bool cortexm_attach(target_s *target);
 void cortexm_detach(target_s *target);
 void cortexm_halt_resume(target_s *target, bool step);
 bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3);
+bool cortexm_start_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3);
+bool cortexm_wait_stub(target_s *target, uint32_t timeout_ms);
+bool cortexm_crc32(target_s *target, uint32_t *result, target_addr32_t base, size_t len);
 int cortexm_mem_write_aligned(target_s *target, target_addr_t dest, const void *src, size_t len, align_e align);
 
 #endif /* TARGET_CORTEXM_H */
@@ -0,0 +1,77 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * CRC32 (MSB first, polynomial 0x04c11db7, no final XOR) as computed by
+ * bmd_crc32(), run on the target for the GDB compare-sections/qCRC request.
+ *
+ * On entry:
+ *   r0 = start address of the data
+ *   r1 = length of the data in bytes
+ *   r2 = running CRC (0xffffffff for the first block)
+ *   r3 = 1KiB of word aligned scratch RAM for the lookup table
+ * On exit r0 holds the updated CRC and the core halts on the bkpt #0 that ends the stub,
+ * so the host can tell where that is from the stub's size alone.
+ *
+ * Only ARMv6-M instructions are used so this runs on every Cortex-M core.
+ */
+
+	.syntax unified
+	.thumb
+	.text
+
+	cpsid i
+	ldr r7, poly
+	movs r4, #0
+table:
+	lsls r5, r4, #24
+	movs r6, #8
+bit:
+	lsls r5, r5, #1
+	bcc noxor
+	eors r5, r7
+noxor:
+	subs r6, #1
+	bne bit
+	lsls r6, r4, #2
+	str r5, [r3, r6]
+	adds r4, #1
+	lsrs r6, r4, #8
+	beq table
+
+	cmp r1, #0
+	beq done
+data:
+	ldrb r4, [r0]
+	adds r0, #1
+	lsrs r5, r2, #24
+	eors r4, r5
+	lsls r4, r4, #2
+	ldr r4, [r3, r4]
+	lsls r2, r2, #8
+	eors r2, r4
+	subs r1, #1
+	bne data
+done:
+	movs r0, r2
+	b finish
+
+	.balign 4
+poly:
+	.word 0x04c11db7
+finish:
+	bkpt #0
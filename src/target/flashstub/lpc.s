@@ -0,0 +1,110 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Batched IAP programming for the NXP LPC parts, run by lpc_flash_write().
+ *
+ * Rather than the debugger setting up and running every IAP call itself, this
+ * stays running and takes blocks through two mailbox slots in RAM in turn,
+ * calling the ROM's Prepare and Copy RAM to Flash commands for each. The
+ * debugger uploads the next block while the current one programs. Each 16 byte
+ * slot holds:
+ *   +0x0 length of the block in bytes, 0 while the slot is free
+ *   +0x4 Flash destination address
+ *   +0x8 source address of the data in RAM
+ *   +0xc sector the destination lies in
+ * The debugger posts a block by writing the length last, and we zero it to
+ * hand the slot back. A length of 0xffffffff tells us to stop.
+ *
+ * On entry:
+ *   r0 = address of the first slot, the mailbox must be 32 byte aligned
+ *   r1 = top of the stack to give the IAP routines
+ *   r2 = IAP entry point
+ *   r3 = Flash bank (ignored by the parts with only one)
+ * The last word of the stub is the CPU clock in kHz to give Copy RAM to Flash,
+ * which the debugger fills in when it loads the stub.
+ * On being told to stop the core halts on bkpt #1. If an IAP call fails we
+ * halt on bkpt #0 with its status code in r0 instead, leaving the slot with
+ * the failed block posted.
+ *
+ * Only ARMv6-M instructions are used so this runs on the Cortex-M0 parts too.
+ */
+
+	.syntax unified
+	.thumb
+	.text
+
+	mov sp, r1
+	/* The IAP command block at sp, its result block at sp + 20 */
+	sub sp, #40
+	movs r4, r0
+	movs r5, #1
+	orrs r2, r5
+	mov r8, r2
+	mov r9, r3
+wait:
+	ldr r5, [r4]
+	cmp r5, #0
+	beq wait
+	adds r6, r5, #1
+	beq stop
+	/* Prepare sector, sector, bank */
+	ldr r6, [r4, #12]
+	movs r7, #50
+	str r7, [sp]
+	str r6, [sp, #4]
+	str r6, [sp, #8]
+	mov r7, r9
+	str r7, [sp, #12]
+	bl iap
+	cmp r0, #0
+	bne fail
+	/* Copy RAM to Flash dest, src, length, CPU clock */
+	movs r7, #51
+	str r7, [sp]
+	ldr r7, [r4, #4]
+	str r7, [sp, #4]
+	ldr r7, [r4, #8]
+	str r7, [sp, #8]
+	str r5, [sp, #12]
+	ldr r7, cpu_clk_khz
+	str r7, [sp, #16]
+	bl iap
+	cmp r0, #0
+	bne fail
+	movs r7, #0
+	str r7, [r4]
+	movs r7, #16
+	eors r4, r7
+	b wait
+fail:
+	bkpt #0
+stop:
+	bkpt #1
+
+/* Call into the ROM with the command block, returning its status code in r0 */
+iap:
+	mov r6, lr
+	mov r0, sp
+	add r1, sp, #20
+	blx r8
+	ldr r0, [sp, #20]
+	bx r6
+
+	.balign 4
+cpu_clk_khz:
+	.word 0
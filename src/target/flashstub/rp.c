@@ -71,8 +71,23 @@ static gpio_qspi_s *const gpio_qspi = (gpio_qspi_s *)RP_GPIO_QSPI_BASE_ADDR;
 
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 
+/*
+ * The debugger hands us blocks through two of these mailbox slots in turn, so it can upload the
+ * next block while we program the current one. A slot is ours while its length is non-zero,
+ * and we hand it back by zeroing the length once the block is programmed.
+ */
+typedef struct rp_stub_slot {
+	volatile uint32_t length;
+	uint32_t dest;
+	const uint8_t *src;
+	uint32_t reserved;
+} rp_stub_slot_s;
+
+/* Length value the debugger posts to tell us there are no more blocks coming */
+#define RP_STUB_SLOT_STOP 0xffffffffU
+
 void __attribute__((naked, used, section(".entry")))
-rp_flash_write_stub(const uint16_t command, const uint32_t dest, const uint8_t *const src, const uint32_t length)
+rp_flash_write_stub(rp_stub_slot_s *const slots, const uint32_t page_size)
 {
 	/* Create a stack for our own sanity */
 	__asm__("ldr r4, =#0x20042000\n"
@@ -150,8 +165,7 @@ static void rp_spi_write(const uint32_t address, const uint8_t *const src, const
 	rp_spi_flash_deselect();
 }
 
-static void __attribute__((used, section(".entry")))
-rp_flash_write(const uint32_t dest, const uint8_t *const src, const size_t length, const uint32_t page_size)
+static void rp_flash_program(uint32_t dest, const uint8_t *src, const size_t length, const uint32_t page_size)
 {
 	for (size_t offset = 0; offset < length; offset += page_size) {
 		/* Try to write-enable the Flash */
@@ -165,3 +179,20 @@ rp_flash_write(const uint32_t dest, const uint8_t *const src, const size_t lengt
 			continue;
 	}
 }
+
+static void __attribute__((used, section(".entry")))
+rp_flash_write(rp_stub_slot_s *const slots, const uint32_t page_size)
+{
+	for (size_t slot = 0;; slot ^= 1U) {
+		/* Wait for the debugger to hand us the next block */
+		uint32_t length;
+		while ((length = slots[slot].length) == 0U)
+			continue;
+		if (length == RP_STUB_SLOT_STOP)
+			return;
+
+		rp_flash_program(slots[slot].dest, slots[slot].src, length, page_size);
+		/* Give the buffer back so the debugger can refill it */
+		slots[slot].length = 0U;
+	}
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Flash programming loop for the STM32F0/F1/F3 style FPEC and its clones.
+ *
+ * The stub is started once by stm32f1_flash_write() and then takes blocks
+ * through two mailbox slots in SRAM in turn, so the debugger can upload the
+ * next block while the core programs the current one. Each 16 byte slot holds:
+ *   +0x0 length of the block in bytes, 0 while the slot is free
+ *   +0x4 Flash destination address
+ *   +0x8 source address of the data in SRAM
+ *   +0xc FPEC register base of the bank to program, bit 0 set to program
+ *        words rather than half-words on parts that allow it
+ * The debugger posts a block by writing the length last, and we zero it to
+ * hand the slot back. A length of 0xffffffff tells us to stop.
+ *
+ * On entry:
+ *   r0 = address of the first slot, the mailbox must be 32 byte aligned
+ * The bank must already be unlocked. For each block we set FLASH_CR PG, wait
+ * out BSY after each write and clear PG again at the end.
+ * On being told to stop the core halts on bkpt #1. If a write sets PGERR or
+ * WRPRTERR we halt on bkpt #0 with the FLASH_SR error bits in r0 instead,
+ * leaving the slot with the failed block posted.
+ *
+ * Only ARMv6-M instructions are used so this runs on the Cortex-M0 parts too.
+ */
+
+	.syntax unified
+	.thumb
+	.text
+
+wait:
+	ldr r2, [r0]
+	cmp r2, #0
+	beq wait
+	adds r3, r2, #1
+	beq stop
+	ldr r3, [r0, #4]
+	adds r2, r3
+	ldr r4, [r0, #8]
+	ldr r5, [r0, #12]
+	movs r6, #1
+	ands r6, r5
+	bics r5, r6
+	movs r7, #1
+	str r7, [r5, #0x10]
+next:
+	cmp r3, r2
+	bhs block_done
+	cmp r6, #0
+	bne word
+	ldrh r7, [r4]
+	strh r7, [r3]
+	adds r3, #2
+	adds r4, #2
+	b busy
+word:
+	ldr r7, [r4]
+	str r7, [r3]
+	adds r3, #4
+	adds r4, #4
+busy:
+	ldr r7, [r5, #0x0c]
+	lsrs r1, r7, #1
+	bcs busy
+	movs r1, #0x14
+	ands r7, r1
+	beq next
+	movs r1, #0
+	str r1, [r5, #0x10]
+	movs r0, r7
+	bkpt #0
+block_done:
+	movs r7, #0
+	str r7, [r5, #0x10]
+	str r7, [r0]
+	movs r7, #16
+	eors r0, r7
+	b wait
+stop:
+	bkpt #1
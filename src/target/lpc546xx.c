@@ -274,9 +274,11 @@ static bool lpc546xx_cmd_write_sector(target_s *t, int argc, const char **argv)
 		for (uint32_t i = 0; i < sector_size; i++)
 			buf[i] = i & 0xffU;
 
-		const bool result = lpc_flash_write_magic_vect(t->flash, sector_addr, buf, sector_size);
+		/* This bypasses the Flash layer, so finish the write off ourselves, even if it failed, to stop the stub */
+		const bool written = lpc_flash_write_magic_vect(t->flash, sector_addr, buf, sector_size);
+		const bool done = t->flash->done(t->flash);
 		free(buf);
-		return result;
+		return written && done;
 	}
 	return true;
 }
@@ -28,6 +28,17 @@
 
 #include <stdarg.h>
 
+/* The batched IAP stub (see flashstub/lpc.s) sits at iap_ram, then come its two mailbox slots and a buffer each */
+#define LPC_STUB_MAILBOX(flash)     ALIGN((flash)->iap_ram + sizeof(lpc_flash_write_stub), 32U)
+#define LPC_STUB_SLOT_SIZE          16U
+#define LPC_STUB_BUFFER_BASE(flash) (LPC_STUB_MAILBOX(flash) + 2U * LPC_STUB_SLOT_SIZE)
+#define LPC_STUB_SLOT_STOP          0xffffffffU
+/* The stub's last word is the CPU clock to give Copy RAM to Flash, filled in when the stub is loaded */
+#define LPC_STUB_CPU_CLK(flash) ((flash)->iap_ram + sizeof(lpc_flash_write_stub) - 4U)
+#define LPC_STUB_TIMEOUT            5000U
+/* Stack kept free below iap_msp for the stub's IAP command block and the IAP routines (up to 128 bytes) */
+#define LPC_STUB_STACK_SIZE 192U
+
 typedef struct iap_config {
 	uint32_t command;
 	uint32_t params[4];
@@ -80,7 +91,12 @@ static const char *const iap_error[] = {
 };
 #endif
 
+static const uint16_t lpc_flash_write_stub[] = {
+#include "flashstub/lpc.stub"
+};
+
 static bool lpc_flash_write(target_flash_s *tf, target_addr_t dest, const void *src, size_t len);
+static bool lpc_flash_done(target_flash_s *tf);
 
 lpc_flash_s *lpc_add_flash(
 	target_s *const target, const target_addr_t addr, const size_t length, const size_t write_size)
@@ -96,6 +112,7 @@ lpc_flash_s *lpc_add_flash(
 	flash->length = length;
 	flash->erase = lpc_flash_erase;
 	flash->write = lpc_flash_write;
+	flash->done = lpc_flash_done;
 	flash->erased = 0xff;
 	flash->writesize = write_size;
 	target_add_flash(target, flash);
@@ -273,6 +290,149 @@ iap_status_e lpc_iap_call(lpc_flash_s *const flash, iap_result_s *const result,
 	return results.return_code;
 }
 
+/* A stub that stopped on a failed IAP call leaves the call's status code in r0 */
+static void lpc_stub_report(target_s *const target)
+{
+	uint32_t status = 0;
+	target_reg_read(target, 0U, &status, sizeof(status));
+/* This guard block deals with the fact iap_error is only defined when ENABLE_DEBUG is */
+#if ENABLE_DEBUG == 1
+	if (status < ARRAY_LENGTH(iap_error)) {
+		DEBUG_ERROR("%s: IAP failed, %s\n", __func__, iap_error[status]);
+		return;
+	}
+#endif
+	DEBUG_ERROR("%s: IAP failed, %" PRIu32 "\n", __func__, status);
+}
+
+/*
+ * Pick the largest block the IAP Copy RAM to Flash command takes that evenly divides a write
+ * and for which two buffers fit between the stub's mailbox and the stack. Returns 0 if none do.
+ */
+static size_t lpc_stub_block_size(const lpc_flash_s *const flash)
+{
+	static const size_t block_sizes[] = {4096U, 1024U, 512U, 256U};
+	const uint32_t buffers = LPC_STUB_BUFFER_BASE(flash);
+	if (flash->iap_msp < buffers + LPC_STUB_STACK_SIZE)
+		return 0U;
+	const size_t space = flash->iap_msp - LPC_STUB_STACK_SIZE - buffers;
+	for (size_t i = 0; i < ARRAY_LENGTH(block_sizes); ++i) {
+		if (block_sizes[i] <= flash->f.writesize && !(flash->f.writesize % block_sizes[i]) &&
+			2U * block_sizes[i] <= space)
+			return block_sizes[i];
+	}
+	return 0U;
+}
+
+/* Mark the stub stopped and put back the registers it was started over */
+static void lpc_stub_stopped(lpc_flash_s *const flash)
+{
+	flash->stub_running = false;
+	target_regs_write(flash->f.t, flash->stub_saved_regs);
+	free(flash->stub_saved_regs);
+	flash->stub_saved_regs = NULL;
+}
+
+static bool lpc_stub_start(lpc_flash_s *const flash)
+{
+	target_s *const target = flash->f.t;
+	/* Save the registers to restore once we're done, as lpc_iap_call() does for each call */
+	flash->stub_saved_regs = malloc(target->regs_size);
+	if (!flash->stub_saved_regs) { /* malloc failed: heap exhaustion */
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return false;
+	}
+	target_regs_read(target, flash->stub_saved_regs);
+
+	/* Start the stub off with both slots empty, it then runs until lpc_flash_done() stops it */
+	const target_addr32_t mailbox = LPC_STUB_MAILBOX(flash);
+	if (target_mem32_write(target, flash->iap_ram, lpc_flash_write_stub, sizeof(lpc_flash_write_stub)) ||
+		target_mem32_write32(target, LPC_STUB_CPU_CLK(flash), CPU_CLK_KHZ) ||
+		target_mem32_write32(target, mailbox, 0U) || target_mem32_write32(target, mailbox + LPC_STUB_SLOT_SIZE, 0U) ||
+		!cortexm_start_stub(target, flash->iap_ram, mailbox, flash->iap_msp, flash->iap_entry, flash->bank)) {
+		free(flash->stub_saved_regs);
+		flash->stub_saved_regs = NULL;
+		return false;
+	}
+	flash->stub_running = true;
+	flash->stub_slot = 0U;
+	return true;
+}
+
+/* Wait for the stub to hand back a mailbox slot, failing if it halts early or takes too long */
+static bool lpc_stub_wait_slot(lpc_flash_s *const flash, const target_addr32_t slot)
+{
+	target_s *const target = flash->f.t;
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, LPC_STUB_TIMEOUT);
+	while (target_mem32_read32(target, slot) != 0U) {
+		if (target_check_error(target))
+			return false;
+		/* The stub only stops by itself if an IAP call failed */
+		if (target_halt_poll(target, NULL) != TARGET_HALT_RUNNING) {
+			lpc_stub_report(target);
+			return false;
+		}
+		if (platform_timeout_is_expired(&timeout)) {
+			DEBUG_WARN("Flash stub hung\n");
+			target_halt_request(target);
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * Hand a write to the stub in blocks through its two mailbox slots, so we upload the next block
+ * into one slot's buffer while the IAP routines are still programming the other.
+ */
+static bool lpc_stub_write(lpc_flash_s *const flash, const target_addr_t dest, const uint8_t *const src,
+	const size_t len, const size_t block_size)
+{
+	target_s *const target = flash->f.t;
+	for (size_t offset = 0; offset < len; offset += block_size) {
+		/* Poke the WDT before each block, as lpc_iap_call() does before each call */
+		if (flash->wdt_kick)
+			flash->wdt_kick(target);
+
+		/* Wait for the stub to be done with the block we last loaded into this slot */
+		const target_addr32_t slot = LPC_STUB_MAILBOX(flash) + flash->stub_slot * LPC_STUB_SLOT_SIZE;
+		if (!lpc_stub_wait_slot(flash, slot)) {
+			lpc_stub_stopped(flash);
+			return false;
+		}
+
+		/* Load the block, where it goes and its sector, then post it by writing the length last */
+		const target_addr32_t buffer = LPC_STUB_BUFFER_BASE(flash) + flash->stub_slot * block_size;
+		const uint32_t request[3] = {dest + offset, buffer, lpc_sector_for_addr(flash, dest + offset)};
+		if (target_mem32_write(target, buffer, src + offset, block_size) ||
+			target_mem32_write(target, slot + 4U, request, sizeof(request)) ||
+			target_mem32_write32(target, slot, block_size))
+			return false;
+		flash->stub_slot ^= 1U;
+	}
+	return true;
+}
+
+static bool lpc_flash_done(target_flash_s *const tf)
+{
+	lpc_flash_s *const flash = (lpc_flash_s *)tf;
+	if (!flash->stub_running)
+		return true;
+	target_s *const target = tf->t;
+
+	/* The stub looks in the next slot once it finishes the last block, so tell it to stop there */
+	const target_addr32_t slot = LPC_STUB_MAILBOX(flash) + flash->stub_slot * LPC_STUB_SLOT_SIZE;
+	bool result = lpc_stub_wait_slot(flash, slot) && !target_mem32_write32(target, slot, LPC_STUB_SLOT_STOP);
+	/* It halts on bkpt #1 once stopped, anything else means the last block failed */
+	if (result && !cortexm_wait_stub(target, LPC_STUB_TIMEOUT)) {
+		lpc_stub_report(target);
+		result = false;
+	}
+	lpc_stub_stopped(flash);
+	return result;
+}
+
 #define LPX80X_SECTOR_SIZE 0x400U
 #define LPX80X_PAGE_SIZE   0x40U
 
@@ -319,6 +479,19 @@ bool lpc_flash_erase(target_flash_s *tf, target_addr_t addr, size_t len)
 static bool lpc_flash_write(target_flash_s *tf, target_addr_t dest, const void *src, size_t len)
 {
 	lpc_flash_s *f = (lpc_flash_s *)tf;
+	/* Only LPC80x has reserved pages!*/
+	const bool reserved_pages = f->reserved_pages && dest + len > tf->length - len;
+	/*
+	 * Unless RAM is too tight, let the batched IAP stub do the work: it avoids setting up and
+	 * running two IAP calls from here for every block
+	 */
+	const size_t block_size = reserved_pages ? 0U : lpc_stub_block_size(f);
+	if (block_size && !(len % block_size) && (f->stub_running || lpc_stub_start(f)))
+		return lpc_stub_write(f, dest, src, len, block_size);
+	/* The stub and lpc_iap_call() can't share the core, so make sure the stub is stopped */
+	if (!lpc_flash_done(tf))
+		return false;
+
 	/* Prepare... */
 	const uint32_t sector = lpc_sector_for_addr(f, dest);
 	if (lpc_iap_call(f, NULL, IAP_CMD_PREPARE, sector, sector, f->bank) != IAP_STATUS_CMD_SUCCESS) {
@@ -327,8 +500,7 @@ static bool lpc_flash_write(target_flash_s *tf, target_addr_t dest, const void *
 	}
 	const uint32_t bufaddr = ALIGN(f->iap_ram + sizeof(iap_frame_s), 4U);
 	target_mem32_write(f->f.t, bufaddr, src, len);
-	/* Only LPC80x has reserved pages!*/
-	if (!f->reserved_pages || dest + len <= tf->length - len) {
+	if (!reserved_pages) {
 		/*
 		 * Write payload to target ram,
 		 * set the destination address and program
@@ -86,6 +86,10 @@ typedef struct lpc_flash {
 	uint32_t iap_entry;
 	uint32_t iap_ram;
 	uint32_t iap_msp;
+	/* Batched IAP stub state, see lpc_flash_write() */
+	bool stub_running;
+	uint8_t stub_slot;
+	uint32_t *stub_saved_regs;
 } lpc_flash_s;
 
 lpc_flash_s *lpc_add_flash(target_s *target, target_addr_t addr, size_t length, size_t write_size);
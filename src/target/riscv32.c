@@ -45,6 +45,9 @@ typedef struct riscv32_regs {
 	uint32_t pc;
 } riscv32_regs_s;
 
+/* How many accesses to run in each abstractauto burst of abstract memory access */
+#define RV32_ABSTRACT_BURST 64U
+
 /* This defines a match trigger that's for an address or data location */
 #define RV32_MATCH_ADDR_DATA_TRIGGER 0x20000000U
 /* A dmode of 1 restricts the writability of the trigger to debug mode only */
@@ -117,7 +120,15 @@ static void riscv32_regs_read(target_s *const target, void *const data)
 	riscv_hart_s *const hart = riscv_hart_struct(target);
 	riscv32_regs_s *const regs = (riscv32_regs_s *)data;
 	const size_t gprs_count = hart->extensions & RV_ISA_EXT_EMBEDDED ? 16U : 32U;
-	/* Loop through reading out the GPRs */
+	/* If we can, read all the GPRs in one burst, having the register number post-increment */
+	const uint32_t burst_command = RV_DM_ABST_CMD_ACCESS_REG | RV_ABST_READ | RV_REG_XFER | RV_REG_ACCESS_32_BIT |
+		RV_ABST_REG_POST_INC | RV_GPR_BASE;
+	if ((hart->flags & RV_HART_FLAG_ABSTRACT_AUTO) && hart->access_width == 32U &&
+		riscv_abstract_read_burst(hart, burst_command, regs->gprs, gprs_count)) {
+		riscv_csr_read(hart, RV_DPC, &regs->pc);
+		return;
+	}
+	/* Otherwise loop through reading out the GPRs */
 	for (size_t gpr = 0; gpr < gprs_count; ++gpr) {
 		// TODO: handle when this fails..
 		riscv_csr_read(hart, RV_GPR_BASE + gpr, &regs->gprs[gpr]);
@@ -132,7 +143,15 @@ static void riscv32_regs_write(target_s *const target, const void *const data)
 	riscv_hart_s *const hart = riscv_hart_struct(target);
 	riscv32_regs_s *const regs = (riscv32_regs_s *)data;
 	const size_t gprs_count = hart->extensions & RV_ISA_EXT_EMBEDDED ? 16U : 32U;
-	/* Loop through writing out the GPRs, except for the first which is always 0 */
+	/* If we can, write all the GPRs in one burst, except for the first which is always 0 */
+	const uint32_t burst_command = RV_DM_ABST_CMD_ACCESS_REG | RV_ABST_WRITE | RV_REG_XFER | RV_REG_ACCESS_32_BIT |
+		RV_ABST_REG_POST_INC | (RV_GPR_BASE + 1U);
+	if ((hart->flags & RV_HART_FLAG_ABSTRACT_AUTO) && hart->access_width == 32U &&
+		riscv_abstract_write_burst(hart, burst_command, regs->gprs + 1U, gprs_count - 1U)) {
+		riscv_csr_write(hart, RV_DPC, &regs->pc);
+		return;
+	}
+	/* Otherwise loop through writing out the GPRs */
 	for (size_t gpr = 1; gpr < gprs_count; ++gpr) {
 		// TODO: handle when this fails..
 		riscv_csr_write(hart, RV_GPR_BASE + gpr, &regs->gprs[gpr]);
@@ -241,7 +260,24 @@ static void riscv32_abstract_mem_read(
 	if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA1, src))
 		return;
 	uint8_t *const data = (uint8_t *)dest;
-	for (size_t offset = 0; offset < len; offset += access_length) {
+	size_t offset = 0;
+	/* If we can, stream the data out in bursts, with each data0 read re-running the post-incrementing access */
+	if ((hart->flags & RV_HART_FLAG_ABSTRACT_AUTO) && access_length < len) {
+		uint32_t values[RV32_ABSTRACT_BURST];
+		while (offset < len) {
+			const size_t count = MIN((len - offset) >> access_width, RV32_ABSTRACT_BURST);
+			if (!riscv_abstract_read_burst(hart, command, values, count)) {
+				/* Drop back to one access at a time from the start of the failed burst */
+				if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA1, src + offset))
+					return;
+				break;
+			}
+			for (size_t idx = 0; idx < count; ++idx)
+				riscv32_unpack_data(data + offset + (idx << access_width), values[idx], access_width);
+			offset += count << access_width;
+		}
+	}
+	for (; offset < len; offset += access_length) {
 		/* Execute the read */
 		if (!riscv_dm_write(hart->dbg_module, RV_DM_ABST_COMMAND, command) || !riscv_command_wait_complete(hart))
 			return;
@@ -266,7 +302,24 @@ static void riscv32_abstract_mem_write(
 	if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA1, dest))
 		return;
 	const uint8_t *const data = (const uint8_t *)src;
-	for (size_t offset = 0; offset < len; offset += access_length) {
+	size_t offset = 0;
+	/* If we can, stream the data in in bursts, with each data0 write re-running the post-incrementing access */
+	if ((hart->flags & RV_HART_FLAG_ABSTRACT_AUTO) && access_length < len) {
+		uint32_t values[RV32_ABSTRACT_BURST];
+		while (offset < len) {
+			const size_t count = MIN((len - offset) >> access_width, RV32_ABSTRACT_BURST);
+			for (size_t idx = 0; idx < count; ++idx)
+				values[idx] = riscv32_pack_data(data + offset + (idx << access_width), access_width);
+			if (!riscv_abstract_write_burst(hart, command, values, count)) {
+				/* Drop back to one access at a time from the start of the failed burst */
+				if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA1, dest + offset))
+					return;
+				break;
+			}
+			offset += count << access_width;
+		}
+	}
+	for (; offset < len; offset += access_length) {
 		/* Pack the data to write into arg0 */
 		uint32_t value = riscv32_pack_data(data + offset, access_width);
 		if (!riscv_dm_write(hart->dbg_module, RV_DM_DATA0, value))
@@ -77,6 +77,11 @@
 #define RV_DM_ABST_STATUS_PROGBUFSIZE_MASK  0x1f000000U
 #define RV_DM_ABST_STATUS_PROGBUFSIZE_SHIFT 24U
 
+#if PC_HOSTED == 1
+/* Largest abstractauto burst to queue up as a single DMI batch */
+#define RV_ABSTRACT_BATCH_MAX 64U
+#endif
+
 #define RV_DM_SYSBUS_STATUS_ADDR_WIDTH_MASK 0x00000fe0U
 
 #define RV_CSR_FORCE_MASK   0xc000U
@@ -278,6 +283,7 @@ static riscv_debug_version_e riscv_dm_version(uint32_t status);
 static uint32_t riscv_hart_discover_isa(riscv_hart_s *hart);
 static void riscv_hart_discover_triggers(riscv_hart_s *hart);
 static void riscv_hart_memory_access_type(riscv_hart_s *hart);
+static void riscv_hart_discover_abstract_auto(riscv_hart_s *hart);
 
 static const char *riscv_target_description(target_s *target);
 
@@ -439,6 +445,7 @@ static bool riscv_hart_init(riscv_hart_s *const hart)
 	hart->extensions = isa & RV_ISA_EXTENSIONS_MASK;
 	/* Figure out if the target needs us to use sysbus or not for memory access */
 	riscv_hart_memory_access_type(hart);
+	riscv_hart_discover_abstract_auto(hart);
 	/* Then read out the ID registers */
 	riscv_hart_read_ids(hart);
 
@@ -666,6 +673,98 @@ bool riscv_command_wait_complete(riscv_hart_s *const hart)
 	return hart->status == RISCV_HART_NO_ERROR;
 }
 
+#if PC_HOSTED == 1
+/*
+ * Queue a whole burst up to run as a single batch of DMI accesses. Unlike the access-at-a-time path
+ * the first access isn't checked before the rest are issued, but while cmderr is set the DM starts
+ * no further commands, so a failure anywhere still shows up in the one check made at the end.
+ */
+static bool riscv_abstract_read_batch(
+	riscv_hart_s *const hart, const uint32_t command, uint32_t *const values, const size_t count)
+{
+	riscv_dm_s *const dbg_module = hart->dbg_module;
+	const uint32_t base = dbg_module->base;
+	riscv_dmi_batch_access_s accesses[RV_ABSTRACT_BATCH_MAX + 5U];
+	size_t idx = 0U;
+	accesses[idx++] = (riscv_dmi_batch_access_s){RISCV_DMI_BATCH_WRITE, base + RV_DM_ABST_COMMAND, command, NULL};
+	accesses[idx++] = (riscv_dmi_batch_access_s){
+		RISCV_DMI_BATCH_WAIT_CLEAR, base + RV_DM_ABST_CTRLSTATUS, RV_DM_ABST_STATUS_BUSY, NULL};
+	accesses[idx++] =
+		(riscv_dmi_batch_access_s){RISCV_DMI_BATCH_WRITE, base + RV_DM_ABST_AUTO, RV_ABST_AUTO_DATA0, NULL};
+	for (size_t value = 0; value + 1U < count; ++value)
+		accesses[idx++] = (riscv_dmi_batch_access_s){RISCV_DMI_BATCH_READ, base + RV_DM_DATA0, 0U, &values[value]};
+	accesses[idx++] = (riscv_dmi_batch_access_s){RISCV_DMI_BATCH_WRITE, base + RV_DM_ABST_AUTO, 0U, NULL};
+	accesses[idx++] = (riscv_dmi_batch_access_s){RISCV_DMI_BATCH_READ, base + RV_DM_DATA0, 0U, &values[count - 1U]};
+	return dbg_module->dmi_bus->batch(dbg_module->dmi_bus, accesses, idx) && riscv_command_wait_complete(hart);
+}
+
+static bool riscv_abstract_write_batch(
+	riscv_hart_s *const hart, const uint32_t command, const uint32_t *const values, const size_t count)
+{
+	riscv_dm_s *const dbg_module = hart->dbg_module;
+	const uint32_t base = dbg_module->base;
+	riscv_dmi_batch_access_s accesses[RV_ABSTRACT_BATCH_MAX + 4U];
+	size_t idx = 0U;
+	accesses[idx++] = (riscv_dmi_batch_access_s){RISCV_DMI_BATCH_WRITE, base + RV_DM_DATA0, values[0], NULL};
+	accesses[idx++] = (riscv_dmi_batch_access_s){RISCV_DMI_BATCH_WRITE, base + RV_DM_ABST_COMMAND, command, NULL};
+	accesses[idx++] = (riscv_dmi_batch_access_s){
+		RISCV_DMI_BATCH_WAIT_CLEAR, base + RV_DM_ABST_CTRLSTATUS, RV_DM_ABST_STATUS_BUSY, NULL};
+	accesses[idx++] =
+		(riscv_dmi_batch_access_s){RISCV_DMI_BATCH_WRITE, base + RV_DM_ABST_AUTO, RV_ABST_AUTO_DATA0, NULL};
+	for (size_t value = 1U; value < count; ++value)
+		accesses[idx++] = (riscv_dmi_batch_access_s){RISCV_DMI_BATCH_WRITE, base + RV_DM_DATA0, values[value], NULL};
+	accesses[idx++] = (riscv_dmi_batch_access_s){RISCV_DMI_BATCH_WRITE, base + RV_DM_ABST_AUTO, 0U, NULL};
+	return dbg_module->dmi_bus->batch(dbg_module->dmi_bus, accesses, idx) && riscv_command_wait_complete(hart);
+}
+#endif
+
+bool riscv_abstract_read_burst(
+	riscv_hart_s *const hart, const uint32_t command, uint32_t *const values, const size_t count)
+{
+	riscv_dm_s *const dbg_module = hart->dbg_module;
+#if PC_HOSTED == 1
+	/* If the adaptor can take a batch of DMI accesses, hand it the whole burst in one go */
+	if (dbg_module->dmi_bus->batch && count > 1U && count <= RV_ABSTRACT_BATCH_MAX)
+		return riscv_abstract_read_batch(hart, command, values, count);
+#endif
+	/* Run the first access by hand */
+	if (!riscv_dm_write(dbg_module, RV_DM_ABST_COMMAND, command) || !riscv_command_wait_complete(hart))
+		return false;
+	if (count == 1U)
+		return riscv_dm_read(dbg_module, RV_DM_DATA0, values);
+	/* With autoexec on, each data0 read collects one result and kicks off the next access */
+	bool result = riscv_dm_write(dbg_module, RV_DM_ABST_AUTO, RV_ABST_AUTO_DATA0);
+	for (size_t idx = 0; result && idx + 1U < count; ++idx)
+		result = riscv_dm_read(dbg_module, RV_DM_DATA0, &values[idx]);
+	/* Turn autoexec back off before collecting the final result so that read doesn't start another access */
+	result &= riscv_dm_write(dbg_module, RV_DM_ABST_AUTO, 0U);
+	result = result && riscv_dm_read(dbg_module, RV_DM_DATA0, &values[count - 1U]);
+	/* A failed access, or data0 being read before an access had finished, shows up as a command error */
+	return result && riscv_command_wait_complete(hart);
+}
+
+bool riscv_abstract_write_burst(
+	riscv_hart_s *const hart, const uint32_t command, const uint32_t *const values, const size_t count)
+{
+	riscv_dm_s *const dbg_module = hart->dbg_module;
+#if PC_HOSTED == 1
+	if (dbg_module->dmi_bus->batch && count > 1U && count <= RV_ABSTRACT_BATCH_MAX)
+		return riscv_abstract_write_batch(hart, command, values, count);
+#endif
+	/* Run the first access by hand */
+	if (!riscv_dm_write(dbg_module, RV_DM_DATA0, values[0]) ||
+		!riscv_dm_write(dbg_module, RV_DM_ABST_COMMAND, command) || !riscv_command_wait_complete(hart))
+		return false;
+	if (count == 1U)
+		return true;
+	/* With autoexec on, each data0 write supplies the value for, and kicks off, the next access */
+	bool result = riscv_dm_write(dbg_module, RV_DM_ABST_AUTO, RV_ABST_AUTO_DATA0);
+	for (size_t idx = 1U; result && idx < count; ++idx)
+		result = riscv_dm_write(dbg_module, RV_DM_DATA0, values[idx]);
+	result &= riscv_dm_write(dbg_module, RV_DM_ABST_AUTO, 0U);
+	return result && riscv_command_wait_complete(hart);
+}
+
 static bool riscv_csr_read_data(riscv_hart_s *const hart, void *const data, const uint8_t access_width)
 {
 	uint32_t *const value = (uint32_t *)data;
@@ -903,6 +1002,18 @@ static void riscv_hart_memory_access_type(riscv_hart_s *const hart)
 	(void)riscv_dm_write(hart->dbg_module, RV_DM_SYSBUS_CTRLSTATUS, 0x00407000U);
 }
 
+static void riscv_hart_discover_abstract_auto(riscv_hart_s *const hart)
+{
+	/* abstractauto is optional, and an implementation without it ignores writes to the register */
+	uint32_t auto_exec = 0;
+	if (riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, RV_ABST_AUTO_DATA0) &&
+		riscv_dm_read(hart->dbg_module, RV_DM_ABST_AUTO, &auto_exec) && (auto_exec & RV_ABST_AUTO_DATA0))
+		hart->flags |= RV_HART_FLAG_ABSTRACT_AUTO;
+	(void)riscv_dm_write(hart->dbg_module, RV_DM_ABST_AUTO, 0U);
+	DEBUG_INFO("Hart %s abstract command auto-execution\n",
+		hart->flags & RV_HART_FLAG_ABSTRACT_AUTO ? "supports" : "does not support");
+}
+
 riscv_match_size_e riscv_breakwatch_match_size(const size_t size)
 {
 	switch (size) {
@@ -95,9 +95,27 @@ typedef enum riscv_match_size {
 #define RV_HART_FLAG_MEMORY_ABSTRACT    (0U << 4U)
 #define RV_HART_FLAG_MEMORY_SYSBUS      (1U << 4U)
 #define RV_HART_FLAG_DATA_GPR_ONLY      (1U << 5U) /* Hart supports Abstract Data commands for GPRs only */
+#define RV_HART_FLAG_ABSTRACT_AUTO      (1U << 6U) /* DM supports re-running abstract commands on data0 access */
 
 typedef struct riscv_dmi riscv_dmi_s;
 
+#if PC_HOSTED == 1
+typedef enum riscv_dmi_batch_op {
+	RISCV_DMI_BATCH_WRITE,
+	RISCV_DMI_BATCH_READ,
+	/* Read the register until all the bits in value are clear, such as to wait out abstractcs.busy */
+	RISCV_DMI_BATCH_WAIT_CLEAR,
+} riscv_dmi_batch_op_e;
+
+/* One DMI register access in a batch, address being the full DMI address rather than a DM-relative one */
+typedef struct riscv_dmi_batch_access {
+	riscv_dmi_batch_op_e op;
+	uint32_t address;
+	uint32_t value;
+	uint32_t *result;
+} riscv_dmi_batch_access_s;
+#endif
+
 /* This structure represents a version-agnostic Debug Module Interface on a RISC-V device */
 struct riscv_dmi {
 	uint32_t ref_count;
@@ -114,6 +132,10 @@ struct riscv_dmi {
 	void (*quiesce)(target_s *target);
 	bool (*read)(riscv_dmi_s *dmi, uint32_t address, uint32_t *value);
 	bool (*write)(riscv_dmi_s *dmi, uint32_t address, uint32_t value);
+#if PC_HOSTED == 1
+	/* Run a sequence of DMI accesses in as few adaptor transactions as possible */
+	bool (*batch)(riscv_dmi_s *dmi, const riscv_dmi_batch_access_s *accesses, size_t count);
+#endif
 };
 
 /* This structure represent a DMI bus that is accessed via an ADI AP */
@@ -162,6 +184,7 @@ typedef struct riscv_hart {
 #define RV_DM_DATA3             0x07U
 #define RV_DM_ABST_CTRLSTATUS   0x16U
 #define RV_DM_ABST_COMMAND      0x17U
+#define RV_DM_ABST_AUTO         0x18U
 #define RV_DM_SYSBUS_CTRLSTATUS 0x38U
 #define RV_DM_SYSBUS_ADDR0      0x39U
 #define RV_DM_SYSBUS_ADDR1      0x3aU
@@ -175,6 +198,7 @@ typedef struct riscv_hart {
 #define RV_ABST_WRITE         (1U << 16U)
 #define RV_REG_XFER           (1U << 17U)
 #define RV_ABST_POSTEXEC      (1U << 18U)
+#define RV_ABST_REG_POST_INC  (1U << 19U)
 #define RV_REG_ACCESS_32_BIT  (2U << 20U)
 #define RV_REG_ACCESS_64_BIT  (3U << 20U)
 #define RV_REG_ACCESS_128_BIT (4U << 20U)
@@ -188,6 +212,9 @@ typedef struct riscv_hart {
 #define RV_ABST_MEM_ADDR_POST_INC 0x00080000U
 #define RV_ABST_MEM_ACCESS_SHIFT  20U
 
+/* abstractauto autoexecdata bit making every access to data0 re-run the last abstract command */
+#define RV_ABST_AUTO_DATA0 (1U << 0U)
+
 #define RV_SYSBUS_MEM_ADDR_POST_INC 0x00010000U
 #define RV_SYSBUS_MEM_READ_ON_ADDR  0x00100000U
 #define RV_SYSBUS_MEM_READ_ON_DATA  0x00008000U
@@ -252,6 +279,13 @@ void bmda_riscv_jtag_dtm_init(riscv_dmi_s *dmi);
 bool riscv_dm_read(riscv_dm_s *dbg_module, uint8_t address, uint32_t *value);
 bool riscv_dm_write(riscv_dm_s *dbg_module, uint8_t address, uint32_t value);
 bool riscv_command_wait_complete(riscv_hart_s *hart);
+/*
+ * Run a post-incrementing abstract command count times using abstractauto, collecting or supplying
+ * data0 for each run. These return false if any run failed, leaving the caller to fall back to
+ * issuing the command one run at a time.
+ */
+bool riscv_abstract_read_burst(riscv_hart_s *hart, uint32_t command, uint32_t *values, size_t count);
+bool riscv_abstract_write_burst(riscv_hart_s *hart, uint32_t command, const uint32_t *values, size_t count);
 bool riscv_csr_read(riscv_hart_s *hart, uint16_t reg, void *data);
 bool riscv_csr_write(riscv_hart_s *hart, uint16_t reg, const void *data);
 riscv_match_size_e riscv_breakwatch_match_size(size_t size);
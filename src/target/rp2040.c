@@ -60,6 +60,11 @@
 #define RP_SRAM_BASE          0x20000000U
 #define RP_SRAM_SIZE          0x42000U
 #define RP_STUB_BUFFER_BASE   (RP_SRAM_BASE + 0x1000)
+/* The stub's two mailbox slots (see flashstub/rp.c) live in SRAM4, below the stub's stack */
+#define RP_STUB_MAILBOX       (RP_SRAM_BASE + 0x40000U)
+#define RP_STUB_SLOT_SIZE     16U
+#define RP_STUB_SLOT_STOP     0xffffffffU
+#define RP_STUB_TIMEOUT       5000U
 
 #define RP_REG_ACCESS_NORMAL              0x0000U
 #define RP_REG_ACCESS_WRITE_XOR           0x1000U
@@ -170,6 +175,8 @@ typedef struct rp_priv {
 	uint32_t ctrl0;
 	uint32_t ctrl1;
 	uint32_t xpi_ctrl0;
+	bool stub_running;
+	uint8_t stub_slot;
 } rp_priv_s;
 
 static bool rp_cmd_erase_sector(target_s *target, int argc, const char **argv);
@@ -192,6 +199,7 @@ static void rp_spi_restore(target_s *target);
 static bool rp_flash_prepare(target_s *target);
 static bool rp_flash_resume(target_s *target);
 static bool rp_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t length);
+static bool rp_flash_done(target_flash_s *flash);
 static void rp_spi_read(target_s *target, uint16_t command, target_addr32_t address, void *buffer, size_t length);
 static void rp_spi_run_command(target_s *target, uint16_t command, target_addr32_t address);
 static uint32_t rp_get_flash_length(target_s *target);
@@ -215,6 +223,7 @@ static void rp_add_flash(target_s *target)
 	spi_flash_s *flash = bmp_spi_add_flash(
 		target, RP_XIP_FLASH_BASE, rp_get_flash_length(target), rp_spi_read, NULL, rp_spi_run_command);
 	flash->flash.write = rp_flash_write;
+	flash->flash.done = rp_flash_done;
 
 	rp_spi_restore(target);
 	if (por_state)
@@ -349,16 +358,74 @@ static bool rp_flash_resume(target_s *const target)
 	return true;
 }
 
+/* Wait for the stub to hand back a mailbox slot, failing if it halts early or takes too long */
+static bool rp_stub_wait_slot(target_s *const target, const target_addr32_t slot)
+{
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, RP_STUB_TIMEOUT);
+	while (target_mem32_read32(target, slot) != 0U) {
+		/* The stub only stops by itself if it failed to program a block */
+		if (target_check_error(target) || target_halt_poll(target, NULL) != TARGET_HALT_RUNNING)
+			return false;
+		if (platform_timeout_is_expired(&timeout)) {
+			DEBUG_WARN("Flash stub hung\n");
+			target_halt_request(target);
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * The stub stays running across blocks and takes them through two mailbox slots in turn, so
+ * we upload the next block into one slot's buffer while it is still programming the other.
+ */
 static bool rp_flash_write(
 	target_flash_s *const flash, const target_addr_t dest, const void *const src, const size_t length)
 {
 	target_s *const target = flash->t;
+	rp_priv_s *const priv = (rp_priv_s *)target->target_storage;
 	const spi_flash_s *const spi_flash = (spi_flash_s *)flash;
-	/* Load the next block of data and run the stub */
-	if (target_mem32_write(target, RP_STUB_BUFFER_BASE, src, length))
+	if (!priv->stub_running) {
+		/* Start the stub off with both slots empty, it then runs until rp_flash_done() stops it */
+		if (target_mem32_write32(target, RP_STUB_MAILBOX, 0U) ||
+			target_mem32_write32(target, RP_STUB_MAILBOX + RP_STUB_SLOT_SIZE, 0U) ||
+			!cortexm_start_stub(target, RP_SRAM_BASE, RP_STUB_MAILBOX, spi_flash->page_size, 0U, 0U))
+			return false;
+		priv->stub_running = true;
+		priv->stub_slot = 0U;
+	}
+
+	/* Wait for the stub to be done with the block we last loaded into this slot */
+	const target_addr32_t slot = RP_STUB_MAILBOX + priv->stub_slot * RP_STUB_SLOT_SIZE;
+	if (!rp_stub_wait_slot(target, slot)) {
+		priv->stub_running = false;
+		return false;
+	}
+
+	/* Load the block and its destination, then post it by writing the length last */
+	const target_addr32_t buffer = RP_STUB_BUFFER_BASE + priv->stub_slot * flash->writesize;
+	const uint32_t request[2] = {dest - flash->start, buffer};
+	if (target_mem32_write(target, buffer, src, length) ||
+		target_mem32_write(target, slot + 4U, request, sizeof(request)) || target_mem32_write32(target, slot, length))
+		return false;
+	priv->stub_slot ^= 1U;
+	return true;
+}
+
+static bool rp_flash_done(target_flash_s *const flash)
+{
+	target_s *const target = flash->t;
+	rp_priv_s *const priv = (rp_priv_s *)target->target_storage;
+	if (!priv->stub_running)
+		return true;
+	priv->stub_running = false;
+
+	/* The stub looks in the next slot once it finishes the last block, so tell it to stop there */
+	const target_addr32_t slot = RP_STUB_MAILBOX + priv->stub_slot * RP_STUB_SLOT_SIZE;
+	if (!rp_stub_wait_slot(target, slot) || target_mem32_write32(target, slot, RP_STUB_SLOT_STOP))
 		return false;
-	return cortexm_run_stub(
-		target, RP_SRAM_BASE, dest - flash->start, RP_STUB_BUFFER_BASE, length, spi_flash->page_size);
+	return cortexm_wait_stub(target, RP_STUB_TIMEOUT);
 }
 
 static void rp_spi_chip_select(target_s *const target, const uint32_t state)
@@ -148,11 +148,30 @@
 
 #define STM32F1_TOPT_32BIT_WRITES (1U << 8U)
 
+/* The Flash stub's two mailbox slots (see flashstub/stm32f1.s) follow it, then a buffer per slot */
+#define STM32F1_STUB_MAILBOX     ALIGN(STM32F1_SRAM_BASE + sizeof(stm32f1_flash_write_stub), 32U)
+#define STM32F1_STUB_SLOT_SIZE   16U
+#define STM32F1_STUB_BUFFER_BASE (STM32F1_STUB_MAILBOX + 2U * STM32F1_STUB_SLOT_SIZE)
+#define STM32F1_STUB_SLOT_STOP   0xffffffffU
+#define STM32F1_STUB_TIMEOUT     5000U
+/* Slot reads between checks on whether the stub has stopped, which it only does if a write failed */
+#define STM32F1_STUB_HALT_POLL_READS 16U
+/* Bit 0 of a slot's FPEC base asks the stub to program words rather than half-words */
+#define STM32F1_STUB_WORD_WRITES 1U
+
 typedef struct stm32f1_priv {
 	target_addr32_t dbgmcu_config_taddr;
 	uint32_t dbgmcu_config;
+	bool stub_running;
+	uint8_t stub_slot;
+	/* How long the host slept through the last wait for a slot, in ms */
+	uint16_t stub_wait_ms;
 } stm32f1_priv_s;
 
+static const uint16_t stm32f1_flash_write_stub[] = {
+#include "flashstub/stm32f1.stub"
+};
+
 static bool stm32f1_cmd_option(target_s *target, int argc, const char **argv);
 static bool stm32f1_cmd_uid(target_s *target, int argc, const char **argv);
 
@@ -166,6 +185,7 @@ static bool stm32f1_attach(target_s *target);
 static void stm32f1_detach(target_s *target);
 static bool stm32f1_flash_erase(target_flash_s *flash, target_addr_t addr, size_t len);
 static bool stm32f1_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
+static bool stm32f1_flash_done(target_flash_s *flash);
 static bool stm32f1_mass_erase(target_s *target);
 
 static void stm32f1_add_flash(target_s *target, uint32_t addr, size_t length, size_t erasesize)
@@ -182,6 +202,7 @@ static void stm32f1_add_flash(target_s *target, uint32_t addr, size_t length, si
 	flash->writesize = 1024U;
 	flash->erase = stm32f1_flash_erase;
 	flash->write = stm32f1_flash_write;
+	flash->done = stm32f1_flash_done;
 	flash->erased = 0xff;
 	target_add_flash(target, flash);
 }
@@ -860,52 +881,184 @@ static size_t stm32f1_bank1_length(target_addr_t addr, size_t len)
 	return len;
 }
 
-static bool stm32f1_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len)
+static bool stm32f1_is_gd32vf103(const target_s *const target)
 {
-	target_s *target = flash->t;
-	const size_t offset = stm32f1_bank1_length(dest, len);
-	DEBUG_TARGET("%s: at %08" PRIx32 " for %zu bytes\n", __func__, dest, len);
+	return target->designer_code == JEP106_MANUFACTURER_RV_GIGADEVICE && target->cpuid == 0x80000022U;
+}
 
-	/* Allow wider writes on Gigadevices and Arterytek */
-	const align_e psize = (target->target_options & STM32F1_TOPT_32BIT_WRITES) ? ALIGN_32BIT : ALIGN_16BIT;
+/* The stub needs a Cortex-M core and room at the start of SRAM for itself, its mailbox and two blocks */
+static bool stm32f1_flash_stub_usable(const target_flash_s *const flash)
+{
+	const target_s *const target = flash->t;
+	if (stm32f1_is_gd32vf103(target))
+		return false;
+	for (const target_ram_s *ram = target->ram; ram; ram = ram->next) {
+		if (ram->start == STM32F1_SRAM_BASE)
+			return STM32F1_STUB_BUFFER_BASE + 2U * flash->writesize <= ram->start + ram->length;
+	}
+	return false;
+}
 
-	/* Start by writing any bank 1 data */
-	if (offset) {
-		stm32f1_flash_clear_eop(target, FLASH_BANK1_OFFSET);
+/* A stub that stopped on a failed write leaves FLASH_SR's error bits in r0 */
+static void stm32f1_flash_stub_report(target_s *const target)
+{
+	uint32_t status = 0;
+	target_reg_read(target, 0U, &status, sizeof(status));
+	if (status && !(status & ~SR_ERROR_MASK))
+		DEBUG_ERROR("stm32f1 flash error 0x%" PRIx32 "\n", status);
+}
 
-		target_mem32_write32(target, FLASH_CR, FLASH_CR_PG);
-		/* Use the target API instead of a direct Cortex-M call for GD32VF103 parts */
-		if (target->designer_code == JEP106_MANUFACTURER_RV_GIGADEVICE && target->cpuid == 0x80000022U)
-			target_mem32_write(target, dest, src, offset);
-		else
-			cortexm_mem_write_aligned(target, dest, src, offset, psize);
+/* Wait for the stub to hand back a mailbox slot, failing if it halts early or takes too long */
+static bool stm32f1_stub_wait_slot(target_s *const target, const target_addr32_t slot)
+{
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, STM32F1_STUB_TIMEOUT);
+#if PC_HOSTED == 1
+	/*
+	 * Each block takes the core much the same few ms to program, so rather than spend them on back
+	 * to back round trips to the probe, sleep off most of what the last wait took before reading the
+	 * slot, then poll each ms from there. A slot that's already free on the first read takes a ms
+	 * off the next sleep, so this settles on reading each slot about twice.
+	 */
+	stm32f1_priv_s *const priv = (stm32f1_priv_s *)target->target_storage;
+	uint16_t wait_ms = priv->stub_wait_ms > 1U ? priv->stub_wait_ms - 1U : 0U;
+	platform_delay(wait_ms);
+#endif
+	for (uint32_t reads = 1U; target_mem32_read32(target, slot) != 0U; ++reads) {
+		const bool expired = platform_timeout_is_expired(&timeout);
+		if (reads % STM32F1_STUB_HALT_POLL_READS == 0U || expired) {
+			if (target_check_error(target))
+				return false;
+			if (target_halt_poll(target, NULL) != TARGET_HALT_RUNNING) {
+				stm32f1_flash_stub_report(target);
+				return false;
+			}
+		}
+		if (expired) {
+			DEBUG_WARN("Flash stub hung\n");
+			target_halt_request(target);
+			return false;
+		}
+#if PC_HOSTED == 1
+		platform_delay(1U);
+		++wait_ms;
+#endif
+	}
+#if PC_HOSTED == 1
+	priv->stub_wait_ms = wait_ms;
+#endif
+	return !target_check_error(target);
+}
 
-		/* Wait for completion or an error */
-		if (!stm32f1_flash_busy_wait(target, FLASH_BANK1_OFFSET, NULL))
+/*
+ * Hand a block to the stub, starting it first if need be. It stays running across blocks and
+ * takes them through two mailbox slots in turn, so we upload the next block into one slot's
+ * buffer while the core is still programming the other.
+ */
+static bool stm32f1_flash_stub_write(target_flash_s *const flash, const uint32_t bank_offset,
+	const target_addr_t dest, const void *const src, const size_t len)
+{
+	target_s *const target = flash->t;
+	stm32f1_priv_s *const priv = (stm32f1_priv_s *)target->target_storage;
+	if (!priv->stub_running) {
+		/* Clear down any stale status as the stub only looks at the error bits */
+		stm32f1_flash_clear_eop(target, FLASH_BANK1_OFFSET);
+		if (stm32f1_is_dual_bank(target->part_id))
+			stm32f1_flash_clear_eop(target, FLASH_BANK2_OFFSET);
+		/* Start the stub off with both slots empty, it then runs until stm32f1_flash_done() stops it */
+		if (target_mem32_write(target, STM32F1_SRAM_BASE, stm32f1_flash_write_stub, sizeof(stm32f1_flash_write_stub)) ||
+			target_mem32_write32(target, STM32F1_STUB_MAILBOX, 0U) ||
+			target_mem32_write32(target, STM32F1_STUB_MAILBOX + STM32F1_STUB_SLOT_SIZE, 0U) ||
+			!cortexm_start_stub(target, STM32F1_SRAM_BASE, STM32F1_STUB_MAILBOX, 0U, 0U, 0U))
 			return false;
+		priv->stub_running = true;
+		priv->stub_slot = 0U;
+		priv->stub_wait_ms = 0U;
 	}
 
+	/* Wait for the stub to be done with the block we last loaded into this slot */
+	const target_addr32_t slot = STM32F1_STUB_MAILBOX + priv->stub_slot * STM32F1_STUB_SLOT_SIZE;
+	if (!stm32f1_stub_wait_slot(target, slot)) {
+		priv->stub_running = false;
+		return false;
+	}
+
+	/* Load the block, where it goes and how, then post it by writing the length last */
+	const target_addr32_t buffer = STM32F1_STUB_BUFFER_BASE + priv->stub_slot * flash->writesize;
+	const uint32_t request[3] = {
+		dest,
+		buffer,
+		(FPEC_BASE + bank_offset) |
+			((target->target_options & STM32F1_TOPT_32BIT_WRITES) ? STM32F1_STUB_WORD_WRITES : 0U),
+	};
+	if (target_mem32_write(target, buffer, src, len) ||
+		target_mem32_write(target, slot + 4U, request, sizeof(request)) || target_mem32_write32(target, slot, len))
+		return false;
+	priv->stub_slot ^= 1U;
+	return true;
+}
+
+static bool stm32f1_flash_write_bank(target_flash_s *const flash, const uint32_t bank_offset,
+	const target_addr_t dest, const void *const src, const size_t len)
+{
+	if (stm32f1_flash_stub_usable(flash))
+		return stm32f1_flash_stub_write(flash, bank_offset, dest, src, len);
+
+	target_s *const target = flash->t;
+	stm32f1_flash_clear_eop(target, bank_offset);
+	target_mem32_write32(target, FLASH_CR + bank_offset, FLASH_CR_PG);
+	/* Use the target API instead of a direct Cortex-M call for GD32VF103 parts */
+	if (stm32f1_is_gd32vf103(target))
+		target_mem32_write(target, dest, src, len);
+	else {
+		/* Allow wider writes on Gigadevices and Arterytek */
+		const align_e psize = (target->target_options & STM32F1_TOPT_32BIT_WRITES) ? ALIGN_32BIT : ALIGN_16BIT;
+		cortexm_mem_write_aligned(target, dest, src, len, psize);
+	}
+
+	/* Wait for completion or an error */
+	return stm32f1_flash_busy_wait(target, bank_offset, NULL);
+}
+
+static bool stm32f1_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len)
+{
+	target_s *target = flash->t;
+	const size_t offset = stm32f1_bank1_length(dest, len);
+	DEBUG_TARGET("%s: at %08" PRIx32 " for %zu bytes\n", __func__, dest, len);
+
+	/* Start by writing any bank 1 data */
+	if (offset && !stm32f1_flash_write_bank(flash, FLASH_BANK1_OFFSET, dest, src, offset))
+		return false;
+
 	/* If there's anything to write left over and we're on a part with a second bank, write to bank 2 */
 	const size_t remainder = len - offset;
 	if (stm32f1_is_dual_bank(target->part_id) && remainder) {
 		const uint8_t *data = src;
-		stm32f1_flash_clear_eop(target, FLASH_BANK2_OFFSET);
-
-		target_mem32_write32(target, FLASH_CR + FLASH_BANK2_OFFSET, FLASH_CR_PG);
-		/* Use the target API instead of a direct Cortex-M call for GD32VF103 parts */
-		if (target->designer_code == JEP106_MANUFACTURER_RV_GIGADEVICE && target->cpuid == 0x80000022U)
-			target_mem32_write(target, dest + offset, data + offset, remainder);
-		else
-			cortexm_mem_write_aligned(target, dest + offset, data + offset, remainder, psize);
-
-		/* Wait for completion or an error */
-		if (!stm32f1_flash_busy_wait(target, FLASH_BANK2_OFFSET, NULL))
-			return false;
+		return stm32f1_flash_write_bank(flash, FLASH_BANK2_OFFSET, dest + offset, data + offset, remainder);
 	}
 
 	return true;
 }
 
+static bool stm32f1_flash_done(target_flash_s *const flash)
+{
+	target_s *const target = flash->t;
+	stm32f1_priv_s *const priv = (stm32f1_priv_s *)target->target_storage;
+	if (!priv->stub_running)
+		return true;
+	priv->stub_running = false;
+
+	/* The stub looks in the next slot once it finishes the last block, so tell it to stop there */
+	const target_addr32_t slot = STM32F1_STUB_MAILBOX + priv->stub_slot * STM32F1_STUB_SLOT_SIZE;
+	if (!stm32f1_stub_wait_slot(target, slot) || target_mem32_write32(target, slot, STM32F1_STUB_SLOT_STOP))
+		return false;
+	/* It halts on bkpt #1 once stopped, anything else means the last block failed */
+	if (cortexm_wait_stub(target, STM32F1_STUB_TIMEOUT))
+		return true;
+	stm32f1_flash_stub_report(target);
+	return false;
+}
+
 static bool stm32f1_mass_erase_bank(
 	target_s *const target, const uint32_t bank_offset, platform_timeout_s *const timeout)
 {
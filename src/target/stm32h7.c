@@ -45,6 +45,7 @@
 #include "target.h"
 #include "target_internal.h"
 #include "cortexm.h"
+#include "adi.h"
 #include "stm32_common.h"
 #include "buffer_utils.h"
 
@@ -209,6 +210,8 @@ const command_s stm32h7_cmd_list[] = {
 static bool stm32h7_attach(target_s *target);
 static void stm32h7_detach(target_s *target);
 static bool stm32h7_flash_erase(target_flash_s *target_flash, target_addr_t addr, size_t len);
+static bool stm32h7_flash_erase_start(target_flash_s *target_flash, target_addr_t addr, size_t len);
+static bool stm32h7_flash_poll(target_flash_s *target_flash);
 static bool stm32h7_flash_write(target_flash_s *target_flash, target_addr_t dest, const void *src, size_t len);
 static bool stm32h7_flash_prepare(target_flash_s *target_flash);
 static bool stm32h7_flash_done(target_flash_s *target_flash);
@@ -234,6 +237,8 @@ static void stm32h7_add_flash(target_s *target, uint32_t addr, size_t length, si
 	target_flash->length = length;
 	target_flash->blocksize = blocksize;
 	target_flash->erase = stm32h7_flash_erase;
+	target_flash->erase_start = stm32h7_flash_erase_start;
+	target_flash->poll = stm32h7_flash_poll;
 	target_flash->write = stm32h7_flash_write;
 	target_flash->prepare = stm32h7_flash_prepare;
 	target_flash->done = stm32h7_flash_done;
@@ -427,11 +432,28 @@ static void stm32h7_detach(target_s *target)
 	cortexm_detach(target);
 }
 
+/* The wait queue bits clearing or EOP setting indicates completion of all ongoing operations */
+static bool stm32h7_flash_status_complete(const uint32_t status)
+{
+	return (status & STM32H7_FLASH_STATUS_EOP) || !(status & STM32H7_FLASH_STATUS_QUEUE_WAIT);
+}
+
+static bool stm32h7_flash_check_complete(target_s *const target, const uint32_t regbase, const uint32_t status)
+{
+	/* Now the operation's complete, we can check the error bits */
+	if (status & STM32H7_FLASH_STATUS_ERROR_MASK)
+		DEBUG_ERROR("%s: Flash error: %08" PRIx32 "\n", __func__, status);
+	target_mem32_write32(target, regbase + STM32H7_FLASH_CLEAR_CTRL,
+		status & (STM32H7_FLASH_STATUS_ERROR_MASK | STM32H7_FLASH_STATUS_EOP));
+	/* Return whether any errors occured */
+	return !(status & STM32H7_FLASH_STATUS_ERROR_MASK);
+}
+
 static bool stm32h7_flash_wait_complete(target_s *const target, const uint32_t regbase)
 {
 	uint32_t status = STM32H7_FLASH_STATUS_QUEUE_WAIT;
-	/* Loop waiting for thewait queue bits to clear and EOP to set, indicating completion of all ongoing operations */
-	while (!(status & STM32H7_FLASH_STATUS_EOP) && (status & STM32H7_FLASH_STATUS_QUEUE_WAIT)) {
+	/* Loop waiting for the operation to complete */
+	while (!stm32h7_flash_status_complete(status)) {
 		status = target_mem32_read32(target, regbase + STM32H7_FLASH_STATUS);
 		/* If an error occurs, make noises */
 		if (target_check_error(target)) {
@@ -439,13 +461,7 @@ static bool stm32h7_flash_wait_complete(target_s *const target, const uint32_t r
 			return false;
 		}
 	}
-	/* Now the operation's complete, we can check the error bits */
-	if (status & STM32H7_FLASH_STATUS_ERROR_MASK)
-		DEBUG_ERROR("%s: Flash error: %08" PRIx32 "\n", __func__, status);
-	target_mem32_write32(target, regbase + STM32H7_FLASH_CLEAR_CTRL,
-		status & (STM32H7_FLASH_STATUS_ERROR_MASK | STM32H7_FLASH_STATUS_EOP));
-	/* Return whether any errors occured */
-	return !(status & STM32H7_FLASH_STATUS_ERROR_MASK);
+	return stm32h7_flash_check_complete(target, regbase, status);
 }
 
 static bool stm32h7_flash_unlock(target_s *const target, const uint32_t regbase)
@@ -516,7 +532,7 @@ static uint32_t stm32h7_flash_cr(uint32_t sector_size, const uint32_t ctrl, cons
 	return command;
 }
 
-static bool stm32h7_flash_erase(target_flash_s *const target_flash, target_addr_t addr, const size_t len)
+static bool stm32h7_flash_erase_start(target_flash_s *const target_flash, target_addr_t addr, const size_t len)
 {
 	(void)len;
 	/* Erases are always done one sector at a time - the target Flash API guarantees this */
@@ -530,9 +546,67 @@ static bool stm32h7_flash_erase(target_flash_s *const target_flash, target_addr_
 		target, flash->regbase + STM32H7_FLASH_CTRL, stm32h7_flash_cr(target_flash->blocksize, ctrl, sector));
 	target_mem32_write32(target, flash->regbase + STM32H7_FLASH_CTRL,
 		stm32h7_flash_cr(target_flash->blocksize, ctrl | STM32H7_FLASH_CTRL_START, sector));
+	return true;
+}
 
+static bool stm32h7_flash_erase(target_flash_s *const target_flash, const target_addr_t addr, const size_t len)
+{
+	const stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
+	if (!stm32h7_flash_erase_start(target_flash, addr, len))
+		return false;
 	/* Wait for the operation to complete and report errors */
-	return stm32h7_flash_wait_complete(target, flash->regbase);
+	return stm32h7_flash_wait_complete(target_flash->t, flash->regbase);
+}
+
+/* Read the status registers of both banks, in a single batch of AP accesses where the probe can run one */
+static void stm32h7_flash_read_status(
+	target_s *const target, stm32h7_flash_s *const *const banks, uint32_t *const status, const size_t count)
+{
+#if PC_HOSTED == 1
+	adiv5_access_port_s *const ap = cortex_ap(target);
+	if (count == 2U && ap->dp->batch) {
+		const adiv5_batch_access_s accesses[] = {
+			{ADIV5_BATCH_READ, ADIV5_AP_DRW, 0U, &status[0]},
+			{ADIV5_BATCH_WRITE, ADIV5_AP_TAR_LOW, banks[1]->regbase + STM32H7_FLASH_STATUS, NULL},
+			{ADIV5_BATCH_READ, ADIV5_AP_DRW, 0U, &status[1]},
+		};
+		adi_ap_mem_access_setup(ap, banks[0]->regbase + STM32H7_FLASH_STATUS, ALIGN_32BIT);
+		if (ap->dp->batch(ap->dp, accesses, ARRAY_LENGTH(accesses)))
+			return;
+	}
+#endif
+	for (size_t i = 0U; i < count; ++i)
+		status[i] = target_mem32_read32(target, banks[i]->regbase + STM32H7_FLASH_STATUS);
+}
+
+/* Check on the sector erases started on the banks, covering every busy bank with the one status read */
+static bool stm32h7_flash_poll(target_flash_s *const target_flash)
+{
+	target_s *const target = target_flash->t;
+	stm32h7_flash_s *banks[2U];
+	size_t count = 0U;
+	for (target_flash_s *flash = target->flash; flash && count < ARRAY_LENGTH(banks); flash = flash->next) {
+		if (flash->poll == stm32h7_flash_poll && flash->busy)
+			banks[count++] = (stm32h7_flash_s *)flash;
+	}
+
+	uint32_t status[2U];
+	stm32h7_flash_read_status(target, banks, status, count);
+	if (target_check_error(target)) {
+		DEBUG_ERROR("%s: error reading status\n", __func__);
+		for (size_t i = 0U; i < count; ++i)
+			banks[i]->target_flash.busy = false;
+		return false;
+	}
+
+	bool result = true;
+	for (size_t i = 0U; i < count; ++i) {
+		if (!stm32h7_flash_status_complete(status[i]))
+			continue;
+		result &= stm32h7_flash_check_complete(target, banks[i]->regbase, status[i]);
+		banks[i]->target_flash.busy = false;
+	}
+	return result;
 }
 
 static bool stm32h7_flash_write(
@@ -43,14 +43,55 @@ target_s *target_list = NULL;
 
 #define FLASH_WRITE_BUFFER_CEILING 1024U
 
+#if PC_HOSTED == 1
+/*
+ * Memory read cache: GDB re-reads the same stack frames, vector tables and constants many times
+ * per stop, so when enabled, reads falling entirely within the RAM and Flash maps are served from
+ * direct-mapped lines, each filled from the target in one go. RAM lines are only used while the
+ * target is known to be halted and are dropped as soon as it might run again. Flash lines survive
+ * across halts until the range is written or a Flash operation is done.
+ */
+#define TARGET_MEM_CACHE_LINE_SIZE  64U
+#define TARGET_MEM_CACHE_LINE_COUNT 256U
+/* Most consecutive missing lines fetched with a single read */
+#define TARGET_MEM_CACHE_FILL_LINES 16U
+
+typedef struct target_mem_cache_line {
+	target_addr64_t addr;
+	bool valid;
+	bool flash;
+	uint8_t data[TARGET_MEM_CACHE_LINE_SIZE];
+} target_mem_cache_line_s;
+
+struct target_mem_cache {
+	/* True while the target is known to be halted, RAM lines may only be filled and used while it is */
+	bool halted;
+	uint32_t hits;
+	uint32_t misses;
+	target_mem_cache_line_s lines[TARGET_MEM_CACHE_LINE_COUNT];
+};
+
+typedef enum target_mem_cache_kind {
+	TARGET_MEM_CACHE_NONE,
+	TARGET_MEM_CACHE_RAM,
+	TARGET_MEM_CACHE_FLASH,
+} target_mem_cache_kind_e;
+#endif
+
 static bool target_cmd_mass_erase(target_s *target, int argc, const char **argv);
 static bool target_cmd_range_erase(target_s *target, int argc, const char **argv);
 static bool target_cmd_redirect_output(target_s *target, int argc, const char **argv);
+#if PC_HOSTED == 1
+static bool target_cmd_mem_cache(target_s *target, int argc, const char **argv);
+#endif
 
 const command_s target_cmd_list[] = {
 	{"erase_mass", target_cmd_mass_erase, "Erase whole device Flash"},
 	{"erase_range", target_cmd_range_erase, "Erase a range of memory on a device"},
 	{"redirect_stdout", target_cmd_redirect_output, "Redirect semihosting output to aux USB serial"},
+#if PC_HOSTED == 1
+	{"mem_cache", target_cmd_mem_cache, "Cache memory reads from the RAM and Flash maps: [enable|disable]"},
+#endif
 	{NULL, NULL, NULL},
 };
 
@@ -99,6 +140,8 @@ void target_flash_map_free(target_s *target)
 		target_flash_s *next = target->flash->next;
 		if (target->flash->buf)
 			free(target->flash->buf);
+		free(target->flash->erase_pending);
+		free(target->flash->diff_buf);
 		free(target->flash);
 		target->flash = next;
 	}
@@ -135,6 +178,9 @@ void target_list_free(void)
 			target->commands = tc;
 		}
 		free(target->target_storage);
+#if PC_HOSTED == 1
+		free(target->mem_cache);
+#endif
 		target_mem_map_free(target);
 		while (target->bw_list) {
 			void *next = target->bw_list->next;
@@ -192,6 +238,12 @@ target_s *target_attach(target_s *target, target_controller_s *controller)
 	}
 
 	target->attached = true;
+	/* Anything could have happened to the target's memory while we were detached, but it's now halted */
+	target_mem_cache_invalidate(target, true);
+#if PC_HOSTED == 1
+	if (target->mem_cache)
+		target->mem_cache->halted = true;
+#endif
 	return target;
 }
 
@@ -277,6 +329,7 @@ void target_detach(target_s *target)
 {
 	if (target->detach)
 		target->detach(target);
+	target_mem_cache_invalidate(target, true);
 	platform_target_clk_output_enable(false);
 	target->attached = false;
 #if PC_HOSTED == 1
@@ -291,6 +344,127 @@ bool target_check_error(target_s *target)
 	return false;
 }
 
+#if PC_HOSTED == 1
+/* Work out which map, if any, a line lies entirely within */
+static target_mem_cache_kind_e target_mem_cache_kind(const target_s *const target, const target_addr64_t line_addr)
+{
+	const target_addr64_t line_end = line_addr + TARGET_MEM_CACHE_LINE_SIZE;
+	for (const target_flash_s *flash = target->flash; flash; flash = flash->next) {
+		if (line_addr >= flash->start && line_end <= (target_addr64_t)flash->start + flash->length)
+			return TARGET_MEM_CACHE_FLASH;
+	}
+	for (const target_ram_s *ram = target->ram; ram; ram = ram->next) {
+		if (line_addr >= ram->start && line_end <= (target_addr64_t)ram->start + ram->length)
+			return TARGET_MEM_CACHE_RAM;
+	}
+	return TARGET_MEM_CACHE_NONE;
+}
+
+/*
+ * Memories tend to start on large power-of-2 boundaries (0x08000000, 0x20000000, ...), so fold
+ * the upper address bits into the index to keep them from all landing on the same lines
+ */
+static inline target_mem_cache_line_s *target_mem_cache_line(
+	target_mem_cache_s *const cache, const target_addr64_t line_addr)
+{
+	const uint64_t line = line_addr / TARGET_MEM_CACHE_LINE_SIZE;
+	return &cache->lines[(line ^ (line >> 8U) ^ (line >> 16U)) % TARGET_MEM_CACHE_LINE_COUNT];
+}
+
+/* Check that every line a read touches may be cached right now */
+static bool target_mem_cache_covers(const target_s *const target, const target_addr64_t src, const size_t len)
+{
+	const target_addr64_t end = src + len;
+	for (target_addr64_t line_addr = src & ~(target_addr64_t)(TARGET_MEM_CACHE_LINE_SIZE - 1U); line_addr < end;
+		 line_addr += TARGET_MEM_CACHE_LINE_SIZE) {
+		const target_mem_cache_kind_e kind = target_mem_cache_kind(target, line_addr);
+		if (kind == TARGET_MEM_CACHE_NONE || (kind == TARGET_MEM_CACHE_RAM && !target->mem_cache->halted))
+			return false;
+	}
+	return len != 0U;
+}
+
+/* Serve a read target_mem_cache_covers() accepted, filling any missing lines. Returns true on error */
+static bool target_mem_cache_read(target_s *const target, void *const dest, const target_addr64_t src, const size_t len)
+{
+	target_mem_cache_s *const cache = target->mem_cache;
+	const target_addr64_t end = src + len;
+	target_addr64_t line_addr = src & ~(target_addr64_t)(TARGET_MEM_CACHE_LINE_SIZE - 1U);
+	while (line_addr < end) {
+		/* Gather up the run of missing lines from here so it can be fetched with one read */
+		size_t count = 0;
+		for (; count < TARGET_MEM_CACHE_FILL_LINES && line_addr + count * TARGET_MEM_CACHE_LINE_SIZE < end; ++count) {
+			const target_addr64_t addr = line_addr + count * TARGET_MEM_CACHE_LINE_SIZE;
+			const target_mem_cache_line_s *const line = target_mem_cache_line(cache, addr);
+			if (line->valid && line->addr == addr)
+				break;
+		}
+
+		const size_t fetch = count * TARGET_MEM_CACHE_LINE_SIZE;
+		const target_addr64_t begin = MAX(line_addr, src);
+		if (count) {
+			uint8_t fill[TARGET_MEM_CACHE_FILL_LINES * TARGET_MEM_CACHE_LINE_SIZE];
+			target->mem_read(target, fill, line_addr, fetch);
+			if (target_check_error(target))
+				return true;
+			for (size_t idx = 0; idx < count; ++idx) {
+				const target_addr64_t addr = line_addr + idx * TARGET_MEM_CACHE_LINE_SIZE;
+				target_mem_cache_line_s *const line = target_mem_cache_line(cache, addr);
+				line->addr = addr;
+				line->valid = true;
+				line->flash = target_mem_cache_kind(target, addr) == TARGET_MEM_CACHE_FLASH;
+				memcpy(line->data, fill + idx * TARGET_MEM_CACHE_LINE_SIZE, TARGET_MEM_CACHE_LINE_SIZE);
+			}
+			/* Copy out from what was fetched, as lines in the run may have evicted each other */
+			memcpy((uint8_t *)dest + (begin - src), fill + (begin - line_addr), MIN(line_addr + fetch, end) - begin);
+			cache->misses += count;
+		} else {
+			const target_mem_cache_line_s *const line = target_mem_cache_line(cache, line_addr);
+			memcpy((uint8_t *)dest + (begin - src), line->data + (begin - line_addr),
+				MIN(line_addr + TARGET_MEM_CACHE_LINE_SIZE, end) - begin);
+			count = 1U;
+			++cache->hits;
+		}
+		line_addr += count * TARGET_MEM_CACHE_LINE_SIZE;
+	}
+	return false;
+}
+
+/* Drop any lines a write to the target overlaps */
+static void target_mem_cache_written(target_s *const target, const target_addr64_t dest, const size_t len)
+{
+	target_mem_cache_s *const cache = target->mem_cache;
+	for (size_t idx = 0; idx < TARGET_MEM_CACHE_LINE_COUNT; ++idx) {
+		target_mem_cache_line_s *const line = &cache->lines[idx];
+		if (line->valid && line->addr < dest + len && dest < line->addr + TARGET_MEM_CACHE_LINE_SIZE)
+			line->valid = false;
+	}
+}
+#endif
+
+/*
+ * Called when the target may run or its memory may change behind the cache's back: drops all
+ * RAM lines, and the Flash lines too if requested. The target is no longer taken to be halted
+ * until target_halt_poll() next says it is.
+ */
+void target_mem_cache_invalidate(target_s *const target, const bool flash)
+{
+#if PC_HOSTED == 1
+	target_mem_cache_s *const cache = target->mem_cache;
+	if (!cache)
+		return;
+	cache->halted = false;
+	for (size_t idx = 0; idx < TARGET_MEM_CACHE_LINE_COUNT; ++idx) {
+		target_mem_cache_line_s *const line = &cache->lines[idx];
+		if (flash || !line->flash)
+			line->valid = false;
+	}
+#else
+	(void)target;
+	(void)flash;
+#endif
+}
+
 /* Memory access functions */
 bool target_mem32_read(target_s *const target, void *const dest, const target_addr_t src, const size_t len)
 {
@@ -307,6 +481,11 @@ bool target_mem64_read(target_s *const target, void *const dest, const target_ad
 		memcpy(dest, target->tc->semihosting_buffer_ptr, amount);
 		return false;
 	}
+#if PC_HOSTED == 1
+	/* If the read can be served from the cache, do so */
+	if (target->mem_cache && target->mem_read && target_mem_cache_covers(target, src, len))
+		return target_mem_cache_read(target, dest, src, len);
+#endif
 	/* Otherwise if the target defines a memory read function, call that instead and check for errors */
 	if (target->mem_read)
 		target->mem_read(target, dest, src, len);
@@ -328,6 +507,10 @@ bool target_mem64_write(target_s *const target, const target_addr64_t dest, cons
 		memcpy(target->tc->semihosting_buffer_ptr, src, amount);
 		return false;
 	}
+#if PC_HOSTED == 1
+	if (target->mem_cache)
+		target_mem_cache_written(target, dest, len);
+#endif
 	/* Otherwise if the target defines a memory write function, call that instead and check for errors */
 	if (target->mem_write)
 		target->mem_write(target, dest, src, len);
@@ -381,6 +564,7 @@ void target_regs_write(target_s *t, const void *data)
 /* Halt/resume functions */
 void target_reset(target_s *t)
 {
+	target_mem_cache_invalidate(t, true);
 	if (t->reset)
 		t->reset(t);
 }
@@ -393,14 +577,22 @@ void target_halt_request(target_s *t)
 
 target_halt_reason_e target_halt_poll(target_s *t, target_addr_t *watch)
 {
-	if (t->halt_poll)
-		return t->halt_poll(t, watch);
+	if (t->halt_poll) {
+		const target_halt_reason_e reason = t->halt_poll(t, watch);
+#if PC_HOSTED == 1
+		/* RAM lines become usable once the target is seen to have stopped */
+		if (t->mem_cache)
+			t->mem_cache->halted = reason != TARGET_HALT_RUNNING && reason != TARGET_HALT_ERROR;
+#endif
+		return reason;
+	}
 	/* XXX: Is this actually the desired fallback behaviour? */
 	return TARGET_HALT_RUNNING;
 }
 
 void target_halt_resume(target_s *t, bool step)
 {
+	target_mem_cache_invalidate(t, false);
 	if (t->halt_resume)
 		t->halt_resume(t, step);
 }
@@ -495,6 +687,7 @@ static bool target_cmd_mass_erase(target_s *const t, const int argc, const char
 	}
 	gdb_out("Erasing device Flash: ");
 	const bool result = t->mass_erase(t);
+	target_mem_cache_invalidate(t, true);
 	gdb_out("done\n");
 	return result;
 }
@@ -522,6 +715,39 @@ static bool target_cmd_redirect_output(target_s *target, int argc, const char **
 	return parse_enable_or_disable(argv[1], &target->stdout_redirected);
 }
 
+#if PC_HOSTED == 1
+static bool target_cmd_mem_cache(target_s *target, int argc, const char **argv)
+{
+	if (argc == 1) {
+		if (target->mem_cache)
+			gdb_outf("Memory read cache: enabled, %" PRIu32 " line hits, %" PRIu32 " line misses\n",
+				target->mem_cache->hits, target->mem_cache->misses);
+		else
+			gdb_out("Memory read cache: disabled\n");
+		return true;
+	}
+
+	bool enable = false;
+	if (!parse_enable_or_disable(argv[1], &enable))
+		return false;
+	if (!enable) {
+		free(target->mem_cache);
+		target->mem_cache = NULL;
+		return true;
+	}
+	if (!target->mem_cache) {
+		target->mem_cache = calloc(1, sizeof(*target->mem_cache));
+		if (!target->mem_cache) { /* calloc failed: heap exhaustion */
+			DEBUG_ERROR("calloc: failed in %s\n", __func__);
+			return false;
+		}
+	}
+	/* Monitor commands only run while the target is halted */
+	target->mem_cache->halted = true;
+	return true;
+}
+#endif
+
 /* Accessor functions */
 size_t target_regs_size(target_s *t)
 {
@@ -589,8 +815,11 @@ int target_command(target_s *t, int argc, const char *argv[])
 {
 	for (const target_command_s *tc = t->commands; tc; tc = tc->next) {
 		for (const command_s *c = tc->cmds; c->cmd; c++) {
-			if (!strncmp(argv[0], c->cmd, strlen(argv[0])))
+			if (!strncmp(argv[0], c->cmd, strlen(argv[0]))) {
+				/* Commands may run code on the target or otherwise change its memory behind our back */
+				target_mem_cache_invalidate(t, true);
 				return c->handler(t, argc, argv) ? 0 : 1;
+			}
 		}
 	}
 	return -1;
@@ -37,8 +37,14 @@
 
 #include "general.h"
 #include "target_internal.h"
+#include "crc32.h"
 
 static bool flash_done(target_flash_s *flash);
+bool flash_buffer_alloc(target_flash_s *flash);
+static bool flash_buffered_flush(target_flash_s *flash);
+static bool flash_buffered_write(target_flash_s *flash, target_addr_t dest, const uint8_t *src, size_t len);
+
+bool target_flash_differential = false;
 
 target_flash_s *target_flash_for_addr(target_s *target, uint32_t addr)
 {
@@ -51,6 +57,8 @@ target_flash_s *target_flash_for_addr(target_s *target, uint32_t addr)
 
 static bool target_enter_flash_mode(target_s *target)
 {
+	/* Every Flash operation goes through here, so this is where cached Flash contents go stale */
+	target_mem_cache_invalidate(target, true);
 	if (target->flash_mode)
 		return true;
 
@@ -80,6 +88,7 @@ static bool target_exit_flash_mode(target_s *target)
 		target_reset(target);
 
 	target->flash_mode = false;
+	target_mem_cache_invalidate(target, true);
 	return result;
 }
 
@@ -131,11 +140,249 @@ static bool flash_done(target_flash_s *flash)
 	return result;
 }
 
+/*
+ * Differential programming: erases GDB asks for are only recorded, and the data written into
+ * each such erase block is staged in a block sized buffer. Once the block is complete, it is
+ * only erased and written if its CRC differs from what is already in the Flash.
+ */
+static size_t flash_diff_block_index(const target_flash_s *const flash, const target_addr_t addr)
+{
+	return (addr - flash->start) / flash->blocksize;
+}
+
+static bool flash_diff_defer_erase(target_flash_s *const flash, const target_addr_t block_addr)
+{
+	if (!flash->erase_pending) {
+		const size_t block_count = (flash->length + flash->blocksize - 1U) / flash->blocksize;
+		flash->erase_pending = calloc((block_count + 7U) / 8U, 1U);
+		if (!flash->erase_pending) { /* calloc failed: heap exhaustion */
+			DEBUG_ERROR("calloc: failed in %s\n", __func__);
+			return false;
+		}
+	}
+	const size_t index = flash_diff_block_index(flash, block_addr);
+	flash->erase_pending[index / 8U] |= 1U << (index % 8U);
+	return true;
+}
+
+static bool flash_diff_erase_pending(const target_flash_s *const flash, const target_addr_t block_addr)
+{
+	if (!flash->erase_pending)
+		return false;
+	const size_t index = flash_diff_block_index(flash, block_addr);
+	return flash->erase_pending[index / 8U] & (1U << (index % 8U));
+}
+
+static void flash_diff_clear_pending(target_flash_s *const flash, const target_addr_t block_addr)
+{
+	const size_t index = flash_diff_block_index(flash, block_addr);
+	flash->erase_pending[index / 8U] &= ~(1U << (index % 8U));
+}
+
+/* Erase a block whose erase was deferred and write the non-blank parts of data to it */
+static bool flash_diff_program_block(target_flash_s *const flash, const target_addr_t block_addr, const uint8_t *data)
+{
+	/* Switching operation throws away the write buffer, so get anything in it out first */
+	if (!flash_buffered_flush(flash) || !flash_prepare(flash, FLASH_OPERATION_ERASE))
+		return false;
+	if (!flash->erase(flash, block_addr, flash->blocksize)) {
+		DEBUG_ERROR("Erase failed at %" PRIx32 "\n", block_addr);
+		flash_done(flash);
+		return false;
+	}
+	if (!flash_done(flash))
+		return false;
+	if (!data)
+		return true;
+	if (!flash->buf && !flash_buffer_alloc(flash))
+		return false;
+
+	bool result = true; /* Catch false returns with &= */
+	for (size_t offset = 0; offset < flash->blocksize; offset += flash->writebufsize) {
+		const size_t chunk_len = MIN(flash->writebufsize, flash->blocksize - offset);
+		for (size_t i = 0; i < chunk_len; ++i) {
+			if (data[offset + i] != flash->erased) {
+				result &= flash_buffered_write(flash, block_addr + offset, data + offset, chunk_len);
+				break;
+			}
+		}
+	}
+	return result && flash_buffered_flush(flash);
+}
+
+/* Finish off the staged erase block, skipping the erase and write if the Flash already holds that data */
+static bool flash_diff_commit(target_flash_s *const flash)
+{
+	if (!flash->diff_buf || flash->diff_addr == UINT32_MAX)
+		return true;
+
+	const target_addr_t block_addr = flash->diff_addr;
+	flash->diff_addr = UINT32_MAX;
+	flash_diff_clear_pending(flash, block_addr);
+
+	/* Get any previous block out and the Flash back to being readable before checking it */
+	bool result = flash_buffered_flush(flash);
+	result &= flash_done(flash);
+	if (!result)
+		return false;
+
+	uint32_t crc = 0;
+	if (bmd_crc32(flash->t, &crc, block_addr, flash->blocksize) &&
+		crc == bmd_crc32_buffer(flash->diff_buf, flash->blocksize)) {
+		DEBUG_INFO("Skipping unchanged Flash block at %08" PRIx32 "\n", block_addr);
+		return true;
+	}
+	return flash_diff_program_block(flash, block_addr, flash->diff_buf);
+}
+
+static bool flash_diff_write(target_flash_s *const flash, const target_addr_t dest, const uint8_t *src, size_t len)
+{
+	const target_addr_t block_addr = dest & ~(flash->blocksize - 1U);
+	if (flash->diff_addr != block_addr || !flash->diff_buf) {
+		if (!flash_diff_commit(flash))
+			return false;
+		if (!flash->diff_buf) {
+			flash->diff_buf = malloc(flash->blocksize);
+			if (!flash->diff_buf) {
+				/* Not enough memory to stage a whole block, so do the erase and write straight away */
+				DEBUG_WARN("Flash block too large for differential programming, erasing\n");
+				flash_diff_clear_pending(flash, block_addr);
+				if (!flash_diff_program_block(flash, block_addr, NULL))
+					return false;
+				if (!flash->buf && !flash_buffer_alloc(flash))
+					return false;
+				return flash_buffered_write(flash, dest, src, len);
+			}
+		}
+		memset(flash->diff_buf, flash->erased, flash->blocksize);
+		flash->diff_addr = block_addr;
+	}
+	memcpy(flash->diff_buf + (dest - block_addr), src, len);
+	return true;
+}
+
+/* Commit the staged block and carry out the deferred erases of blocks nothing was written to */
+static bool flash_diff_finish(target_flash_s *const flash)
+{
+	if (!flash->erase_pending)
+		return true;
+
+	bool result = flash_diff_commit(flash);
+	for (target_addr_t block_addr = flash->start; result && block_addr < flash->start + flash->length;
+		 block_addr += flash->blocksize) {
+		if (!flash_diff_erase_pending(flash, block_addr))
+			continue;
+		if (flash->diff_buf) {
+			memset(flash->diff_buf, flash->erased, flash->blocksize);
+			flash->diff_addr = block_addr;
+			result &= flash_diff_commit(flash);
+		} else {
+			flash_diff_clear_pending(flash, block_addr);
+			result &= flash_diff_program_block(flash, block_addr, NULL);
+		}
+	}
+
+	free(flash->erase_pending);
+	flash->erase_pending = NULL;
+	free(flash->diff_buf);
+	flash->diff_buf = NULL;
+	return result;
+}
+
+/*
+ * Concurrent erase: when a range spans several Flashes that can each run an erase in the background
+ * (such as the two banks of a dual-bank part with a controller apiece), keep a block erase going on
+ * every one of them at once rather than erasing the whole range one block at a time.
+ *
+ * Only erases are overlapped this way. Programming still goes through the buffered write path one
+ * Flash at a time, as does the erase half of a differential load, whose erases are deferred into it.
+ */
+
+/* How long to wait on the running erases without any of them finishing before giving up, in ms */
+#define FLASH_ERASE_CONCURRENT_TIMEOUT 10000U
+
+static bool flash_erase_concurrent_ok(target_s *const target, target_addr_t addr, const target_addr_t end)
+{
+	size_t flashes = 0;
+	while (addr < end) {
+		const target_flash_s *const flash = target_flash_for_addr(target, addr);
+		if (!flash || !flash->erase_start || !flash->poll)
+			return false;
+		addr = flash->start + flash->length;
+		++flashes;
+	}
+	return flashes > 1U;
+}
+
+static bool flash_erase_concurrent(target_s *const target, const target_addr_t addr, const target_addr_t end)
+{
+	/* Point each Flash at its first block in the range, or at its end if it's not part of it */
+	for (target_flash_s *flash = target->flash; flash; flash = flash->next) {
+		const target_addr_t flash_end = flash->start + flash->length;
+		if (addr < flash_end && flash->start < end)
+			flash->erase_next = MAX(addr, flash->start) & ~(flash->blocksize - 1U);
+		else
+			flash->erase_next = flash_end;
+		flash->busy = false;
+	}
+
+	bool result = true; /* Catch false returns with &= */
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, FLASH_ERASE_CONCURRENT_TIMEOUT);
+	for (bool running = true; running;) {
+		/* Start the next block on every Flash that's gone idle, unless something has already failed */
+		for (target_flash_s *flash = target->flash; result && flash; flash = flash->next) {
+			if (flash->busy || flash->erase_next >= MIN(end, flash->start + flash->length))
+				continue;
+			if (!flash_prepare(flash, FLASH_OPERATION_ERASE) ||
+				!flash->erase_start(flash, flash->erase_next, flash->blocksize)) {
+				DEBUG_ERROR("Erase failed at %" PRIx32 "\n", flash->erase_next);
+				result = false;
+				break;
+			}
+			flash->busy = true;
+			flash->erase_next += flash->blocksize;
+			platform_timeout_set(&timeout, FLASH_ERASE_CONCURRENT_TIMEOUT);
+		}
+
+		/* Then check on the running erases, Flashes sharing a poll routine being checked by a single call */
+		running = false;
+		flash_poll_func polled = NULL;
+		for (target_flash_s *flash = target->flash; flash; flash = flash->next) {
+			if (!flash->busy)
+				continue;
+			running = true;
+			if (flash->poll == polled)
+				continue;
+			polled = flash->poll;
+			result &= flash->poll(flash);
+		}
+
+		/* If nothing has completed in too long, abandon whatever is still marked as running */
+		if (running && platform_timeout_is_expired(&timeout)) {
+			DEBUG_ERROR("Erase timed out\n");
+			for (target_flash_s *flash = target->flash; flash; flash = flash->next)
+				flash->busy = false;
+			result = false;
+			running = false;
+		}
+	}
+
+	for (target_flash_s *flash = target->flash; flash; flash = flash->next) {
+		if (addr < flash->start + flash->length && flash->start < end)
+			result &= flash_done(flash);
+	}
+	return result;
+}
+
 bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
 {
 	if (!target_enter_flash_mode(target))
 		return false;
 
+	if (!target_flash_differential && flash_erase_concurrent_ok(target, addr, addr + len))
+		return flash_erase_concurrent(target, addr, addr + len);
+
 	target_flash_s *active_flash = target_flash_for_addr(target, addr);
 	if (!active_flash)
 		return false;
@@ -157,13 +404,16 @@ bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
 		const target_addr_t local_start_addr = addr & ~(flash->blocksize - 1U);
 		const target_addr_t local_end_addr = local_start_addr + flash->blocksize;
 
-		if (!flash_prepare(flash, FLASH_OPERATION_ERASE))
-			return false;
+		/* In differential mode, hold off erasing until we know what is going to be written to the block */
+		if (!target_flash_differential || !flash_diff_defer_erase(flash, local_start_addr)) {
+			if (!flash_prepare(flash, FLASH_OPERATION_ERASE))
+				return false;
 
-		result &= flash->erase(flash, local_start_addr, flash->blocksize);
-		if (!result) {
-			DEBUG_ERROR("Erase failed at %" PRIx32 "\n", local_start_addr);
-			break;
+			result &= flash->erase(flash, local_start_addr, flash->blocksize);
+			if (!result) {
+				DEBUG_ERROR("Erase failed at %" PRIx32 "\n", local_start_addr);
+				break;
+			}
 		}
 
 		len -= MIN(local_end_addr - addr, len);
@@ -285,7 +535,22 @@ bool target_flash_write(target_s *target, target_addr_t dest, const void *src, s
 		const target_addr_t local_end_addr = MIN(dest + len, flash->start + flash->length);
 		const target_addr_t local_length = local_end_addr - dest;
 
-		result &= flash_buffered_write(flash, dest, src, local_length);
+		for (size_t offset = 0; result && offset < local_length;) {
+			/* Split the write on erase block boundaries so blocks with deferred erases can be staged */
+			const target_addr_t chunk_addr = dest + offset;
+			const target_addr_t block_end = (chunk_addr & ~(flash->blocksize - 1U)) + flash->blocksize;
+			const size_t chunk_len = MIN(block_end - chunk_addr, local_length - offset);
+			const uint8_t *const chunk = (const uint8_t *)src + offset;
+			if (flash_diff_erase_pending(flash, chunk_addr))
+				result &= flash_diff_write(flash, chunk_addr, chunk, chunk_len);
+			else {
+				if (!flash->buf)
+					result &= flash_buffer_alloc(flash);
+				if (result)
+					result &= flash_buffered_write(flash, chunk_addr, chunk, chunk_len);
+			}
+			offset += chunk_len;
+		}
 		if (!result) {
 			DEBUG_ERROR("Write failed at %" PRIx32 "\n", dest);
 			return false;
@@ -305,6 +570,7 @@ bool target_flash_complete(target_s *target)
 
 	bool result = true; /* Catch false returns with &= */
 	for (target_flash_s *flash = target->flash; flash; flash = flash->next) {
+		result &= flash_diff_finish(flash);
 		result &= flash_buffered_flush(flash);
 		result &= flash_done(flash);
 	}
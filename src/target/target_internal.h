@@ -53,6 +53,7 @@ typedef bool (*flash_prepare_func)(target_flash_s *flash);
 typedef bool (*flash_erase_func)(target_flash_s *flash, target_addr_t addr, size_t len);
 typedef bool (*flash_write_func)(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
 typedef bool (*flash_done_func)(target_flash_s *flash);
+typedef bool (*flash_poll_func)(target_flash_s *flash);
 
 struct target_flash {
 	/* XXX: This needs adjusting for 64-bit operations */
@@ -64,14 +65,21 @@ struct target_flash {
 	size_t writebufsize;           /* Size of write buffer, this is calculated and not set in target code */
 	uint8_t erased;                /* Byte erased state */
 	uint8_t operation;             /* Current Flash operation (none means it's idle/unprepared) */
+	bool busy;                     /* An erase started by erase_start is still running */
 	flash_prepare_func prepare;    /* Prepare for flash operations */
 	flash_erase_func erase;        /* Erase a range of flash */
 	flash_write_func write;        /* Write to flash */
 	flash_done_func done;          /* Finish flash operations */
+	flash_erase_func erase_start;  /* Start erasing a block without waiting for it (optional, needs poll) */
+	flash_poll_func poll;          /* Check on running erases, clearing busy on those that ended or failed */
 	uint8_t *buf;                  /* Buffer for flash operations */
 	target_addr32_t buf_addr_base; /* Address of block this buffer is for */
 	target_addr32_t buf_addr_low;  /* Address of lowest byte written */
 	target_addr32_t buf_addr_high; /* Address of highest byte written */
+	uint8_t *erase_pending;        /* Bitmap of erase blocks with a deferred erase (differential mode) */
+	uint8_t *diff_buf;             /* Erase block sized staging buffer for differential mode */
+	target_addr32_t diff_addr;     /* Address of the erase block diff_buf is for */
+	target_addr32_t erase_next;    /* Next block to start when erasing several Flashes at once */
 	target_flash_s *next;          /* Next flash in list */
 };
 
@@ -104,6 +112,10 @@ struct breakwatch {
 
 #define MAX_CMDLINE 81
 
+#if PC_HOSTED == 1
+typedef struct target_mem_cache target_mem_cache_s;
+#endif
+
 struct target {
 	target_controller_s *tc;
 
@@ -158,6 +170,10 @@ struct target {
 
 	target_ram_s *ram;
 	target_flash_s *flash;
+#if PC_HOSTED == 1
+	/* Read cache over the RAM and Flash maps, NULL unless enabled with `monitor mem_cache` */
+	target_mem_cache_s *mem_cache;
+#endif
 
 	/* Other stuff */
 	const char *driver;
@@ -192,6 +208,7 @@ void target_add_ram64(target_s *target, target_addr64_t start, uint64_t len);
 void target_add_flash(target_s *target, target_flash_s *flash);
 
 target_flash_s *target_flash_for_addr(target_s *target, uint32_t addr);
+void target_mem_cache_invalidate(target_s *target, bool flash);
 
 /* Convenience function for MMIO access */
 uint32_t target_mem32_read32(target_s *target, target_addr32_t addr);
@@ -23,8 +23,13 @@
 #include "target.h"
 #include "adiv5.h"
 
+#if PC_HOSTED == 1
+#include "id_cache.h"
+#endif
+
 #define STRINGIFY(x) #x
 /* Probe launch macro used by the CPU-generic layers to then call CPU-specific routines safely */
+#if PC_HOSTED == 0
 #define PROBE(x)                                    \
 	do {                                            \
 		DEBUG_TARGET("Calling " STRINGIFY(x) "\n"); \
@@ -32,6 +37,23 @@
 			return true;                            \
 		target_check_error(target);                 \
 	} while (0)
+#else
+/* BMDA also lets the identification cache pick the one routine to call, and notes which one claimed the part */
+#define PROBE(x)                                                                    \
+	do {                                                                            \
+		const id_cache_probe_action_e action = id_cache_probe_action(STRINGIFY(x)); \
+		if (action == ID_CACHE_PROBE_STOP)                                          \
+			return false;                                                           \
+		if (action == ID_CACHE_PROBE_SKIP)                                          \
+			break;                                                                  \
+		DEBUG_TARGET("Calling " STRINGIFY(x) "\n");                                 \
+		if ((x)(target)) {                                                          \
+			id_cache_probe_claimed(STRINGIFY(x));                                   \
+			return true;                                                            \
+		}                                                                           \
+		target_check_error(target);                                                 \
+	} while (0)
+#endif
 
 /*
  * Probe for various targets.